@@ -0,0 +1,94 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "cmap.h"
+
+/*
+ * A benchmark of range aggregates (total bytes of the keys in a range).
+ * N random keys with random sizes are inserted into a plain map and an augmented
+ * map keeping the sums of the sizes, then the total size of random ranges is
+ * computed by walking the keys or by aggregate_range().
+ */
+#define N (1 << 20)
+#define QUERIES (1 << 12)
+
+int int_cmp(const void *d1, const void *d2) {
+	const int *int1 = d1, *int2 = d2;
+	return (*int1 > *int2) - (*int1 < *int2);
+}
+
+size_t int_size_get(const void *d1) {
+	return sizeof(int);
+}
+
+void sum_lift(void *summary, const void *key, const void *val) {
+	*(long *)summary = *(const int *)val;
+}
+
+void sum_combine(void *summary, const void *left, const void *right) {
+	*(long *)summary = *(const long *)left + *(const long *)right;
+}
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void run(const char *name, cmap_t *map, int *keys, int *vals, bool augmented) {
+	double start = now();
+	for (int i = 0; i < N; i++)
+		map->insert(map, &keys[i], &vals[i]);
+	double insert_elapsed = now() - start;
+
+	long total = 0;
+	srand(2);
+	start = now();
+	for (int i = 0; i < QUERIES; i++) {
+		int low = rand() % (RAND_MAX - RAND_MAX / 16), high = low + RAND_MAX / 16;
+		long sum = 0;
+		if (augmented) {
+			map->aggregate_range(map, &low, &high, &sum);
+		}
+		else {
+			cmap_iter_t stop = map->lower_bound(map, &high);
+			for (cmap_iter_t it = map->lower_bound(map, &low); it.node != stop.node;
+			     it = map->next(map, it))
+				sum += *(int *)it.val;
+		}
+		total += sum;
+	}
+	double query_elapsed = now() - start;
+
+	printf("%s: insert %.2f Mops/s, %.2f us per range (total %ld)\n", name,
+	       N / insert_elapsed / 1e6, query_elapsed / QUERIES * 1e6, total);
+	map->destroy(map);
+}
+
+int main(void) {
+	cmap_data_t key_interface =
+		CREATE_INLINE_INTERFACE(int_cmp, int_size_get, sizeof(int));
+	cmap_data_t val_interface =
+		CREATE_INLINE_INTERFACE(NULL, int_size_get, sizeof(int));
+	cmap_option_t option = {.aug_size = sizeof(long),
+				.aug_lift = sum_lift,
+				.aug_combine = sum_combine};
+
+	int *keys = malloc(sizeof(int) * N), *vals = malloc(sizeof(int) * N);
+	srand(1);
+	for (int i = 0; i < N; i++) {
+		keys[i] = rand();
+		vals[i] = rand() % 4096;
+	}
+
+	cmap_t plain = cmap_init(&key_interface, &val_interface);
+	run("scan", &plain, keys, vals, false);
+	cmap_t map = cmap_init3(&key_interface, &val_interface, &option);
+	run("aggregate_range", &map, keys, vals, true);
+
+	free(keys);
+	free(vals);
+	return 0;
+}
@@ -0,0 +1,70 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "cmap.h"
+
+/*
+ * A benchmark of inserting increasing keys (timestamps, sequence numbers).
+ * N increasing keys are inserted by insert() and by insert_hint() with the
+ * end iterator, then N random keys by insert() for comparsion. The throughput
+ * and the calls of cmp() per insertion are reported.
+ */
+#define N (1 << 22)
+
+long cmp_calls;
+
+int int_cmp(const void *d1, const void *d2) {
+	const int *int1 = d1, *int2 = d2;
+	cmp_calls++;
+	return (*int1 > *int2) - (*int1 < *int2);
+}
+
+size_t int_size_get(const void *d1) {
+	return sizeof(int);
+}
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void run(const char *name, cmap_data_t *key_interface,
+		cmap_data_t *val_interface, int *keys, bool hinted) {
+	cmap_t map = cmap_init(key_interface, val_interface);
+	cmp_calls = 0;
+	double start = now();
+	for (int i = 0; i < N; i++) {
+		if (hinted)
+			map.insert_hint(&map, map.end(&map), &keys[i], &i);
+		else
+			map.insert(&map, &keys[i], &i);
+	}
+	double elapsed = now() - start;
+	printf("%s: %.2f Mops/s, %.1f cmp() per insertion\n", name,
+	       N / elapsed / 1e6, (double)cmp_calls / N);
+	map.destroy(&map);
+}
+
+int main(void) {
+	cmap_data_t key_interface =
+		CREATE_INLINE_INTERFACE(int_cmp, int_size_get, sizeof(int));
+	cmap_data_t val_interface =
+		CREATE_INLINE_INTERFACE(NULL, int_size_get, sizeof(int));
+
+	int *keys = malloc(sizeof(int) * N);
+	for (int i = 0; i < N; i++)
+		keys[i] = i;
+	run("increasing insert", &key_interface, &val_interface, keys, false);
+	run("increasing insert_hint", &key_interface, &val_interface, keys, true);
+
+	srand(1);
+	for (int i = 0; i < N; i++)
+		keys[i] = rand();
+	run("random insert", &key_interface, &val_interface, keys, false);
+
+	free(keys);
+	return 0;
+}
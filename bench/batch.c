@@ -0,0 +1,78 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "cmap.h"
+
+/*
+ * A benchmark of the batched insertion.
+ * A map is loaded with N random keys, then batches of random updates (half
+ * of them to existing keys) are applied by insert_batch() or by insert()
+ * key by key, and the updates per second are reported for several batch sizes.
+ */
+#define N (1 << 20)
+#define UPDATES (1 << 20)
+
+int int_cmp(const void *d1, const void *d2) {
+	const int *int1 = d1, *int2 = d2;
+	return (*int1 > *int2) - (*int1 < *int2);
+}
+
+size_t int_size_get(const void *d1) {
+	return sizeof(int);
+}
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int *numbers;
+const void **keys;
+
+static double run(cmap_data_t *key_interface, cmap_data_t *val_interface,
+		  size_t batch, bool batched) {
+	cmap_t map = cmap_init(key_interface, val_interface);
+	for (int i = 0; i < N; i++)
+		map.insert(&map, keys[i], keys[i]);
+
+	double start = now();
+	for (size_t i = N; i < N + UPDATES; i += batch) {
+		if (batched) {
+			map.insert_batch(&map, &keys[i], &keys[i], batch);
+			continue;
+		}
+		for (size_t j = i; j < i + batch; j++)
+			map.insert(&map, keys[j], keys[j]);
+	}
+	double elapsed = now() - start;
+
+	map.destroy(&map);
+	return UPDATES / elapsed / 1e6;
+}
+
+int main(void) {
+	cmap_data_t key_interface =
+		CREATE_INLINE_INTERFACE(int_cmp, int_size_get, sizeof(int));
+	cmap_data_t val_interface =
+		CREATE_INLINE_INTERFACE(NULL, int_size_get, sizeof(int));
+
+	numbers = malloc(sizeof(int) * (N + UPDATES));
+	keys = malloc(sizeof(void *) * (N + UPDATES));
+	srand(1);
+	for (int i = 0; i < N + UPDATES; i++) {
+		numbers[i] = i >= N && i % 2 ? numbers[rand() % N] : rand();
+		keys[i] = &numbers[i];
+	}
+
+	for (size_t batch = 1024; batch <= 65536; batch *= 8)
+		printf("batch %6zu: insert_batch %.2f Mops/s, insert %.2f Mops/s\n", batch,
+		       run(&key_interface, &val_interface, batch, true),
+		       run(&key_interface, &val_interface, batch, false));
+
+	free(keys);
+	free(numbers);
+	return 0;
+}
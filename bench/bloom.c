@@ -0,0 +1,67 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "cmap.h"
+
+/*
+ * A benchmark of the Bloom filter for missing keys.
+ * A cmap of N random int64 keys runs searches where 90% of the keys are missing,
+ * with and without the bloom_filter option (and with the hash_index option), and
+ * then a churn of erases and inserts which makes the filter rebuilt. The memory and
+ * the false-positive rate of the filter reported by stats() are printed.
+ */
+#define N (1 << 20)
+#define LOOKUPS (1 << 22)
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void run(const char *name, bool bloom_filter, bool hash_index, const int64_t *keys) {
+	cmap_data_t interface = CREATE_INT64_INTERFACE();
+	cmap_option_t option = {.bloom_filter = bloom_filter, .hash_index = hash_index};
+	cmap_t map = cmap_init3(&interface, &interface, &option);
+	double start = now();
+	for (int i = 0; i < N; i++)
+		map.insert(&map, &keys[i], &keys[i]);
+	double insert_time = now() - start;
+
+	// The keys from N on are missing.
+	long found = 0;
+	start = now();
+	for (long i = 0; i < LOOKUPS; i++)
+		found += map.search(&map, &keys[i % 10 == 0 ? (i * 7919) % N : N + (i * 7919) % N]) != NULL;
+	double lookup_time = now() - start;
+
+	start = now();
+	for (int i = 0; i < N; i++) {
+		map.erase(&map, &keys[i]);
+		map.insert(&map, &keys[N + i], &keys[i]);
+	}
+	double churn_time = now() - start;
+
+	cmap_stats_t stats;
+	map.stats(&map, &stats);
+	printf("%s: insert %.2f, lookup %.2f, churn %.2f Mops/s, filter %.1f MiB, FPR %.2e (found %ld)\n",
+	       name, N / insert_time / 1e6, LOOKUPS / lookup_time / 1e6, N / churn_time / 1e6,
+	       stats.bloom_memory / 1048576.0, stats.bloom_fpr, found);
+	map.destroy(&map);
+}
+
+int main(void) {
+	int64_t *keys = malloc(sizeof(int64_t) * 2 * N);
+	srand(1);
+	for (int i = 0; i < 2 * N; i++)
+		keys[i] = ((int64_t)rand() << 31) ^ rand();
+	run("tree", false, false, keys);
+	run("tree + Bloom filter", true, false, keys);
+	run("hash index", false, true, keys);
+	run("hash index + Bloom filter", true, true, keys);
+	free(keys);
+	return 0;
+}
@@ -0,0 +1,73 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "cmap.h"
+
+/*
+ * A benchmark of interned string keys.
+ * N strings of a long-lived table are inserted as keys copied by the cmap and
+ * as borrowed keys, then all of them are searched and erased.
+ */
+#define N (1 << 20)
+#define LENGTH 32
+
+int str_cmp(const void *d1, const void *d2) {
+	return strcmp(d1, d2);
+}
+
+size_t str_size_get(const void *d1) {
+	return strlen(d1) + 1;
+}
+
+size_t int_size_get(const void *d1) {
+	return sizeof(int);
+}
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void run(const char *name, cmap_data_t *key_interface, cmap_data_t *val_interface,
+		char (*strings)[LENGTH]) {
+	cmap_t map = cmap_init(key_interface, val_interface);
+	double start = now();
+	for (int i = 0; i < N; i++)
+		map.insert(&map, strings[i], &i);
+	double insert_elapsed = now() - start;
+
+	start = now();
+	long found = 0;
+	for (int i = 0; i < N; i++)
+		found += map.search(&map, strings[i]) != NULL;
+	double search_elapsed = now() - start;
+
+	start = now();
+	for (int i = 0; i < N; i++)
+		map.erase(&map, strings[i]);
+	double erase_elapsed = now() - start;
+
+	printf("%s: insert %.2f Mops/s, search %.2f Mops/s, erase %.2f Mops/s (%ld)\n", name,
+	       N / insert_elapsed / 1e6, N / search_elapsed / 1e6, N / erase_elapsed / 1e6, found);
+	map.destroy(&map);
+}
+
+int main(void) {
+	cmap_data_t copied_interface = CREATE_INTERFACE(str_cmp, str_size_get);
+	cmap_data_t borrowed_interface = CREATE_BORROWED_INTERFACE(str_cmp);
+	cmap_data_t val_interface =
+		CREATE_INLINE_INTERFACE(NULL, int_size_get, sizeof(int));
+
+	char (*strings)[LENGTH] = malloc(sizeof(*strings) * N);
+	srand(1);
+	for (int i = 0; i < N; i++)
+		snprintf(strings[i], LENGTH, "user/%08x/session/%d", rand(), i);
+	run("copied", &copied_interface, &val_interface, strings);
+	run("borrowed", &borrowed_interface, &val_interface, strings);
+
+	free(strings);
+	return 0;
+}
@@ -0,0 +1,83 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "cmap.h"
+
+/*
+ * A benchmark of the B-tree mode against the red-black tree.
+ * N integer keys stored inline are inserted, searched in random order, walked by
+ * the iterators and erased, where the keys are random or sequential.
+ */
+#define N (1 << 20)
+#define LOOKUPS (1 << 21)
+
+int int_cmp(const void *d1, const void *d2) {
+	const int *int1 = d1, *int2 = d2;
+	return (*int1 > *int2) - (*int1 < *int2);
+}
+
+size_t int_size_get(const void *d1) {
+	return sizeof(int);
+}
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void run(const char *name, cmap_data_t *key_interface, cmap_data_t *val_interface,
+		bool btree, int *keys) {
+	cmap_option_t option = {.btree = btree};
+	cmap_t map = cmap_init3(key_interface, val_interface, &option);
+
+	double start = now();
+	for (int i = 0; i < N; i++)
+		map.insert(&map, &keys[i], &i);
+	double insert_time = now() - start;
+
+	long sum = 0;
+	start = now();
+	for (int i = 0; i < LOOKUPS; i++)
+		sum += *(int *)map.search(&map, &keys[(i * 7919L) % N]);
+	double lookup_time = now() - start;
+
+	start = now();
+	for (cmap_iter_t it = map.begin(&map); it.node != NULL; it = map.next(&map, it))
+		sum += *(const int *)it.key;
+	double walk_time = now() - start;
+
+	start = now();
+	for (int i = 0; i < N; i++)
+		map.erase(&map, &keys[(i * 7919L) % N]);
+	double erase_time = now() - start;
+
+	printf("%s: insert %.2f, lookup %.2f, walk %.1f, erase %.2f Mops/s (checksum %ld)\n",
+	       name, N / insert_time / 1e6, LOOKUPS / lookup_time / 1e6, N / walk_time / 1e6,
+	       N / erase_time / 1e6, sum);
+	map.destroy(&map);
+}
+
+int main(void) {
+	cmap_data_t key_interface = CREATE_INLINE_INTERFACE(int_cmp, int_size_get, sizeof(int));
+	cmap_data_t val_interface = CREATE_INLINE_INTERFACE(NULL, int_size_get, sizeof(int));
+
+	int *keys = malloc(sizeof(int) * N);
+	for (int i = 0; i < N; i++)
+		keys[i] = i;
+	run("sequential red-black", &key_interface, &val_interface, false, keys);
+	run("sequential B-tree", &key_interface, &val_interface, true, keys);
+	srand(1);
+	for (int i = N - 1; i > 0; i--) {
+		int j = rand() % (i + 1), tmp = keys[i];
+		keys[i] = keys[j];
+		keys[j] = tmp;
+	}
+	run("random red-black", &key_interface, &val_interface, false, keys);
+	run("random B-tree", &key_interface, &val_interface, true, keys);
+
+	free(keys);
+	return 0;
+}
@@ -0,0 +1,62 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "cmap.h"
+
+/*
+ * A benchmark of loading sorted keys.
+ * N sorted integer keys are loaded into an empty cmap either by insert()
+ * key by key or by build_sorted(), and the loading time is reported.
+ */
+#define N (1 << 22)
+
+int int_cmp(const void *d1, const void *d2) {
+	const int *int1 = d1, *int2 = d2;
+	return (*int1 > *int2) - (*int1 < *int2);
+}
+
+size_t int_size_get(const void *d1) {
+	return sizeof(int);
+}
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(void) {
+	cmap_data_t key_interface =
+		CREATE_INLINE_INTERFACE(int_cmp, int_size_get, sizeof(int));
+	cmap_data_t val_interface =
+		CREATE_INLINE_INTERFACE(NULL, int_size_get, sizeof(int));
+
+	int *numbers = malloc(sizeof(int) * N);
+	const void **keys = malloc(sizeof(void *) * N);
+	for (int i = 0; i < N; i++) {
+		numbers[i] = i;
+		keys[i] = &numbers[i];
+	}
+
+	cmap_t map = cmap_init(&key_interface, &val_interface);
+	double start = now();
+	for (int i = 0; i < N; i++)
+		map.insert(&map, keys[i], keys[i]);
+	double insert_time = now() - start;
+	map.destroy(&map);
+
+	cmap_t built_map = cmap_init(&key_interface, &val_interface);
+	start = now();
+	built_map.build_sorted(&built_map, keys, keys, N);
+	double build_time = now() - start;
+	built_map.destroy(&built_map);
+
+	printf("%d sorted keys: insert %.3f s, build_sorted %.3f s (%.1fx)\n", N,
+	       insert_time, build_time, insert_time / build_time);
+
+	free(keys);
+	free(numbers);
+	return 0;
+}
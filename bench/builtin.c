@@ -0,0 +1,87 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "cmap.h"
+
+/*
+ * A benchmark of the built-in interfaces against the interfaces given by user.
+ * N random string keys (allocated, as in test/main.c) and N random int64 keys are
+ * inserted and searched in random order, where the user interfaces compare keys by
+ * strcmp() and a function through the pointer, and the built-in interfaces compare
+ * the cached prefixes of the strings and the integers without the indirect call.
+ */
+#define N (1 << 18)
+#define LOOKUPS (1 << 21)
+
+int str_cmp(const void *d1, const void *d2) {
+	return strcmp(d1, d2);
+}
+
+size_t str_size_get(const void *d1) {
+	return strlen(d1) + 1;
+}
+
+int i64_cmp(const void *d1, const void *d2) {
+	const int64_t *i1 = d1, *i2 = d2;
+	return (*i1 > *i2) - (*i1 < *i2);
+}
+
+size_t i64_size_get(const void *d1) {
+	return sizeof(int64_t);
+}
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void run(const char *name, cmap_data_t *key_interface, cmap_data_t *val_interface,
+		const void *const *keys) {
+	cmap_t map = cmap_init(key_interface, val_interface);
+	int64_t val = 1, sum = 0;
+	double start = now();
+	for (int i = 0; i < N; i++)
+		map.insert(&map, keys[i], &val);
+	double insert_time = now() - start;
+	start = now();
+	for (int i = 0; i < LOOKUPS; i++)
+		sum += *(int64_t *)map.search(&map, keys[(i * 7919L) % N]);
+	double lookup_time = now() - start;
+	printf("%s: insert %.2f, lookup %.2f Mops/s (checksum %lld)\n", name,
+	       N / insert_time / 1e6, LOOKUPS / lookup_time / 1e6, (long long)sum);
+	map.destroy(&map);
+}
+
+int main(void) {
+	cmap_data_t str_interface = CREATE_INTERFACE(str_cmp, str_size_get);
+	cmap_data_t i64_interface = CREATE_INLINE_INTERFACE(i64_cmp, i64_size_get, sizeof(int64_t));
+	cmap_data_t builtin_str_interface = CREATE_STRING_INTERFACE();
+	cmap_data_t builtin_i64_interface = CREATE_INT64_INTERFACE();
+	char (*strs)[32] = malloc(sizeof(*strs) * N);
+	int64_t *ints = malloc(sizeof(int64_t) * N);
+	const void **keys = malloc(sizeof(void *) * N);
+
+	srand(1);
+	for (int i = 0; i < N; i++) {
+		snprintf(strs[i], sizeof(strs[i]), "%08x:user:%d", (unsigned)rand(), i);
+		keys[i] = strs[i];
+	}
+	run("strcmp strings", &str_interface, &i64_interface, keys);
+	run("built-in strings", &builtin_str_interface, &i64_interface, keys);
+
+	for (int i = 0; i < N; i++) {
+		ints[i] = ((int64_t)rand() << 31) ^ rand();
+		keys[i] = &ints[i];
+	}
+	run("user int64", &i64_interface, &i64_interface, keys);
+	run("built-in int64", &builtin_i64_interface, &i64_interface, keys);
+
+	free(strs);
+	free(ints);
+	free(keys);
+	return 0;
+}
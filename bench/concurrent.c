@@ -0,0 +1,100 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "cmap.h"
+#include "cmap_concurrent.h"
+
+/*
+ * A benchmark of the read scaling of cmap_concurrent.
+ * Several threads search random keys of a shared map, and the total lookup
+ * throughput is compared between cmap_concurrent (reader/writer lock) and a
+ * cmap protected by a single mutex.
+ */
+#define N (1 << 18)
+#define LOOKUPS (1 << 20)
+#define MAX_THREADS 8
+
+int int_cmp(const void *d1, const void *d2) {
+	const int *int1 = d1, *int2 = d2;
+	return (*int1 > *int2) - (*int1 < *int2);
+}
+
+size_t int_size_get(const void *d1) {
+	return sizeof(int);
+}
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+cmap_concurrent_t *cmap;
+cmap_t *map;
+pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+int *keys;
+
+void *rwlock_reader(void *arg) {
+	long id = (long)arg, sum = 0;
+	for (long i = 0; i < LOOKUPS; i++) {
+		int val;
+		if (cmap->search(cmap, &keys[(i * 7919 + id * 104729) % N], &val))
+			sum += val;
+	}
+	return (void *)sum;
+}
+
+void *mutex_reader(void *arg) {
+	long id = (long)arg, sum = 0;
+	for (long i = 0; i < LOOKUPS; i++) {
+		pthread_mutex_lock(&mutex);
+		int *val = map->search(map, &keys[(i * 7919 + id * 104729) % N]);
+		if (val)
+			sum += *val;
+		pthread_mutex_unlock(&mutex);
+	}
+	return (void *)sum;
+}
+
+static double run(void *(*reader)(void *), int threads) {
+	pthread_t tids[MAX_THREADS];
+	double start = now();
+	for (long i = 0; i < threads; i++)
+		pthread_create(&tids[i], NULL, reader, (void *)i);
+	for (int i = 0; i < threads; i++)
+		pthread_join(tids[i], NULL);
+	return (double)LOOKUPS * threads / (now() - start) / 1e6;
+}
+
+int main(void) {
+	cmap_data_t key_interface =
+		CREATE_INLINE_INTERFACE(int_cmp, int_size_get, sizeof(int));
+	cmap_data_t val_interface =
+		CREATE_INLINE_INTERFACE(NULL, int_size_get, sizeof(int));
+
+	cmap = cmap_concurrent_alloc(&key_interface, &val_interface);
+	map = cmap_alloc(&key_interface, &val_interface);
+
+	keys = malloc(sizeof(int) * N);
+	srand(1);
+	for (int i = 0; i < N; i++) {
+		keys[i] = rand();
+		cmap->insert(cmap, &keys[i], &i);
+		map->insert(map, &keys[i], &i);
+	}
+
+	for (int threads = 1; threads <= MAX_THREADS; threads *= 2)
+		printf("%d threads: rwlock %.2f Mops/s, mutex %.2f Mops/s\n",
+		       threads, run(rwlock_reader, threads),
+		       run(mutex_reader, threads));
+
+	cmap->destroy(cmap);
+	cmap->dealloc(cmap);
+	map->destroy(map);
+	map->dealloc(map);
+	free(keys);
+	return 0;
+}
@@ -0,0 +1,83 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "cmap.h"
+
+/*
+ * A benchmark of counters (events per key).
+ * N random events over K keys are counted by search() then insert() of the
+ * incremented value, and by upsert(). The values are stored both inline and
+ * allocated separately, and the calls of cmp() per event are reported.
+ */
+#define N (1 << 22)
+#define K (1 << 16)
+
+long cmp_calls;
+
+int int_cmp(const void *d1, const void *d2) {
+	const int *int1 = d1, *int2 = d2;
+	cmp_calls++;
+	return (*int1 > *int2) - (*int1 < *int2);
+}
+
+size_t int_size_get(const void *d1) {
+	return sizeof(int);
+}
+
+size_t long_size_get(const void *d1) {
+	return sizeof(long);
+}
+
+void long_add(void *val, const void *delta) {
+	*(long *)val += *(const long *)delta;
+}
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void run(const char *name, cmap_data_t *key_interface, cmap_data_t *val_interface,
+		int *keys, int method) {
+	cmap_t map = cmap_init(key_interface, val_interface);
+	long one = 1;
+	cmp_calls = 0;
+	double start = now();
+	for (int i = 0; i < N; i++) {
+		if (method == 0) {
+			long *val = map.search(&map, &keys[i]);
+			long count = val == NULL ? 1 : *val + 1;
+			map.insert(&map, &keys[i], &count);
+		}
+		else {
+			map.upsert(&map, &keys[i], &one, long_add);
+		}
+	}
+	double elapsed = now() - start;
+	printf("%s: %.2f Mops/s, %.1f cmp() per event\n", name, N / elapsed / 1e6,
+	       (double)cmp_calls / N);
+	map.destroy(&map);
+}
+
+int main(void) {
+	cmap_data_t key_interface =
+		CREATE_INLINE_INTERFACE(int_cmp, int_size_get, sizeof(int));
+	cmap_data_t inline_interface =
+		CREATE_INLINE_INTERFACE(NULL, long_size_get, sizeof(long));
+	cmap_data_t val_interface = CREATE_INTERFACE(NULL, long_size_get);
+
+	int *keys = malloc(sizeof(int) * N);
+	srand(1);
+	for (int i = 0; i < N; i++)
+		keys[i] = rand() % K;
+	run("inline search + insert", &key_interface, &inline_interface, keys, 0);
+	run("inline upsert", &key_interface, &inline_interface, keys, 1);
+	run("allocated search + insert", &key_interface, &val_interface, keys, 0);
+	run("allocated upsert", &key_interface, &val_interface, keys, 1);
+
+	free(keys);
+	return 0;
+}
@@ -0,0 +1,66 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "cmap.h"
+
+/*
+ * A benchmark of the hash index against the tree alone.
+ * A cmap of N random int64 keys runs a mix of 95% exact-key searches, 5% inserts
+ * and erases and a few short range scans, with and without the hash_index option,
+ * and the memory reported by stats() is printed for both.
+ */
+#define N (1 << 20)
+#define OPS (1 << 22)
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void run(const char *name, bool hash_index, const int64_t *keys) {
+	cmap_data_t interface = CREATE_INT64_INTERFACE();
+	cmap_option_t option = {.hash_index = hash_index};
+	cmap_t map = cmap_init3(&interface, &interface, &option);
+	for (int i = 0; i < N; i++)
+		map.insert(&map, &keys[i], &keys[i]);
+
+	int64_t sum = 0;
+	double start = now();
+	for (long i = 0; i < OPS; i++) {
+		const int64_t *key = &keys[(i * 7919) % N];
+		if (i % 20 == 0) {
+			map.erase(&map, key);
+			map.insert(&map, key, key);
+		}
+		else if (i % 4096 == 1) {
+			cmap_iter_t it = map.lower_bound(&map, key);
+			for (int j = 0; j < 16 && it.node != NULL; j++, it = map.next(&map, it))
+				sum += *(const int64_t *)it.key;
+		}
+		else
+			sum += *(int64_t *)map.search(&map, key);
+	}
+	double time = now() - start;
+
+	cmap_stats_t stats;
+	map.stats(&map, &stats);
+	printf("%s: %.2f Mops/s, nodes %.1f MiB, index %.1f MiB (%zu slots) (checksum %lld)\n", name,
+	       OPS / time / 1e6, stats.node_memory / 1048576.0, stats.index_memory / 1048576.0,
+	       stats.index_capacity, (long long)sum);
+	map.destroy(&map);
+}
+
+int main(void) {
+	int64_t *keys = malloc(sizeof(int64_t) * N);
+	srand(1);
+	for (int i = 0; i < N; i++)
+		keys[i] = ((int64_t)rand() << 31) ^ rand();
+	run("tree", false, keys);
+	run("hash index", true, keys);
+	free(keys);
+	return 0;
+}
@@ -0,0 +1,83 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "cmap.h"
+
+/*
+ * A benchmark of overlap queries (reservations of [start, end)).
+ * N reservations with random lengths are keyed by their starts in a map of the
+ * interval mode, then the reservations overlapping random ranges are counted by
+ * walking all keys or by interval_overlaps().
+ */
+#define N (1 << 20)
+#define QUERIES (1 << 14)
+#define SCAN_QUERIES 16
+
+int int_cmp(const void *d1, const void *d2) {
+	const int *int1 = d1, *int2 = d2;
+	return (*int1 > *int2) - (*int1 < *int2);
+}
+
+size_t int_size_get(const void *d1) {
+	return sizeof(int);
+}
+
+const void *reservation_end(const void *key, const void *val) {
+	return val;
+}
+
+bool count(const void *key, void *val, void *arg) {
+	(*(long *)arg)++;
+	return true;
+}
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(void) {
+	cmap_data_t key_interface =
+		CREATE_INLINE_INTERFACE(int_cmp, int_size_get, sizeof(int));
+	cmap_data_t val_interface =
+		CREATE_INLINE_INTERFACE(NULL, int_size_get, sizeof(int));
+	cmap_option_t option = {.interval_end = reservation_end};
+	cmap_t map = cmap_init3(&key_interface, &val_interface, &option);
+
+	srand(1);
+	double start = now();
+	for (int i = 0; i < N; i++) {
+		int key = rand() % (N * 16), end = key + 1 + rand() % (i % 100 ? 64 : 65536);
+		map.insert(&map, &key, &end);
+	}
+	printf("insert: %.2f Mops/s\n", N / (now() - start) / 1e6);
+
+	long found = 0;
+	start = now();
+	for (int i = 0; i < SCAN_QUERIES; i++) {
+		int low = rand() % (N * 16), high = low + 256;
+		for (cmap_iter_t it = map.begin(&map); it.node != NULL; it = map.next(&map, it)) {
+			if (*(const int *)it.key < high && *(int *)it.val > low)
+				found++;
+		}
+	}
+	double elapsed = now() - start;
+	printf("scan: %.2f us per query (%.1f overlaps)\n", elapsed / SCAN_QUERIES * 1e6,
+	       (double)found / SCAN_QUERIES);
+
+	found = 0;
+	start = now();
+	for (int i = 0; i < QUERIES; i++) {
+		int low = rand() % (N * 16), high = low + 256;
+		map.interval_overlaps(&map, &low, &high, count, &found);
+	}
+	elapsed = now() - start;
+	printf("interval_overlaps: %.2f us per query (%.1f overlaps)\n", elapsed / QUERIES * 1e6,
+	       (double)found / QUERIES);
+
+	map.destroy(&map);
+	return 0;
+}
@@ -0,0 +1,75 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "cmap.h"
+
+/*
+ * A benchmark of the lookup throughput of cmap.
+ * It inserts N random integer keys, then searches them in random order
+ * and reports the million lookups per second.
+ * It runs twice: the keys and values are allocated separately at first,
+ * then they are stored inline in the cmap nodes.
+ */
+#define N (1 << 20)
+#define LOOKUPS (1 << 21)
+
+int int_cmp(const void *d1, const void *d2) {
+	const int *int1 = d1, *int2 = d2;
+	return (*int1 > *int2) - (*int1 < *int2);
+}
+
+size_t int_size_get(const void *d1) {
+	return sizeof(int);
+}
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void run(const char *name, cmap_data_t *key_interface,
+		cmap_data_t *val_interface, int *keys) {
+	cmap_t map = cmap_init(key_interface, val_interface);
+
+	double start = now();
+	for (int i = 0; i < N; i++)
+		map.insert(&map, &keys[i], &i);
+	double insert_time = now() - start;
+
+	long sum = 0;
+	start = now();
+	for (int i = 0; i < LOOKUPS; i++) {
+		int *val = map.search(&map, &keys[(i * 7919L) % N]);
+		sum += *val;
+	}
+	double lookup_time = now() - start;
+
+	printf("%s insert: %.2f Mops/s\n", name, N / insert_time / 1e6);
+	printf("%s lookup: %.2f Mops/s (checksum %ld)\n", name,
+	       LOOKUPS / lookup_time / 1e6, sum);
+
+	map.destroy(&map);
+}
+
+int main(void) {
+	cmap_data_t key_interface = CREATE_INTERFACE(int_cmp, int_size_get);
+	cmap_data_t val_interface = CREATE_INTERFACE(NULL, int_size_get);
+	cmap_data_t inline_key_interface =
+		CREATE_INLINE_INTERFACE(int_cmp, int_size_get, sizeof(int));
+	cmap_data_t inline_val_interface =
+		CREATE_INLINE_INTERFACE(NULL, int_size_get, sizeof(int));
+
+	int *keys = malloc(sizeof(int) * N);
+	srand(1);
+	for (int i = 0; i < N; i++)
+		keys[i] = rand();
+
+	run("allocated", &key_interface, &val_interface, keys);
+	run("inline", &inline_key_interface, &inline_val_interface, keys);
+
+	free(keys);
+	return 0;
+}
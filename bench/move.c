@@ -0,0 +1,126 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "cmap.h"
+
+/*
+ * A benchmark of large values (linked lists like adv/adv2.c).
+ * N lists of LENGTH nodes are built by user, then inserted by insert() and
+ * released by user, or moved into the cmap by insert_move(). Afterwards, they
+ * are taken back by search() with a copy and erase(), or by extract().
+ */
+#define N (1 << 16)
+#define LENGTH 64
+
+struct list_node {
+	int val;
+	struct list_node *next;
+};
+
+struct list {
+	struct list_node *head;
+};
+
+int int_cmp(const void *d1, const void *d2) {
+	const int *int1 = d1, *int2 = d2;
+	return (*int1 > *int2) - (*int1 < *int2);
+}
+
+size_t int_size_get(const void *d1) {
+	return sizeof(int);
+}
+
+size_t list_size_get(const void *list) {
+	return sizeof(struct list);
+}
+
+void *list_copy(void *dest, const void *src, size_t size) {
+	struct list_node **tail = &((struct list *)dest)->head;
+	for (struct list_node *ptr = ((const struct list *)src)->head; ptr != NULL;
+	     ptr = ptr->next) {
+		*tail = calloc(1, sizeof(struct list_node));
+		(*tail)->val = ptr->val;
+		tail = &(*tail)->next;
+	}
+	return dest;
+}
+
+void list_destroy(void *list_ptr) {
+	struct list *list = list_ptr;
+	while (list->head != NULL) {
+		struct list_node *next = list->head->next;
+		free(list->head);
+		list->head = next;
+	}
+}
+
+struct list *list_alloc(int first) {
+	struct list *list = calloc(1, sizeof(struct list));
+	for (int i = LENGTH - 1; i >= 0; i--) {
+		struct list_node *node = malloc(sizeof(struct list_node));
+		*node = (struct list_node){.val = first + i, .next = list->head};
+		list->head = node;
+	}
+	return list;
+}
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void run(const char *name, cmap_data_t *key_interface, cmap_data_t *val_interface,
+		bool move) {
+	cmap_t map = cmap_init(key_interface, val_interface);
+	double start = now();
+	for (int key = 0; key < N; key++) {
+		struct list *list = list_alloc(key);
+		if (move) {
+			int *moved_key = malloc(sizeof(int));
+			*moved_key = key;
+			map.insert_move(&map, moved_key, list);
+		}
+		else {
+			map.insert(&map, &key, list);
+			list_destroy(list);
+			free(list);
+		}
+	}
+	double insert_elapsed = now() - start;
+
+	long sum = 0;
+	start = now();
+	for (int key = 0; key < N; key++) {
+		struct list *list;
+		if (move) {
+			void *key_out;
+			map.extract(&map, &key, &key_out, (void **)&list);
+			free(key_out);
+		}
+		else {
+			list = calloc(1, sizeof(struct list));
+			list_copy(list, map.search(&map, &key), sizeof(struct list));
+			map.erase(&map, &key);
+		}
+		sum += list->head->val;
+		list_destroy(list);
+		free(list);
+	}
+	double take_elapsed = now() - start;
+
+	printf("%s: insert %.3f Mops/s, take back %.3f Mops/s (%ld)\n", name,
+	       N / insert_elapsed / 1e6, N / take_elapsed / 1e6, sum);
+	map.destroy(&map);
+}
+
+int main(void) {
+	cmap_data_t key_interface = CREATE_INTERFACE(int_cmp, int_size_get);
+	cmap_data_t val_interface =
+		CREATE_INTERFACE4(NULL, list_size_get, list_copy, list_destroy);
+	run("copy", &key_interface, &val_interface, false);
+	run("move", &key_interface, &val_interface, true);
+	return 0;
+}
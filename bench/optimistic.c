@@ -0,0 +1,126 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "cmap.h"
+#include "cmap_concurrent.h"
+
+/*
+ * A benchmark of the lock-free readers of cmap_optimistic.
+ * Several threads search random keys of a shared map while one writer keeps
+ * updating keys, and the total lookup throughput is compared between
+ * cmap_optimistic (no lock for readers) and cmap_concurrent (reader/writer lock).
+ */
+#define N (1 << 18)
+#define LOOKUPS (1 << 20)
+#define MAX_THREADS 8
+
+int int_cmp(const void *d1, const void *d2) {
+	const int *int1 = d1, *int2 = d2;
+	return (*int1 > *int2) - (*int1 < *int2);
+}
+
+size_t int_size_get(const void *d1) {
+	return sizeof(int);
+}
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+cmap_optimistic_t *ocmap;
+cmap_concurrent_t *cmap;
+int *keys;
+int stop;
+long updates;
+
+void *optimistic_reader(void *arg) {
+	long id = (long)arg, sum = 0;
+	cmap_reader_t *slot = ocmap->reader_register(ocmap);
+	for (long i = 0; i < LOOKUPS; i++) {
+		int val;
+		if (ocmap->search(ocmap, slot, &keys[(i * 7919 + id * 104729) % N], &val))
+			sum += val;
+	}
+	ocmap->reader_unregister(ocmap, slot);
+	return (void *)sum;
+}
+
+void *rwlock_reader(void *arg) {
+	long id = (long)arg, sum = 0;
+	for (long i = 0; i < LOOKUPS; i++) {
+		int val;
+		if (cmap->search(cmap, &keys[(i * 7919 + id * 104729) % N], &val))
+			sum += val;
+	}
+	return (void *)sum;
+}
+
+void *optimistic_writer(void *arg) {
+	long i;
+	for (i = 0; !__atomic_load_n(&stop, __ATOMIC_RELAXED); i++)
+		ocmap->insert(ocmap, &keys[(i * 31) % N], &i);
+	return (void *)i;
+}
+
+void *rwlock_writer(void *arg) {
+	long i;
+	for (i = 0; !__atomic_load_n(&stop, __ATOMIC_RELAXED); i++)
+		cmap->insert(cmap, &keys[(i * 31) % N], &i);
+	return (void *)i;
+}
+
+static double run(void *(*reader)(void *), void *(*writer)(void *), int threads) {
+	pthread_t tids[MAX_THREADS], wid;
+	stop = 0;
+	pthread_create(&wid, NULL, writer, NULL);
+	double start = now();
+	for (long i = 0; i < threads; i++)
+		pthread_create(&tids[i], NULL, reader, (void *)i);
+	for (int i = 0; i < threads; i++)
+		pthread_join(tids[i], NULL);
+	double elapsed = now() - start;
+	__atomic_store_n(&stop, 1, __ATOMIC_RELAXED);
+	void *written;
+	pthread_join(wid, &written);
+	updates = (long)written;
+	return (double)LOOKUPS * threads / elapsed / 1e6;
+}
+
+int main(void) {
+	cmap_data_t key_interface =
+		CREATE_INLINE_INTERFACE(int_cmp, int_size_get, sizeof(int));
+	cmap_data_t val_interface =
+		CREATE_INLINE_INTERFACE(NULL, int_size_get, sizeof(int));
+
+	ocmap = cmap_optimistic_alloc(&key_interface, &val_interface);
+	cmap = cmap_concurrent_alloc(&key_interface, &val_interface);
+
+	keys = malloc(sizeof(int) * N);
+	srand(1);
+	for (int i = 0; i < N; i++) {
+		keys[i] = rand();
+		ocmap->insert(ocmap, &keys[i], &i);
+		cmap->insert(cmap, &keys[i], &i);
+	}
+
+	for (int threads = 1; threads <= MAX_THREADS; threads *= 2) {
+		double optimistic = run(optimistic_reader, optimistic_writer, threads);
+		long optimistic_updates = updates;
+		double rwlock = run(rwlock_reader, rwlock_writer, threads);
+		printf("%d readers + 1 writer: optimistic %.2f Mops/s (%ld updates), "
+		       "rwlock %.2f Mops/s (%ld updates)\n",
+		       threads, optimistic, optimistic_updates, rwlock, updates);
+	}
+
+	ocmap->destroy(ocmap);
+	ocmap->dealloc(ocmap);
+	cmap->destroy(cmap);
+	cmap->dealloc(cmap);
+	free(keys);
+	return 0;
+}
@@ -0,0 +1,66 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "cmap.h"
+
+/*
+ * A benchmark of erasing ranges of keys.
+ * The keys 0 to N - 1 are inserted, then RANGES disjoint ranges of WIDTH
+ * keys are erased either by erase_range() or by erase() key by key, and
+ * the erased keys per second are reported for several widths.
+ */
+#define N (1 << 20)
+#define RANGES 1024
+
+int int_cmp(const void *d1, const void *d2) {
+	const int *int1 = d1, *int2 = d2;
+	return (*int1 > *int2) - (*int1 < *int2);
+}
+
+size_t int_size_get(const void *d1) {
+	return sizeof(int);
+}
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double run(cmap_data_t *key_interface, cmap_data_t *val_interface,
+		  int width, bool by_range) {
+	cmap_t map = cmap_init(key_interface, val_interface);
+	for (int i = 0; i < N; i++)
+		map.insert(&map, &i, &i);
+
+	size_t erased = 0;
+	double start = now();
+	for (int i = 0; i < RANGES; i++) {
+		int low = (int)((long)i * N / RANGES), high = low + width;
+		if (by_range) {
+			erased += map.erase_range(&map, &low, &high);
+			continue;
+		}
+		for (int key = low; key < high; key++)
+			erased += map.erase(&map, &key);
+	}
+	double elapsed = now() - start;
+
+	map.destroy(&map);
+	return erased / elapsed / 1e6;
+}
+
+int main(void) {
+	cmap_data_t key_interface =
+		CREATE_INLINE_INTERFACE(int_cmp, int_size_get, sizeof(int));
+	cmap_data_t val_interface =
+		CREATE_INLINE_INTERFACE(NULL, int_size_get, sizeof(int));
+
+	for (int width = 1; width <= 1024; width *= 8)
+		printf("width %4d: erase_range %.2f Mkeys/s, erase %.2f Mkeys/s\n", width,
+		       run(&key_interface, &val_interface, width, true),
+		       run(&key_interface, &val_interface, width, false));
+	return 0;
+}
@@ -0,0 +1,77 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "cmap.h"
+
+/*
+ * A benchmark of order statistics (percentiles, leaderboards).
+ * N random keys are inserted into a plain map and a map of the order statistics
+ * mode, then percentiles are selected and random keys are ranked. The plain map
+ * walks the keys, so it runs far fewer queries.
+ */
+#define N (1 << 20)
+#define QUERIES (1 << 20)
+#define PLAIN_QUERIES 256
+
+int int_cmp(const void *d1, const void *d2) {
+	const int *int1 = d1, *int2 = d2;
+	return (*int1 > *int2) - (*int1 < *int2);
+}
+
+size_t int_size_get(const void *d1) {
+	return sizeof(int);
+}
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void run(const char *name, cmap_t *map, int *keys, int queries) {
+	double start = now();
+	for (int i = 0; i < N; i++)
+		map->insert(map, &keys[i], &i);
+	double insert_elapsed = now() - start;
+
+	size_t size = map->size(map), sum = 0;
+	start = now();
+	for (int i = 0; i < queries; i++) {
+		cmap_iter_t it = map->select(map, (size_t)rand() % size);
+		sum += *(const int *)it.key & 1;
+	}
+	double select_elapsed = now() - start;
+
+	start = now();
+	for (int i = 0; i < queries; i++)
+		sum += map->rank(map, &keys[rand() % N]) & 1;
+	double rank_elapsed = now() - start;
+
+	printf("%s: insert %.2f Mops/s, select %.2f us, rank %.2f us per query (%zu)\n", name,
+	       N / insert_elapsed / 1e6, select_elapsed / queries * 1e6,
+	       rank_elapsed / queries * 1e6, sum);
+	map->destroy(map);
+}
+
+int main(void) {
+	cmap_data_t key_interface =
+		CREATE_INLINE_INTERFACE(int_cmp, int_size_get, sizeof(int));
+	cmap_data_t val_interface =
+		CREATE_INLINE_INTERFACE(NULL, int_size_get, sizeof(int));
+	cmap_option_t option = {.order_statistics = true};
+
+	int *keys = malloc(sizeof(int) * N);
+	srand(1);
+	for (int i = 0; i < N; i++)
+		keys[i] = rand();
+
+	cmap_t plain = cmap_init(&key_interface, &val_interface);
+	run("plain", &plain, keys, PLAIN_QUERIES);
+	cmap_t map = cmap_init3(&key_interface, &val_interface, &option);
+	run("order statistics", &map, keys, QUERIES);
+
+	free(keys);
+	return 0;
+}
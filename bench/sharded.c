@@ -0,0 +1,100 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "cmap.h"
+#include "cmap_concurrent.h"
+
+/*
+ * A benchmark of the write scaling of cmap_sharded.
+ * Several threads insert and erase random keys, and the total throughput is
+ * compared between cmap_sharded (one lock per shard) and cmap_concurrent
+ * (a single lock).
+ */
+#define N (1 << 20)
+#define SHARDS 16
+#define MAX_THREADS 8
+
+int int_cmp(const void *d1, const void *d2) {
+	const int *int1 = d1, *int2 = d2;
+	return (*int1 > *int2) - (*int1 < *int2);
+}
+
+size_t int_size_get(const void *d1) {
+	return sizeof(int);
+}
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+cmap_sharded_t *sharded;
+cmap_concurrent_t *single;
+int *keys;
+int threads_count;
+
+void *sharded_writer(void *arg) {
+	long id = (long)arg;
+	for (long i = id; i < N; i += threads_count)
+		sharded->insert(sharded, &keys[i], &i);
+	for (long i = id; i < N; i += threads_count)
+		sharded->erase(sharded, &keys[i]);
+	return NULL;
+}
+
+void *single_writer(void *arg) {
+	long id = (long)arg;
+	for (long i = id; i < N; i += threads_count)
+		single->insert(single, &keys[i], &i);
+	for (long i = id; i < N; i += threads_count)
+		single->erase(single, &keys[i]);
+	return NULL;
+}
+
+static double run(void *(*writer)(void *), int threads) {
+	pthread_t tids[MAX_THREADS];
+	threads_count = threads;
+	double start = now();
+	for (long i = 0; i < threads; i++)
+		pthread_create(&tids[i], NULL, writer, (void *)i);
+	for (int i = 0; i < threads; i++)
+		pthread_join(tids[i], NULL);
+	return 2.0 * N / (now() - start) / 1e6;
+}
+
+int main(void) {
+	cmap_data_t key_interface =
+		CREATE_INLINE_INTERFACE(int_cmp, int_size_get, sizeof(int));
+	cmap_data_t val_interface =
+		CREATE_INLINE_INTERFACE(NULL, int_size_get, sizeof(int));
+	int split_keys[SHARDS - 1];
+	const void *splits[SHARDS - 1];
+
+	keys = malloc(sizeof(int) * N);
+	srand(1);
+	for (int i = 0; i < N; i++)
+		keys[i] = rand();
+	for (int i = 0; i < SHARDS - 1; i++) {
+		split_keys[i] = (int)((double)RAND_MAX / SHARDS * (i + 1));
+		splits[i] = &split_keys[i];
+	}
+
+	sharded = cmap_sharded_alloc(&key_interface, &val_interface, SHARDS, splits);
+	single = cmap_concurrent_alloc(&key_interface, &val_interface);
+
+	for (int threads = 1; threads <= MAX_THREADS; threads *= 2)
+		printf("%d threads: sharded %.2f Mops/s, single lock %.2f Mops/s\n",
+		       threads, run(sharded_writer, threads),
+		       run(single_writer, threads));
+
+	sharded->destroy(sharded);
+	sharded->dealloc(sharded);
+	single->destroy(single);
+	single->dealloc(single);
+	free(keys);
+	return 0;
+}
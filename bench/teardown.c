@@ -0,0 +1,87 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "cmap.h"
+
+/*
+ * A benchmark of fill cycles.
+ * N keys are inserted CYCLES times, and the cmap is emptied by destroy() and
+ * cmap_init() again, or by clear() which keeps the memory of the nodes. The time
+ * of the refills and the teardowns are reported for inline, allocated and borrowed
+ * data.
+ */
+#define N (1 << 20)
+#define CYCLES 3
+
+int int_cmp(const void *d1, const void *d2) {
+	const int *int1 = d1, *int2 = d2;
+	return (*int1 > *int2) - (*int1 < *int2);
+}
+
+size_t int_size_get(const void *d1) {
+	return sizeof(int);
+}
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void run(const char *name, cmap_data_t *key_interface, cmap_data_t *val_interface,
+		int *keys, bool clear) {
+	cmap_t *map = cmap_alloc(key_interface, val_interface);
+	double fill = 0, teardown = 0;
+	for (int cycle = 0; cycle < CYCLES; cycle++) {
+		double start = now();
+		for (int i = 0; i < N; i++)
+			map->insert(map, &keys[i], &keys[i]);
+		double middle = now();
+		if (clear) {
+			map->clear(map);
+		}
+		else {
+			map->destroy(map);
+			map->dealloc(map);
+			map = cmap_alloc(key_interface, val_interface);
+		}
+		double end = now();
+		fill += middle - start;
+		teardown += end - middle;
+	}
+	printf("%s: fill %.1f ms, teardown %.1f ms per cycle\n", name, fill * 1e3 / CYCLES,
+	       teardown * 1e3 / CYCLES);
+	map->destroy(map);
+	map->dealloc(map);
+}
+
+int main(void) {
+	cmap_data_t key_interface =
+		CREATE_INLINE_INTERFACE(int_cmp, int_size_get, sizeof(int));
+	cmap_data_t inline_interface =
+		CREATE_INLINE_INTERFACE(NULL, int_size_get, sizeof(int));
+	cmap_data_t val_interface = CREATE_INTERFACE(NULL, int_size_get);
+	cmap_data_t borrowed_key_interface = CREATE_BORROWED_INTERFACE(int_cmp);
+	cmap_data_t borrowed_val_interface = CREATE_BORROWED_INTERFACE(NULL);
+
+	int *keys = malloc(sizeof(int) * N);
+	for (int i = 0; i < N; i++)
+		keys[i] = i;
+	srand(1);
+	for (int i = N - 1; i > 0; i--) {
+		int j = rand() % (i + 1), tmp = keys[i];
+		keys[i] = keys[j];
+		keys[j] = tmp;
+	}
+	run("inline destroy", &key_interface, &inline_interface, keys, false);
+	run("inline clear", &key_interface, &inline_interface, keys, true);
+	run("allocated destroy", &key_interface, &val_interface, keys, false);
+	run("allocated clear", &key_interface, &val_interface, keys, true);
+	run("borrowed destroy", &borrowed_key_interface, &borrowed_val_interface, keys, false);
+	run("borrowed clear", &borrowed_key_interface, &borrowed_val_interface, keys, true);
+
+	free(keys);
+	return 0;
+}
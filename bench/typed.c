@@ -0,0 +1,91 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "cmap.h"
+#include "cmap_define.h"
+
+/*
+ * A benchmark of the type-specialized cmap of CMAP_DEFINE() against a generic cmap.
+ * Random int64 keys with int64 values (both stored inline) are inserted, searched
+ * in random order and erased, where the generic cmap compares keys by a function
+ * pointer and the typed cmap inlines the comparsion. A small cmap fitting in the
+ * cache shows the cost of the comparsions, and a large one is bound by cache misses.
+ */
+#define N (1 << 20)
+#define SMALL_N (1 << 12)
+#define LOOKUPS (1 << 22)
+
+CMAP_DEFINE(i64map, int64_t, int64_t, (a > b) - (a < b))
+
+int i64_cmp(const void *d1, const void *d2) {
+	const int64_t *i1 = d1, *i2 = d2;
+	return (*i1 > *i2) - (*i1 < *i2);
+}
+
+size_t i64_size_get(const void *d1) {
+	return sizeof(int64_t);
+}
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void report(const char *name, int n, double insert_time, double lookup_time,
+		   double erase_time, int64_t sum) {
+	printf("%s (%d keys): insert %.2f, lookup %.2f, erase %.2f Mops/s (checksum %lld)\n",
+	       name, n, n / insert_time / 1e6, LOOKUPS / lookup_time / 1e6, n / erase_time / 1e6,
+	       (long long)sum);
+}
+
+static void run(const int64_t *keys, int n) {
+	cmap_data_t interface = CREATE_INLINE_INTERFACE(i64_cmp, i64_size_get, sizeof(int64_t));
+	cmap_t map = cmap_init(&interface, &interface);
+	int64_t sum = 0;
+	double start = now();
+	for (int i = 0; i < n; i++)
+		map.insert(&map, &keys[i], &keys[i]);
+	double insert_time = now() - start;
+	start = now();
+	for (int i = 0; i < LOOKUPS; i++)
+		sum += *(int64_t *)map.search(&map, &keys[(i * 7919L) % n]);
+	double lookup_time = now() - start;
+	start = now();
+	for (int i = 0; i < n; i++)
+		map.erase(&map, &keys[(i * 7919L) % n]);
+	double erase_time = now() - start;
+	report("generic", n, insert_time, lookup_time, erase_time, sum);
+	map.destroy(&map);
+
+	i64map_t typed = i64map_init();
+	sum = 0;
+	start = now();
+	for (int i = 0; i < n; i++)
+		i64map_insert(&typed, keys[i], keys[i]);
+	insert_time = now() - start;
+	start = now();
+	for (int i = 0; i < LOOKUPS; i++)
+		sum += *i64map_search(&typed, keys[(i * 7919L) % n]);
+	lookup_time = now() - start;
+	start = now();
+	for (int i = 0; i < n; i++)
+		i64map_erase(&typed, keys[(i * 7919L) % n]);
+	erase_time = now() - start;
+	report("typed", n, insert_time, lookup_time, erase_time, sum);
+	i64map_destroy(&typed);
+}
+
+int main(void) {
+	int64_t *keys = malloc(sizeof(int64_t) * N);
+	srand(1);
+	for (int i = 0; i < N; i++)
+		keys[i] = ((int64_t)rand() << 31) ^ rand();
+	run(keys, SMALL_N);
+	run(keys, N);
+	free(keys);
+	return 0;
+}
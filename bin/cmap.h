@@ -2,6 +2,7 @@
 #define __C_MAP__
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
 #define CREATE_INTERFACE(cmp_func, size_get_func)                              \
 	{.data = NULL,                                                         \
 	 .cmp = cmp_func,                                                      \
@@ -18,9 +19,99 @@
 	 .destroy = destroy_func,                                              \
 	 .dealloc = free}
 
+#define CREATE_INLINE_INTERFACE(cmp_func, size_get_func, size)                 \
+	{.data = NULL,                                                         \
+	 .cmp = cmp_func,                                                      \
+	 .data_size_get = size_get_func,                                       \
+	 .copy = memcpy,                                                       \
+	 .destroy = NULL,                                                      \
+	 .dealloc = free,                                                      \
+	 .inline_size = size}
+
+#define CREATE_BORROWED_INTERFACE(cmp_func)                                    \
+	{.data = NULL,                                                         \
+	 .cmp = cmp_func,                                                      \
+	 .data_size_get = NULL,                                                \
+	 .copy = NULL,                                                         \
+	 .destroy = NULL,                                                      \
+	 .dealloc = NULL,                                                      \
+	 .borrowed = true}
+
+#define CREATE_STRING_INTERFACE()                                              \
+	{.data = NULL,                                                         \
+	 .cmp = cmap_str_cmp,                                                  \
+	 .data_size_get = cmap_str_size_get,                                   \
+	 .copy = memcpy,                                                       \
+	 .destroy = NULL,                                                      \
+	 .dealloc = free,                                                      \
+	 .kind = CMAP_KIND_STRING,                                             \
+	 .hash = cmap_str_hash}
+
+#define CREATE_INT32_INTERFACE()                                               \
+	{.data = NULL,                                                         \
+	 .cmp = cmap_int32_cmp,                                                \
+	 .data_size_get = cmap_int32_size_get,                                 \
+	 .copy = memcpy,                                                       \
+	 .destroy = NULL,                                                      \
+	 .dealloc = free,                                                      \
+	 .inline_size = sizeof(int32_t),                                       \
+	 .kind = CMAP_KIND_INT32,                                              \
+	 .hash = cmap_int32_hash}
+
+#define CREATE_INT64_INTERFACE()                                               \
+	{.data = NULL,                                                         \
+	 .cmp = cmap_int64_cmp,                                                \
+	 .data_size_get = cmap_int64_size_get,                                 \
+	 .copy = memcpy,                                                       \
+	 .destroy = NULL,                                                      \
+	 .dealloc = free,                                                      \
+	 .inline_size = sizeof(int64_t),                                       \
+	 .kind = CMAP_KIND_INT64,                                              \
+	 .hash = cmap_int64_hash}
+
+#define CREATE_UINT64_INTERFACE()                                              \
+	{.data = NULL,                                                         \
+	 .cmp = cmap_uint64_cmp,                                               \
+	 .data_size_get = cmap_int64_size_get,                                 \
+	 .copy = memcpy,                                                       \
+	 .destroy = NULL,                                                      \
+	 .dealloc = free,                                                      \
+	 .inline_size = sizeof(uint64_t),                                      \
+	 .kind = CMAP_KIND_UINT64,                                             \
+	 .hash = cmap_int64_hash}
+
 typedef struct cmap cmap_t;
 typedef struct cmap_node cmap_node_t;
 typedef struct cmap_data cmap_data_t;
+typedef struct cmap_pool cmap_pool_t;
+typedef struct cmap_iter cmap_iter_t;
+typedef struct cmap_option cmap_option_t;
+typedef struct cmap_index cmap_index_t;
+typedef struct cmap_bloom cmap_bloom_t;
+typedef struct cmap_stats cmap_stats_t;
+typedef enum cmap_kind cmap_kind_t;
+typedef bool (*cmap_visit_t)(const void *key, void *val, void *arg);
+typedef void (*cmap_merge_t)(void *val, const void *delta);
+
+/**
+ * enum cmap_kind - the built-in kinds of keys known by cmap.
+ * @CMAP_KIND_CUSTOM:	the keys are compared by the cmp() method given by user. (default)
+ * @CMAP_KIND_STRING:	C strings compared like strcmp().
+ * @CMAP_KIND_INT32:	int32_t in ascending order.
+ * @CMAP_KIND_INT64:	int64_t in ascending order.
+ * @CMAP_KIND_UINT64:	uint64_t in ascending order.
+ *
+ * The kind is set by CREATE_STRING_INTERFACE, CREATE_INT32_INTERFACE, CREATE_INT64_INTERFACE
+ * and CREATE_UINT64_INTERFACE together with the matching built-in cmp() method, and cmap
+ * uses it to compare keys without calling cmp() through the function pointer.
+ */
+enum cmap_kind {
+	CMAP_KIND_CUSTOM = 0,
+	CMAP_KIND_STRING,
+	CMAP_KIND_INT32,
+	CMAP_KIND_INT64,
+	CMAP_KIND_UINT64
+};
 
 /**
  * struct cmap_data - the structure containing your data and necessary function pointers.
@@ -32,6 +123,14 @@ typedef struct cmap_data cmap_data_t;
  * @destroy:		function pointer to destroy the object. (That is, It is a destructor.)
  * @dealloc:		function pointer to dealloc the object if the object is allocated by 
  *			memory allocation. (pointed to free() function.)
+ * @inline_size:	the objects whose sizes are not larger than it are stored inside
+ *			the cmap node rather than a separate memory allocation. (0 by default.)
+ * @borrowed:		the objects are owned by user, and cmap keeps the pointers given by user
+ *			without copying, destroying or deallocating them. (false by default.)
+ * @kind:		the built-in kind of the keys. (CMAP_KIND_CUSTOM by default.)
+ * @hash:		function pointer returning the hash of an object, where equal objects
+ *			must have the same hash. It is only needed by the keys of a cmap with
+ *			the hash index. (NULL by default, and the built-in kinds have their own.)
  *
  * In order to comply the essence of OOP, data in cmap should be an object having its
  * data and methods, so the following structure has two usages.
@@ -55,6 +154,26 @@ typedef struct cmap_data cmap_data_t;
  *					is a complex data type which may need to do complicated memory management.
  *					If they are defined, using CREATE_INTERFACE4 to create an object with function pointers
  *					to the corresponding functions.
+ *
+ *					For small objects such as integers or short strings, using
+ *					CREATE_INLINE_INTERFACE (or setting inline_size after creating the
+ *					interface) lets cmap store them inside the cmap node, so no extra memory
+ *					allocation and pointer chasing are needed for them. The object is moved
+ *					by memcpy() when cmap relocates it, so it must not point to itself.
+ *
+ *					For objects which live longer than the cmap (interned strings, records
+ *					in a table, ...), using CREATE_BORROWED_INTERFACE lets cmap store the
+ *					pointers given by user as they are. Only cmp is needed, and the objects
+ *					must not be changed in a way that changes their order while they are
+ *					in the cmap.
+ *
+ * 3. Use the built-in interfaces:	CREATE_STRING_INTERFACE, CREATE_INT32_INTERFACE,
+ *					CREATE_INT64_INTERFACE and CREATE_UINT64_INTERFACE create the
+ *					interfaces of C strings and integers with built-in methods (the
+ *					integers are stored inline). cmap compares these keys without any
+ *					indirect call, and a node keeps the first 8 bytes of its string key,
+ *					so most comparsions of strings are a single integer comparsion
+ *					which doesn't touch the memory of the string.
  */
 struct cmap_data {
 	void *data;
@@ -63,19 +182,255 @@ struct cmap_data {
 	void *(*const copy)(void *, const void *, size_t);
 	void (*const destroy)(void *);
 	void (*const dealloc)(void *);
+	size_t inline_size;
+	bool borrowed;
+	cmap_kind_t kind;
+	size_t (*const hash)(const void *);
+};
+
+/**
+ * struct cmap_pool - the slab allocator of cmap nodes owned by a cmap object.
+ * @chunks:		list of the memory chunks allocated by the pool. Each chunk holds
+ *			several cmap nodes, so nodes are not allocated one by one.
+ * @free_nodes:		intrusive free list of the nodes released by erase().
+ * @spare:		list of the chunks kept by clear(), which are reused before allocating.
+ * @cursor:		the next never-used node in the newest chunk.
+ * @limit:		the end of the newest chunk.
+ * @node_size:		the size of a node, including the inline storage of key and value.
+ *
+ * A cmap object allocates its nodes from its own pool, so inserting a node is usually
+ * a pointer pop from @free_nodes or a bump of @cursor, and destroy() releases whole
+ * chunks at once instead of freeing every node. (Not important for user.)
+ */
+struct cmap_pool {
+	void *chunks;
+	void *free_nodes;
+	void *spare;
+	char *cursor, *limit;
+	size_t node_size;
+};
+
+/**
+ * struct cmap_index - the hash index from the keys to the nodes of a cmap object.
+ * @slots:		the open-addressing table of the nodes and the hashes of their keys,
+ *			or NULL before the first key is inserted.
+ * @capacity:		the number of slots, which is a power of 2.
+ *
+ * The index is only kept by a cmap object with the hash_index option, and its
+ * load factor is at most 3/4. (Not important for user.)
+ */
+struct cmap_index {
+	void *slots;
+	size_t capacity;
+};
+
+/**
+ * struct cmap_bloom - the blocked Bloom filter of the keys of a cmap object.
+ * @memory:		the memory allocated for @blocks, or NULL before the first key is inserted.
+ * @blocks:		the blocks of 512 bits, which are aligned to cache lines.
+ * @block_count:	the number of blocks.
+ * @keys:		the number of keys added since the filter was built, including erased ones.
+ * @erased:		the number of keys erased since the filter was built.
+ *
+ * The filter is only kept by a cmap object with the bloom_filter option. A key sets
+ * 8 bits in one block, and erased keys stay in the filter until it is rebuilt.
+ * (Not important for user.)
+ */
+struct cmap_bloom {
+	void *memory;
+	void *blocks;
+	size_t block_count;
+	size_t keys;
+	size_t erased;
+};
+
+/**
+ * struct cmap_stats - the memory usage of a cmap object reported by stats().
+ * @count:		the number of keys.
+ * @node_size:		the size of a node, including the inline storage and the data of the options.
+ * @node_memory:	the bytes of the chunks allocated for the nodes, including the unused
+ *			nodes kept for the following inserts.
+ * @index_capacity:	the number of slots of the hash index. (0 without the hash index.)
+ * @index_memory:	the bytes of the hash index, which is the overhead of the hash_index option.
+ * @bloom_memory:	the bytes of the Bloom filter of the bloom_filter option.
+ * @bloom_fpr:		the expected false-positive rate of the Bloom filter, which is the chance that
+ *			a missing key passes the filter, computed from the bits set in every block.
+ *			(0 without the Bloom filter.)
+ *
+ * The keys and values which are not stored inline are allocated separately and not counted.
+ */
+struct cmap_stats {
+	size_t count;
+	size_t node_size;
+	size_t node_memory;
+	size_t index_capacity;
+	size_t index_memory;
+	size_t bloom_memory;
+	double bloom_fpr;
+};
+
+/**
+ * struct cmap_iter - a position in a cmap object, which is used to walk the keys in order.
+ * @node:		the node at the position, or NULL if the iterator is at the end
+ *			(the position after the largest key).
+ * @key:		the key of the node. (NULL at the end.)
+ * @val:		the value of the node. (NULL at the end.)
+ *
+ * An iterator is a small value returned by the iterator methods of cmap, and it is
+ * neither allocated nor released. Inserting and erasing other keys do not move it, so an
+ * iterator stays valid until its own key is erased.
+ */
+struct cmap_iter {
+	cmap_node_t *node;
+	const void *key;
+	void *val;
+};
+
+/**
+ * struct cmap_option - the options of a cmap object, which are given to cmap_init3().
+ * @order_statistics:	every node keeps the number of the nodes in its subtree, so that
+ *			select(), rank() and count_range() take O(log n). It costs one size_t
+ *			per node and a little work in every rotation, insert and erase.
+ * @interval_end:	a function returning the end of the interval [key, end) stored by a key and
+ *			its value, or NULL if the cmap is not in the interval mode. The end is compared
+ *			with the keys by the cmp() of the key interface, and it must stay valid while the
+ *			key and the value are in the cmap. Every node of the interval mode keeps the largest
+ *			end in its subtree, so that interval_overlaps() takes O(log n + k log(n / k))
+ *			for k intervals found.
+ * @aug_size:		the size of a summary in bytes, or 0 if the cmap is not augmented.
+ *			Every node of an augmented cmap keeps the summary of its subtree, so
+ *			that aggregate_range() takes O(log n).
+ * @aug_lift:		a function writing the summary of a single key and its value into
+ *			the first argument.
+ * @aug_combine:	a function writing the summary of two adjacent ranges of keys (the
+ *			second argument is the smaller range) into the first argument, which may
+ *			be the same buffer as one of them. It must be associative, like the sum,
+ *			the maximum or the minimum.
+ * @btree:		the keys are kept by a B+ tree instead of a red-black tree. A node holds
+ *			many keys (inline keys are stored in the node itself) and the leaves are
+ *			linked, so a search takes a few cache misses per level of a shallow tree.
+ *			The methods are the same, but inserting and erasing keys move the other
+ *			keys of their leaves, so the pointers returned by search() and iterators
+ *			stay valid only until the next change of the cmap. The other options are
+ *			ignored: select() and rank() walk the leaves, and aggregate_range() and
+ *			interval_overlaps() return false.
+ * @hash_index:		the cmap also keeps a hash table from the keys to their nodes, so search(),
+ *			find(), erase() and the update of an existed key take one probe of the table
+ *			instead of a descent of the tree, while the ordered methods still use the tree.
+ *			It costs 16 bytes per slot (see stats()) and the hash of every inserted or erased
+ *			key. It is ignored if the key interface has neither hash() nor a built-in kind.
+ * @bloom_filter:	the cmap also keeps a blocked Bloom filter of the hashes of its keys, so most
+ *			search(), find() and erase() of a missing key return after reading one cache line
+ *			of the filter instead of a descent of the tree. It costs 2 to 4 bytes per key
+ *			(see stats()) and needs hash() like the hash_index option.
+ * @bloom_churn:	the number of erased keys after which the Bloom filter is rebuilt from the
+ *			tree, or 0 for the half of the keys in the filter. Erased keys still pass the
+ *			filter until then, and a rebuild takes O(n).
+ *
+ * The summaries are fixed after every change made by the methods of cmap, but not after
+ * the value returned by search() is changed by user. Insert the value again instead.
+ */
+struct cmap_option {
+	bool order_statistics;
+	const void *(*interval_end)(const void *, const void *);
+	size_t aug_size;
+	void (*aug_lift)(void *, const void *, const void *);
+	void (*aug_combine)(void *, const void *, const void *);
+	bool btree;
+	bool hash_index;
+	bool bloom_filter;
+	size_t bloom_churn;
 };
 
 /**
  * struct cmap - the structure of cmap.
- * @root:		pointer to the root of Red-Black Tree.
- * 			The definition of cmap_node_t has been defined and hidden in cmap.c file, so
+ * @root:		pointer to the root of Red-Black Tree (or the root node of the B+ tree in the B-tree mode).
+ * @rightmost:		pointer to the node with the largest key, which is cached so that inserting a larger
+ *			key appends it without walking down the tree. (The last leaf in the B-tree mode.)
+ * 			The definition of cmap_node_t has been defined and hidden in cmap_node_view.h file, so
  * 			users don't need to realize the data of cmap_node_t (Not important).
  * @key_interface:	An instance of cmap_data with valid function pointers for key in cmap.
  * @val_interface:	An instance of cmap_data with valid function pointers for value in cmap.
+ * @option:		The options given to cmap_init3(), which should not be changed.
+ * @count:		The number of keys in cmap.
+ * @pool:		The slab allocator providing the memory of cmap nodes for this cmap.
+ * @scratch:		A buffer of aug_size bytes (rounded up like the summaries in the nodes)
+ *			holding a partial summary in aggregate_range(), or NULL if the cmap is
+ *			not augmented. It is allocated by cmap_init3() (again by aggregate_range()
+ *			after destroy()) rather than on the stack of every query.
+ * @index:		The hash index of the keys of the hash_index option.
+ * @bloom:		The Bloom filter of the keys of the bloom_filter option.
+ * @retire:		A hook receiving the nodes unlinked by erase() instead of releasing them at once.
+ *			It is NULL by default and set by the wrappers whose readers may still access
+ *			an unlinked node (cmap_optimistic), and the hook releases the node later.
  * @search:		A function pointer to a built-in function to search a specific key, then  returning
  *			the pointer to the corresponding value (data field of val with cmap_data_t type in cmap_node_t.)
+ *			The pointer stays valid until the key is erased (or its value is updated by insert).
  * @insert:		A function pointer to a built-in function to insert or update a value for a certain key.
+ * @get_or_insert:	A function pointer to a built-in function returning the pointer to the value of a key
+ *			by one descent. A missing key is inserted with a default value first. The value can
+ *			be changed in place until the key is erased.
+ * @upsert:		A function pointer to a built-in function merging a delta into the value of a key in
+ *			place by a callback given by user, or inserting the key with the delta as its value,
+ *			by one descent and no memory allocation for an existed key. It returns the pointer
+ *			to the value like get_or_insert.
+ * @insert_move:	A function pointer to a built-in function to insert a key and a value allocated by user
+ *			(by malloc() unless the interfaces use another dealloc) without copying them. cmap owns
+ *			both of them after the call; the key is released if it already exists.
+ * @insert_hint:	A function pointer to a built-in function to insert or update a value for a certain key
+ *			with an iterator at the position just after the key. A correct hint saves the search,
+ *			and the end iterator is the hint for a key larger than all keys. It returns the
+ *			iterator at the key.
+ * @insert_batch:	A function pointer to a built-in function to insert or update n keys in any order
+ *			and their values. The batch is sorted and every key is inserted from the position
+ *			of the previous one rather than the root.
  * @erase:		A function pointer to a built-in function to erase a node with assigned key from cmap.
+ * @extract:		A function pointer to a built-in function to erase a key and hand its key and value over
+ *			to user without destroying them, where user releases them later. (Inline objects are
+ *			moved into buffers allocated by malloc().) A NULL output releases the object instead.
+ *			It returns false if the key does not exist.
+ * @erase_range:	A function pointer to a built-in function to erase all keys not less than a key and
+ *			less than another key, then returning the number of the erased keys.
+ * @count_range:	A function pointer to a built-in function returning the number of the keys not less
+ *			than a key and less than another key.
+ * @build_sorted:	A function pointer to a built-in function to fill an empty cmap with n keys in
+ *			strictly ascending order and their values in O(n). It returns false if cmap is not
+ *			empty or the keys are not sorted.
+ * @foreach:		A function pointer to a built-in function to visit every key and value in ascending order
+ *			of keys by a callback given by user. The visit stops once the callback returns false,
+ *			and it returns whether all nodes are visited.
+ * @begin:		A function pointer to a built-in function returning the iterator at the smallest key,
+ *			or the end iterator if cmap is empty.
+ * @end:		A function pointer to a built-in function returning the end iterator.
+ * @next:		A function pointer to a built-in function returning the iterator at the next larger key
+ *			(or the end iterator after the largest key).
+ * @prev:		A function pointer to a built-in function returning the iterator at the next smaller key.
+ *			The previous position of the end iterator is the largest key, and the previous position
+ *			of the smallest key is the end iterator.
+ * @find:		A function pointer to a built-in function returning the iterator at a specific key,
+ *			or the end iterator if the key does not exist.
+ * @lower_bound:	A function pointer to a built-in function returning the iterator at the smallest key
+ *			which is not less than a given key.
+ * @upper_bound:	A function pointer to a built-in function returning the iterator at the smallest key
+ *			which is larger than a given key.
+ * @aggregate_range:	A function pointer to a built-in function writing the summary of the keys not less
+ *			than a key and less than another key into a buffer in O(log n). It returns false if
+ *			cmap is not augmented or no key is in the range.
+ * @interval_overlaps:	A function pointer to a built-in function to visit every interval [key, end)
+ *			overlapping [low, high) in ascending order of keys by a callback given by user,
+ *			where only the subtrees which can overlap are walked. The visit stops once the
+ *			callback returns false, and it returns whether the visit is not stopped. It visits
+ *			nothing and returns false if cmap is not in the interval mode.
+ * @size:		A function pointer to a built-in function returning the number of keys in O(1).
+ * @stats:		A function pointer to a built-in function writing the memory usage of cmap (the
+ *			nodes, the hash index and the Bloom filter) into a cmap_stats object given by user.
+ * @select:		A function pointer to a built-in function returning the iterator at the key with a
+ *			given rank (0 for the smallest key), or the end iterator if the rank is not less than
+ *			the number of keys. It takes O(log n) in the order statistics mode, or O(rank).
+ * @rank:		A function pointer to a built-in function returning the number of keys less than a
+ *			given key. It takes O(log n) in the order statistics mode, or O(n).
+ * @clear:		A function pointer to a built-in function to erase all keys while keeping the memory
+ *			of the nodes, which is reused by the following inserts. The object stays usable.
  * @destroy:		A function pointer to a built-in function to destroy the object of cmap.
  * @dealloc:		A function pointer to free() providing a method to free an allocated object of cmap for user.
  *
@@ -85,11 +440,43 @@ struct cmap_data {
  */
 struct cmap {
 	cmap_node_t *root;
+	cmap_node_t *rightmost;
 	cmap_data_t key_interface;
 	cmap_data_t val_interface;
+	cmap_option_t option;
+	size_t count;
+	cmap_pool_t pool;
+	void *scratch;
+	cmap_index_t index;
+	cmap_bloom_t bloom;
+	void (*retire)(cmap_t *, cmap_node_t *);
 	void *(*const search)(cmap_t *, const void *);
 	void (*const insert)(cmap_t *, const void *, const void *);
+	void *(*const get_or_insert)(cmap_t *, const void *, const void *);
+	void *(*const upsert)(cmap_t *, const void *, const void *, cmap_merge_t);
+	void (*const insert_move)(cmap_t *, void *, void *);
+	cmap_iter_t (*const insert_hint)(cmap_t *, cmap_iter_t, const void *, const void *);
+	void (*const insert_batch)(cmap_t *, const void *const *, const void *const *, size_t);
 	bool (*const erase)(cmap_t *, const void *);
+	bool (*const extract)(cmap_t *, const void *, void **, void **);
+	size_t (*const erase_range)(cmap_t *, const void *, const void *);
+	size_t (*const count_range)(cmap_t *, const void *, const void *);
+	bool (*const build_sorted)(cmap_t *, const void *const *, const void *const *, size_t);
+	bool (*const foreach)(cmap_t *, cmap_visit_t, void *);
+	cmap_iter_t (*const begin)(cmap_t *);
+	cmap_iter_t (*const end)(cmap_t *);
+	cmap_iter_t (*const next)(cmap_t *, cmap_iter_t);
+	cmap_iter_t (*const prev)(cmap_t *, cmap_iter_t);
+	cmap_iter_t (*const find)(cmap_t *, const void *);
+	cmap_iter_t (*const lower_bound)(cmap_t *, const void *);
+	cmap_iter_t (*const upper_bound)(cmap_t *, const void *);
+	bool (*const aggregate_range)(cmap_t *, const void *, const void *, void *);
+	bool (*const interval_overlaps)(cmap_t *, const void *, const void *, cmap_visit_t, void *);
+	size_t (*const size)(cmap_t *);
+	void (*const stats)(cmap_t *, cmap_stats_t *);
+	cmap_iter_t (*const select)(cmap_t *, size_t);
+	size_t (*const rank)(cmap_t *, const void *);
+	void (*const clear)(cmap_t *);
 	void (*const destroy)(cmap_t *);
 	void (*const dealloc)(void *);
 };
@@ -105,6 +492,18 @@ struct cmap {
 cmap_t cmap_init(cmap_data_t *key_interface, cmap_data_t *val_interface);
 
 
+/**
+ * cmap_init3 - A function returning an instance of cmap with options.
+ * @key_interface:	An instance of cmap_data with valid function pointers for key in cmap.
+ * @val_interface:	An instance of cmap_data with valid function pointers for value in cmap.
+ * @option:		An instance of cmap_option, or NULL for the default options which are all off.
+ *
+ * It is the same as cmap_init() except for the options, which cannot be changed later.
+ */
+cmap_t cmap_init3(cmap_data_t *key_interface, cmap_data_t *val_interface,
+		  const cmap_option_t *option);
+
+
 /**
  * cmap_init - A function returning a pointer to an allocated instance of cmap.
  * @key_interface:	An instance of cmap_data with valid function pointers for key in cmap.
@@ -115,4 +514,43 @@ cmap_t cmap_init(cmap_data_t *key_interface, cmap_data_t *val_interface);
  */
 void *cmap_alloc(cmap_data_t *ker_interface, cmap_data_t *val_interface);
 
+
+/**
+ * cmap_alloc3 - A function returning a pointer to an allocated instance of cmap with options.
+ * @key_interface:	An instance of cmap_data with valid function pointers for key in cmap.
+ * @val_interface:	An instance of cmap_data with valid function pointers for value in cmap.
+ * @option:		An instance of cmap_option, or NULL for the default options which are all off.
+ *
+ * It will calls malloc() to allocate an object initialized by cmap_init3().
+ */
+void *cmap_alloc3(cmap_data_t *key_interface, cmap_data_t *val_interface,
+		  const cmap_option_t *option);
+
+
+/*
+ * The built-in methods of the interfaces created by CREATE_STRING_INTERFACE and
+ * the interfaces of integers, which can also be given to any interface by user.
+ *
+ * cmap_str_cmp():		Comparsion of two C strings like strcmp().
+ * cmap_str_size_get():		The size of a C string including its terminator.
+ * cmap_int32_cmp():		Comparsion of two int32_t.
+ * cmap_int32_size_get():	The size of int32_t.
+ * cmap_int64_cmp():		Comparsion of two int64_t.
+ * cmap_uint64_cmp():		Comparsion of two uint64_t.
+ * cmap_int64_size_get():	The size of int64_t and uint64_t.
+ * cmap_str_hash():		The hash of a C string.
+ * cmap_int32_hash():		The hash of an int32_t.
+ * cmap_int64_hash():		The hash of an int64_t or a uint64_t.
+ */
+int cmap_str_cmp(const void *d1, const void *d2);
+size_t cmap_str_size_get(const void *d1);
+int cmap_int32_cmp(const void *d1, const void *d2);
+size_t cmap_int32_size_get(const void *d1);
+int cmap_int64_cmp(const void *d1, const void *d2);
+int cmap_uint64_cmp(const void *d1, const void *d2);
+size_t cmap_int64_size_get(const void *d1);
+size_t cmap_str_hash(const void *d1);
+size_t cmap_int32_hash(const void *d1);
+size_t cmap_int64_hash(const void *d1);
+
 #endif
@@ -0,0 +1,118 @@
+#ifndef __C_MAP_DEFINE__
+#define __C_MAP_DEFINE__
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cmap.h"
+#include "cmap_node_view.h"
+
+/**
+ * CMAP_DEFINE - generating a type-specialized cmap.
+ * @name:	the prefix of the generated type and functions.
+ * @K:		the type of keys, which is copied by assignment.
+ * @V:		the type of values, which is copied by assignment.
+ * @cmp_expr:	an expression comparing the keys a and b of type @K, which is
+ *		negative, zero or positive like the cmp() method of cmap_data_t.
+ *
+ * A cmap object compares keys by the cmp() method of its key_interface, so every
+ * step of a search is an indirect call through a function pointer which can't be
+ * inlined. CMAP_DEFINE() generates a cmap for the given types whose keys and values
+ * are stored inline in the nodes, and the descents of search, insert and erase are
+ * compiled for @K with @cmp_expr inlined, so no function pointer is called on the
+ * lookup path. The linking, rotations and fixups after a descent are the same code
+ * as any other cmap (cmap_node_link() and cmap_node_erase()).
+ *
+ * For example, CMAP_DEFINE(i64map, int64_t, int64_t, (a > b) - (a < b)) generates:
+ *
+ * i64map_t:			The typed cmap, which wraps a cmap object @map.
+ * i64map_init():		Constructor of the typed cmap.
+ * i64map_search():		The pointer to the value of a key, or NULL if it is missing.
+ * i64map_insert():		Inserting a key and a value, or updating the value of the key.
+ * i64map_erase():		Erasing a key, returning whether it was in the typed cmap.
+ * i64map_size():		The number of keys of the typed cmap.
+ * i64map_destroy():		Destructor of the typed cmap.
+ *
+ * Every other method (iterators, ranges, select(), ...) is used through @map as usual,
+ * with keys and values passed by pointers to @K and @V.
+ * The alignments of @K and @V must not be larger than the alignment of a pointer,
+ * which is the alignment of the inline storage of a cmap node.
+ */
+#define CMAP_DEFINE(name, K, V, cmp_expr)                                      \
+	typedef struct {                                                       \
+		cmap_t map;                                                    \
+	} name##_t;                                                            \
+                                                                               \
+	static inline int name##_cmp(K a, K b) {                               \
+		return (cmp_expr);                                             \
+	}                                                                      \
+                                                                               \
+	static inline int name##_key_cmp(const void *d1, const void *d2) {     \
+		return name##_cmp(*(const K *)d1, *(const K *)d2);             \
+	}                                                                      \
+                                                                               \
+	static inline size_t name##_key_size_get(const void *d1) {             \
+		return sizeof(K);                                              \
+	}                                                                      \
+                                                                               \
+	static inline size_t name##_val_size_get(const void *d1) {             \
+		return sizeof(V);                                              \
+	}                                                                      \
+                                                                               \
+	static inline name##_t name##_init(void) {                             \
+		cmap_data_t key_interface = CREATE_INLINE_INTERFACE(           \
+			name##_key_cmp, name##_key_size_get, sizeof(K));       \
+		cmap_data_t val_interface = CREATE_INLINE_INTERFACE(           \
+			NULL, name##_val_size_get, sizeof(V));                 \
+		cmap_t map = cmap_init(&key_interface, &val_interface);        \
+		return (name##_t){.map = map};                                 \
+	}                                                                      \
+                                                                               \
+	static inline V *name##_search(name##_t *m, K key) {                   \
+		cmap_node_t *node = m->map.root;                               \
+		while (node != NULL) {                                         \
+			int cmp = name##_cmp(*(const K *)node->key, key);      \
+			if (cmp == 0)                                          \
+				return (V *)node->val;                         \
+			node = cmp < 0 ? node->right : node->left;             \
+		}                                                              \
+		return NULL;                                                   \
+	}                                                                      \
+                                                                               \
+	static inline V *name##_insert(name##_t *m, K key, V val) {            \
+		cmap_node_t *parent = NULL, **link = &m->map.root;             \
+		while (*link != NULL) {                                        \
+			parent = *link;                                        \
+			int cmp = name##_cmp(*(const K *)parent->key, key);    \
+			if (cmp == 0) {                                        \
+				*(V *)parent->val = val;                       \
+				return (V *)parent->val;                       \
+			}                                                      \
+			link = cmp < 0 ? &parent->right : &parent->left;       \
+		}                                                              \
+		return (V *)cmap_node_link(&m->map, parent, link, &key, &val,  \
+					   false)                              \
+			->val;                                                 \
+	}                                                                      \
+                                                                               \
+	static inline bool name##_erase(name##_t *m, K key) {                  \
+		cmap_node_t *node = m->map.root;                               \
+		while (node != NULL) {                                         \
+			int cmp = name##_cmp(*(const K *)node->key, key);      \
+			if (cmp == 0) {                                        \
+				cmap_node_erase(&m->map, node);                \
+				return true;                                   \
+			}                                                      \
+			node = cmp < 0 ? node->right : node->left;             \
+		}                                                              \
+		return false;                                                  \
+	}                                                                      \
+                                                                               \
+	static inline size_t name##_size(name##_t *m) {                        \
+		return m->map.count;                                           \
+	}                                                                      \
+                                                                               \
+	static inline void name##_destroy(name##_t *m) {                       \
+		m->map.destroy(&m->map);                                       \
+	}
+
+#endif
@@ -1,8 +1,12 @@
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <string.h>
 #include "cmap.h"
+#include "cmap_internal.h"
+#ifndef DEBUG
 #define DEBUG 1
+#endif
 #if DEBUG == 1
 #include <stdio.h>
 #endif
@@ -17,7 +21,7 @@
  * Rules of Red-Black Tree (RBT).
  * 1. 	Each node of RBT has its color (black or red).
  * 2. 	The root must be black.
- * 3. 	The leafs are black (NIL).
+ * 3. 	The leafs are black (NIL, which is a NULL pointer in cmap).
  * 4. 	If a certain node is red, its two children must be black.
  *	That is, There cannot link two red nodes directly.
  * 5.	Starting from any node, the path between the start and any descendant
@@ -25,139 +29,454 @@
  */
 
 /**
- * struct cmap_node - the information of a node used by cmap.
- * @black: 	color of a node. (either red or black)
- * @key:	key of a node.
- * @val:	value of a node.
- * @parent:	pointer to parent of the node.
- * @left:	pointer to left subtree of the node.
- * @right	pointer to right subtree of the node.
+ * struct cmap_pool_chunk - the header of a chunk allocated by a cmap pool.
+ * @next:	pointer to the previously allocated chunk.
+ * @nodes:	the number of cmap nodes following this header.
  *
- * A simple definition of a cmap node to imitate <map> container in C++.
+ * A chunk is a header followed by @nodes cmap nodes; the size of the header
+ * is 16 bytes so the nodes after it keep the alignment returned by malloc().
+ */
+struct cmap_pool_chunk {
+	struct cmap_pool_chunk *next;
+	size_t nodes;
+};
+
+/**
+ * CMAP_POOL_CHUNK_NODES - the number of cmap nodes in a chunk of a cmap pool.
+ */
+#ifndef CMAP_POOL_CHUNK_NODES
+#define CMAP_POOL_CHUNK_NODES 64
+#endif
+
+/**
+ * CMAP_RANGE_SPLIT - the number of keys from which erase_range() splits the tree
+ *		      rather than erasing the keys one by one.
  */
-struct cmap_node {
-	bool black;
-	cmap_data_t key;
-	cmap_data_t val;
-	cmap_node_t *parent, *left, *right;
+#ifndef CMAP_RANGE_SPLIT
+#define CMAP_RANGE_SPLIT 16
+#endif
 
-	int (*const cmp)(cmap_node_t *, const void *);
-	void (*const insert_key)(cmap_node_t *, const void *);
-	void (*const insert_val)(cmap_node_t *, const void *);
-	void (*const destroy)(cmap_node_t *);
-	void (*const dealloc)(void *);
+/**
+ * struct cmap_index_slot - a slot of the hash index of a cmap object.
+ * @hash:	the mixed hash of the key of @node.
+ * @node:	the node, or NIL for an empty slot.
+ *
+ * The hash is kept so that a probe compares keys only for equal hashes, and
+ * the table grows without hashing the keys again.
+ */
+struct cmap_index_slot {
+	size_t hash;
+	cmap_node_t *node;
 };
 
+/**
+ * CMAP_INDEX_MIN_CAPACITY - the number of slots of a new hash index.
+ */
+#define CMAP_INDEX_MIN_CAPACITY 16
+
+/**
+ * CMAP_BLOOM_BLOCK_KEYS - the number of keys a block of a Bloom filter is sized for.
+ *
+ * A block has 512 bits, so it is 16 bits per key when the block is full. The filter
+ * is sized for twice the keys when it is built, so it keeps 16 to 32 bits (2 to 4
+ * bytes) per key added since then, and it only grows after the number of keys doubles.
+ */
+#define CMAP_BLOOM_BLOCK_KEYS 32
+#define CMAP_BLOOM_BLOCK_SIZE 64
+
+/**
+ * CMAP_PREFIX_SIZE - the size reserved in a node for the cached prefix of its key,
+ *		      which is only kept for the keys of CMAP_KIND_STRING.
+ */
+#define CMAP_PREFIX_SIZE(interface)                                            \
+	((interface)->kind == CMAP_KIND_STRING ? sizeof(uint64_t) : 0)
+
+/*
+ * Functions for struct cmap_pool
+ *
+ * cmap_pool_alloc():		Allocating the memory of a cmap node from a pool.
+ * cmap_pool_reserve():		Making sure that a pool has unused memory for several cmap nodes.
+ * cmap_pool_grow():		Allocating a new chunk for a pool.
+ * cmap_pool_free():		Returning the memory of a cmap node to a pool.
+ * cmap_pool_reset():		Making all chunks of a pool unused for reuse.
+ * cmap_pool_destroy():		Releasing all chunks of a pool.
+ *
+ * All details about the above functions are mentioned at their implementation places.
+ */
+static void cmap_pool_reserve(cmap_pool_t *pool, size_t nodes);
+static void cmap_pool_grow(cmap_pool_t *pool, size_t nodes);
+
 
 /* 
  * Functions for struct cmap_node
  * 
  * cmap_node_init(): 		Constructor(Initialization) for a cmap node.
+ * cmap_node_prefix():		The cached prefix of the string key of a cmap node.
+ * cmap_str_prefix():		The first 8 bytes of a C string as a big-endian integer.
+ * cmap_node_inline_key():	The inline storage of the key of a cmap node.
+ * cmap_node_inline_val():	The inline storage of the value of a cmap node.
+ * cmap_node_subtree_size():	The number of nodes in the subtree of a cmap node.
+ * cmap_node_set_subtree_size():Setting the number of nodes in the subtree of a cmap node.
+ * cmap_node_max_end():		The largest end of the intervals in the subtree of a cmap node.
+ * cmap_node_summary():		The summary of the subtree of a cmap node.
+ * cmap_node_update_summary():	Computing the summary of a cmap node from its children.
+ * cmap_node_update_path():	Fixing the subtree sizes and summaries of a cmap node and its ancestors.
  * cmap_node_cmp():		Comparsion between the key of a cmap node and another key.
+ * cmap_key_prefix():		The prefix of a key compared by cmap_node_cmp_prefix().
+ * cmap_node_cmp_prefix():	Comparsion between the key of a cmap node and a key with its prefix.
  * cmap_node_insert_key():	Insert a new key into the key field of a given cmap node.
  * cmap_node_insert_val():	Insert a new value into the val field of a given cmap node.
  * cmap_node_alloc():		Allocation for a cmap node.
- * cmap_destroy():		Destructor for a given cmap node.
+ * cmap_node_destroy():		Destructor for the keys and values in a subtree of cmap nodes.
+ * cmap_node_release():		Destructor for a cmap node unlinked from a cmap object.
+ * cmap_data_store():		Storing a copy of an object into a node (inline or allocated).
+ * cmap_data_detach():		Taking an object out of a node without destroying it.
+ * cmap_data_release():		Destroying and deallocating an object stored in a node.
  *
  * All details about the above functions are mentioned at their implementation places.
  */
-static cmap_node_t cmap_node_init(cmap_t *map, const void *key, const void *val);
-static int cmap_node_cmp(cmap_node_t *node, const void *key); 
-static void cmap_node_insert_key(cmap_node_t *node, const void *key);
-static void cmap_node_insert_val(cmap_node_t *node, const void *val); 
-static void *cmap_node_alloc(cmap_t *map, const void *key, const void *val);
-static void cmap_node_destroy(cmap_node_t *node);
+static void cmap_node_init(cmap_t *map, cmap_node_t *node, const void *key, const void *val,
+			   bool move);
+static inline uint64_t *cmap_node_prefix(cmap_t *map, cmap_node_t *node);
+static inline uint64_t cmap_str_prefix(const char *str);
+static inline void *cmap_node_inline_key(cmap_t *map, cmap_node_t *node);
+static inline void *cmap_node_inline_val(cmap_t *map, cmap_node_t *node);
+static inline size_t cmap_node_subtree_size(cmap_t *map, cmap_node_t *node);
+static inline void cmap_node_set_subtree_size(cmap_t *map, cmap_node_t *node, size_t size);
+static inline const void **cmap_node_max_end(cmap_t *map, cmap_node_t *node);
+static inline void *cmap_node_summary(cmap_t *map, cmap_node_t *node);
+static inline void cmap_node_update_summary(cmap_t *map, cmap_node_t *node);
+static void cmap_node_update_path(cmap_t *map, cmap_node_t *node, size_t diff);
+static inline int cmap_node_cmp(cmap_t *map, cmap_node_t *node, const void *key); 
+static inline uint64_t cmap_key_prefix(cmap_t *map, const void *key);
+static inline int cmap_node_cmp_prefix(cmap_t *map, cmap_node_t *node, const void *key,
+				       uint64_t key_prefix);
+static void cmap_node_insert_key(cmap_t *map, cmap_node_t *node, const void *key);
+static void cmap_node_insert_val(cmap_t *map, cmap_node_t *node, const void *val); 
+static void *cmap_node_alloc(cmap_t *map, const void *key, const void *val, bool move);
+static void cmap_node_destroy(cmap_t *map, cmap_node_t *node);
 
-/**
- * For the theory of red-black tree, it has a special node called NIL
- * (or NEEL) to represent the leaf, and it has no data and is black forever.
+
+/*
+ * Functions for struct cmap_index
+ *
+ * cmap_key_hash():		The mixed hash of a key of a cmap object.
+ * cmap_index_find():		Finding the node of a key by the hash index.
+ * cmap_index_insert():		Adding a new node into the hash index.
+ * cmap_index_grow():		Doubling the slots of the hash index.
+ * cmap_index_remove():		Removing a node from the hash index.
+ * cmap_index_reset():		Making the hash index empty.
+ *
+ * All details about the above functions are mentioned at their implementation places.
+ */
+static inline uint64_t cmap_key_hash(cmap_t *map, const void *key);
+static cmap_node_t *cmap_index_find(cmap_t *map, const void *key);
+static void cmap_index_insert(cmap_t *map, cmap_node_t *node, size_t hash);
+static void cmap_index_grow(cmap_t *map);
+static void cmap_index_remove(cmap_t *map, cmap_node_t *node);
+static void cmap_index_reset(cmap_t *map, bool release);
+
+
+/*
+ * Functions for struct cmap_bloom
  *
- * So, here defines it for the entire implementations.
+ * cmap_bloom_bit():		The bit set by a hash in a word of a block of the Bloom filter.
+ * cmap_bloom_block():		The index of the block of a hash in the Bloom filter.
+ * cmap_bloom_add():		Adding the hash of a key into the Bloom filter.
+ * cmap_bloom_contains():	Whether a key may be in a cmap object by the Bloom filter.
+ * cmap_bloom_maintain():	Rebuilding the Bloom filter if it is full or has too many erased keys.
+ * cmap_bloom_rebuild():	Building the Bloom filter again from the keys in the tree.
+ * cmap_bloom_reset():		Making the Bloom filter empty.
+ *
+ * All details about the above functions are mentioned at their implementation places.
  */
-#define NIL &nil_node
-static cmap_node_t nil_node = {.black = true,
-			       .key = {NULL},
-			       .val = {NULL},
-			       .parent = NIL,
-			       .left = NIL,
-			       .right = NIL,
-			       .destroy = cmap_node_destroy};
+static inline uint64_t cmap_bloom_bit(uint64_t hash, int word);
+static inline size_t cmap_bloom_block(cmap_t *map, uint64_t hash);
+static inline void cmap_bloom_add(cmap_t *map, uint64_t hash);
+static inline bool cmap_bloom_contains(cmap_t *map, const void *key);
+static inline void cmap_bloom_maintain(cmap_t *map, size_t adding);
+static void cmap_bloom_rebuild(cmap_t *map, size_t keys);
+static void cmap_bloom_reset(cmap_t *map, bool release);
 
 /**
  * cmap_node_init - constructor of cmap node.
  * @map:	an object of cmap.
+ * @node:	the memory of the node allocated from the pool of @map.
  * @key:	the given key inserted into the node.
  * @val:	the given value inseted into the node.
+ * @move:	whether @key and @val are allocated buffers adopted by the node as they are.
  * 
  * This is the constructor for the struct (or class, in the OOP opinion) cmap node.
  * Except for key and val, the resaon why needs to pass a cmap object into the function is
- * assigning the methods' implementations, whcih are provided by a cmap object, for key and 
- * value in a cmap node object.
- *
- * So, a cmap node can manipulate key and value like objects to use the given methods such as 
- * cmp() or copy() to do the relevant and needed operations.
- *
- * A cmap node is also used as an object so there has some function pointers, whcih are assigned
- * the specific functions, in a cmap node and.
- */
-static cmap_node_t cmap_node_init(cmap_t *map, const void *key, const void *val) {
-	cmap_node_t node = {.black = false,
-			    .key = map->key_interface,
-			    .val = map->val_interface,
-			    .parent = NIL,
-			    .left = NIL,
-			    .right = NIL,
-			    .cmp = cmap_node_cmp,
-			    .insert_key = cmap_node_insert_key,
-			    .insert_val = cmap_node_insert_val,
-			    .destroy = cmap_node_destroy,
-			    .dealloc = free};
-	node.insert_key(&node, key);
-	node.insert_val(&node, val);
-	return node;
+ * that the methods' implementations for key and value, such as data_size_get() or copy(),
+ * are provided by the key_interface and val_interface of the cmap object.
+ *
+ * The node is initialized in place because a small key or value may be stored
+ * in the inline storage following the node.
+ * A new node is red and its parent and children are NIL.
+ * The prefix of a string key is cached when the key is stored.
+ * In the order statistics mode, its subtree has only itself, and so does its
+ * summary for an augmented cmap object.
+ */
+static void cmap_node_init(cmap_t *map, cmap_node_t *node, const void *key, const void *val,
+			   bool move) {
+	*node = (cmap_node_t){.parent_color = 0,
+			      .left = NIL,
+			      .right = NIL,
+			      .key = move ? (void *)key : NULL,
+			      .val = move ? (void *)val : NULL};
+	if (!move) {
+		cmap_node_insert_key(map, node, key);
+		cmap_node_insert_val(map, node, val);
+	}
+	if (map->key_interface.kind == CMAP_KIND_STRING)
+		*cmap_node_prefix(map, node) = cmap_str_prefix(node->key);
+	cmap_node_set_subtree_size(map, node, 1);
+	cmap_node_update_summary(map, node);
+}
+
+/**
+ * cmap_node_prefix - the cached prefix of the string key of a cmap node.
+ * @map:	the cmap object owning the node, whose keys are of CMAP_KIND_STRING.
+ * @node:	an object of a cmap node.
+ *
+ * The prefix follows the node directly, so it is in the cache line of the node
+ * when the node is visited, while the string itself is usually in another one.
+ */
+static inline uint64_t *cmap_node_prefix(cmap_t *map, cmap_node_t *node) {
+	return (uint64_t *)(node + 1);
+}
+
+/**
+ * cmap_str_prefix - the first 8 bytes of a C string as a big-endian integer.
+ * @str:	the C string.
+ *
+ * The bytes after the end of a short string are zero, so the prefixes of two
+ * strings are ordered like strcmp() orders the strings, unless they are equal.
+ * Only the bytes up to the terminator are read.
+ */
+static inline uint64_t cmap_str_prefix(const char *str) {
+	uint64_t prefix = 0;
+	for (int i = 0; i < 8 && str[i] != '\0'; i++)
+		prefix |= (uint64_t)(unsigned char)str[i] << (56 - 8 * i);
+	return prefix;
+}
+
+/**
+ * cmap_node_inline_key - the inline storage of the key of a cmap node.
+ * cmap_node_inline_val - the inline storage of the value of a cmap node.
+ * @map:	the cmap object owning the node.
+ * @node:	an object of a cmap node.
+ *
+ * The inline storage of the key follows the node (and the prefix of a string key)
+ * directly, and the one of the value follows the inline storage of the key.
+ */
+static inline void *cmap_node_inline_key(cmap_t *map, cmap_node_t *node) {
+	return (char *)(node + 1) + CMAP_PREFIX_SIZE(&map->key_interface);
+}
+
+static inline void *cmap_node_inline_val(cmap_t *map, cmap_node_t *node) {
+	return (char *)cmap_node_inline_key(map, node) + CMAP_INLINE_SIZE(&map->key_interface);
+}
+
+/**
+ * cmap_node_subtree_size - the number of nodes in the subtree of a cmap node.
+ * cmap_node_set_subtree_size - setting the number of nodes in the subtree of a cmap node.
+ * @map:	the cmap object owning the node.
+ * @node:	an object of a cmap node. (NIL is an empty subtree.)
+ * @size:	the number of nodes.
+ *
+ * Only the nodes of a cmap object in the order statistics mode have the size
+ * of their subtree, which follows the inline storage of the value. The size is
+ * 0 and setting it does nothing in other cmap objects.
+ */
+static inline size_t cmap_node_subtree_size(cmap_t *map, cmap_node_t *node) {
+	if (node == NIL || !map->option.order_statistics)
+		return 0;
+	return *(size_t *)((char *)cmap_node_inline_val(map, node) +
+			   CMAP_INLINE_SIZE(&map->val_interface));
+}
+
+static inline void cmap_node_set_subtree_size(cmap_t *map, cmap_node_t *node, size_t size) {
+	if (map->option.order_statistics)
+		*(size_t *)((char *)cmap_node_inline_val(map, node) +
+			    CMAP_INLINE_SIZE(&map->val_interface)) = size;
+}
+
+/**
+ * cmap_node_max_end - the largest end of the intervals in the subtree of a cmap node.
+ * @map:	the cmap object owning the node, which must be in the interval mode.
+ * @node:	an object of a cmap node.
+ *
+ * It is a pointer to the end returned by interval_end() for a node of the subtree,
+ * which follows the subtree size of the order statistics mode, or the inline storage
+ * of the value if the mode is off.
+ */
+static inline const void **cmap_node_max_end(cmap_t *map, cmap_node_t *node) {
+	return (const void **)((char *)cmap_node_inline_val(map, node) +
+			       CMAP_INLINE_SIZE(&map->val_interface) +
+			       (map->option.order_statistics ? sizeof(size_t) : 0));
+}
+
+/**
+ * cmap_node_summary - the summary of the subtree of a cmap node.
+ * @map:	the cmap object owning the node, which must be augmented.
+ * @node:	an object of a cmap node.
+ *
+ * The summary follows all other data of the node: the subtree size of the order
+ * statistics mode and the largest end of the interval mode.
+ */
+static inline void *cmap_node_summary(cmap_t *map, cmap_node_t *node) {
+	return (char *)cmap_node_max_end(map, node) +
+	       (map->option.interval_end != NULL ? sizeof(void *) : 0);
+}
+
+/**
+ * cmap_node_update_summary - computing the summary of a cmap node from its children.
+ * @map:	the cmap object owning the node.
+ * @node:	an object of a cmap node whose children have the right summaries.
+ *
+ * The summary of a subtree is the summary of the left subtree, the node and
+ * the right subtree combined in this order by aug_combine(), which takes O(1).
+ * In the interval mode, the largest end of the subtree is also found among the
+ * end of the node and the largest ends of its children.
+ * It does nothing if @map is neither augmented nor in the interval mode.
+ */
+static inline void cmap_node_update_summary(cmap_t *map, cmap_node_t *node) {
+	if (map->option.interval_end != NULL) {
+		const void *max_end = map->option.interval_end(node->key, node->val);
+		for (int i = 0; i < 2; i++) {
+			cmap_node_t *child = i == 0 ? node->left : node->right;
+			if (child != NIL &&
+			    map->key_interface.cmp(*cmap_node_max_end(map, child), max_end) > 0)
+				max_end = *cmap_node_max_end(map, child);
+		}
+		*cmap_node_max_end(map, node) = max_end;
+	}
+	if (map->option.aug_size == 0)
+		return;
+	void *summary = cmap_node_summary(map, node);
+	map->option.aug_lift(summary, node->key, node->val);
+	if (node->left != NIL)
+		map->option.aug_combine(summary, cmap_node_summary(map, node->left), summary);
+	if (node->right != NIL)
+		map->option.aug_combine(summary, summary, cmap_node_summary(map, node->right));
+}
+
+/**
+ * cmap_node_update_path - fixing the subtree sizes and summaries of a cmap node and its ancestors.
+ * @map:	the cmap object owning the node.
+ * @node:	a node in @map, or NIL.
+ * @diff:	the number added to the sizes. (It wraps around for a negative number.)
+ *
+ * Linking or unlinking a node changes the subtree sizes and summaries of all its
+ * ancestors, and updating a value changes the summaries of the node and its ancestors.
+ * They are fixed by this function before any rotation. It does nothing if @map is
+ * not in the order statistics mode or the interval mode, and not augmented.
+ */
+static void cmap_node_update_path(cmap_t *map, cmap_node_t *node, size_t diff) {
+	if (!map->option.order_statistics && map->option.interval_end == NULL &&
+	    map->option.aug_size == 0)
+		return;
+	for (; node != NIL; node = cmap_node_parent(node)) {
+		cmap_node_set_subtree_size(map, node, cmap_node_subtree_size(map, node) + diff);
+		cmap_node_update_summary(map, node);
+	}
 }
 
 /**
  * cmap_node_cmp - doing comparsion between the key of a node and another key.
  * 
  * Because of involving comparsion of keys when searching, inserting and deleting,
- * this function, also being a method of a cmap node, is calling cmp() method of the 
- * key in the cmap node to compare another key, then returning its result..
+ * this function is calling cmp() method of the key interface of the cmap object
+ * to compare the key in the cmap node to another key, then returning its result..
+ *
+ * It is used by a single comparsion, and a descent compares every node by
+ * cmap_node_cmp_prefix() with the prefix of the key found once by cmap_key_prefix().
+ */
+static inline int cmap_node_cmp(cmap_t *map, cmap_node_t *node, const void *key) {
+	return cmap_node_cmp_prefix(map, node, key, cmap_key_prefix(map, key));
+}
+
+/**
+ * cmap_key_prefix - the prefix of a key compared by cmap_node_cmp_prefix().
+ * @map:	the cmap object.
+ * @key:	the key which will be compared with the nodes of @map.
+ *
+ * It is the prefix of a string key found by cmap_str_prefix(), and 0 for other kinds.
+ */
+static inline uint64_t cmap_key_prefix(cmap_t *map, const void *key) {
+	return map->key_interface.kind == CMAP_KIND_STRING ? cmap_str_prefix(key) : 0;
+}
+
+/**
+ * cmap_node_cmp_prefix - doing comparsion between the key of a node and a key with its prefix.
+ * @map:	the cmap object owning the node.
+ * @node:	an object of a cmap node.
+ * @key:	the other key.
+ * @key_prefix:	the prefix of @key by cmap_key_prefix().
+ *
+ * The built-in kinds of keys are compared here without the indirect call. A string
+ * key is compared by its cached prefix first, and the strings are only read when the
+ * prefixes are equal: if the string of the node ends within the prefix, the other
+ * string ends at the same place, otherwise the rest of them is compared by strcmp().
  */
-static int cmap_node_cmp(cmap_node_t *node, const void *key) {
-	return node->key.cmp(node->key.data, key);
+static inline int cmap_node_cmp_prefix(cmap_t *map, cmap_node_t *node, const void *key,
+				       uint64_t key_prefix) {
+	switch (map->key_interface.kind) {
+	case CMAP_KIND_STRING: {
+		uint64_t node_prefix = *cmap_node_prefix(map, node);
+		if (node_prefix != key_prefix)
+			return node_prefix < key_prefix ? -1 : 1;
+		if ((node_prefix & 0xff) == 0)
+			return 0;
+		return strcmp((const char *)node->key + 8, (const char *)key + 8);
+	}
+	case CMAP_KIND_INT32: {
+		int32_t node_key = *(const int32_t *)node->key, other = *(const int32_t *)key;
+		return (node_key > other) - (node_key < other);
+	}
+	case CMAP_KIND_INT64: {
+		int64_t node_key = *(const int64_t *)node->key, other = *(const int64_t *)key;
+		return (node_key > other) - (node_key < other);
+	}
+	case CMAP_KIND_UINT64: {
+		uint64_t node_key = *(const uint64_t *)node->key, other = *(const uint64_t *)key;
+		return (node_key > other) - (node_key < other);
+	}
+	default:
+		return map->key_interface.cmp(node->key, key);
+	}
 }
 
 /**
  * cmap_node_insert_key - inserting a given key into a cmap node.
+ * @map:	the cmap object owning the node.
  * @node:	an object of a cmap node.
  * @key:	a given key.
  *
- * This is a method of a cmap node.
  * The bahavior is that deallocates the original data in the cmap node 
  * (Actually, it always has no data because every new key doesn't exist in
  * the cmap object before inserting.)
- * then allocating an appropriate size for the new data.
+ * then storing the new data by cmap_data_store(), which either uses the inline
+ * storage of the node or allocates an appropriate size for the new data.
  * Finally, copying the data from a given key to the key of the cmap node by
  * calling copy() method of the key.
  */
-static void cmap_node_insert_key(cmap_node_t *node, const void *key) {
-	size_t new_key_size = node->key.data_size_get(key);
-	if (node->key.data != NULL) {
-		if (node->key.destroy)
-			node->key.destroy(node->key.data);
-		node->key.dealloc(node->key.data);
-	}
-	node->key.data = calloc(1, new_key_size);
-	node->key.copy(node->key.data, key, new_key_size);
+static void cmap_node_insert_key(cmap_t *map, cmap_node_t *node, const void *key) {
+	cmap_data_t *interface = &map->key_interface;
+	void *inline_key = cmap_node_inline_key(map, node);
+	if (node->key != NULL)
+		cmap_data_release(interface, node->key, inline_key);
+	cmap_data_store(interface, &node->key, inline_key, key);
 }
 
 /**
  * cmap_node_insert_val - inserting a given value into a cmap node.
+ * @map:	the cmap object owning the node.
  * @node:	an object of a cmap node.
  * @val:	a given value.
  *
- * This is a method of a cmap node.
  * The bahavior is that deallocates the original data in the cmap node 
  * 
  * Because insertig a new value are occurred when inserting a new key or updating 
@@ -167,15 +486,12 @@ static void cmap_node_insert_key(cmap_node_t *node, const void *key) {
  * the important difference mentioned before, deallocates the original data and then allocate
  * and copy the new data of a given value.
  */
-static void cmap_node_insert_val(cmap_node_t *node, const void *val) {
-	size_t new_val_size = node->val.data_size_get(val);
-	if (node->val.data != NULL) {
-		if (node->val.destroy)
-			node->val.destroy(node->val.data);
-		node->val.dealloc(node->val.data);
-	}
-	node->val.data = calloc(1, new_val_size);
-	node->val.copy(node->val.data, val, new_val_size);
+static void cmap_node_insert_val(cmap_t *map, cmap_node_t *node, const void *val) {
+	cmap_data_t *interface = &map->val_interface;
+	void *inline_val = cmap_node_inline_val(map, node);
+	if (node->val != NULL)
+		cmap_data_release(interface, node->val, inline_val);
+	cmap_data_store(interface, &node->val, inline_val, val);
 }
 
 /**
@@ -183,42 +499,413 @@ static void cmap_node_insert_val(cmap_node_t *node, const void *val) {
  * @map:	a cmap object.
  * @key:	a given key	
  * @val:	a given value
+ * @move:	whether @key and @val are adopted rather than copied.
  * 
  * Needed to store cmap nodes dynamically, A cmap object creates a cmap node object by
  * calling this function to allocate a cmap node.
- * It calls calloc() and cmap_node_init() to allocate and initialize a cmap node object.
+ * It takes the memory from the pool of the cmap object and calls cmap_node_init()
+ * to initialize a cmap node object. The new node is added into the hash index
+ * of the hash_index option and the Bloom filter of the bloom_filter option, where
+ * its key is hashed once. The filter may be rebuilt first, which is safe because
+ * the new node is not linked yet and every linked node is in the tree.
  */
-static void *cmap_node_alloc(cmap_t *map, const void *key, const void *val) {
-	cmap_node_t node = cmap_node_init(map, key, val);
-	cmap_node_t *alloc_node = calloc(1, sizeof(cmap_node_t));
-	memcpy(alloc_node, &node, sizeof(cmap_node_t));
+static void *cmap_node_alloc(cmap_t *map, const void *key, const void *val, bool move) {
+	cmap_node_t *alloc_node = cmap_pool_alloc(&map->pool);
+	cmap_node_init(map, alloc_node, key, val, move);
+	if (map->option.hash_index || map->option.bloom_filter) {
+		uint64_t hash = cmap_key_hash(map, alloc_node->key);
+		if (map->option.bloom_filter) {
+			cmap_bloom_maintain(map, 1);
+			cmap_bloom_add(map, hash);
+		}
+		if (map->option.hash_index)
+			cmap_index_insert(map, alloc_node, hash);
+	}
+	map->count++;
 	return alloc_node;
 }
 
 /**
- * cmap_node_destroy - destructor for cmap node.
- * @node:	an object of cmap node.
+ * cmap_node_destroy - destructor for the keys and values in a subtree of cmap nodes.
+ * @map:	the cmap object owning the subtree.
+ * @node:	the root of the subtree.
  * 
- * Created by allocation, the way to destroy a cmap node is calls
- * a recursive function to deallocate its left and right subtrees then
- * destroying itself.
+ * Key and value objects are destroyed and deallocated by the methods of key_interface
+ * and val_interface of the cmap object, which may be given destroy() implementations
+ * by user.
  *
- * The process is a postorder traversal and destroies and deallocates key and 
- * value objects, which may be given destroy() implementations by user, and then
- * the node calls dealloc() method to free itself.
+ * The subtree is walked without recursion or a stack, so a huge tree cannot overflow
+ * the call stack. Whenever the current node has a left child, the child is rotated
+ * up (parents and colors are not kept, since the tree is being torn down); otherwise
+ * the node is released and its right child is the next one. Each rotation moves a
+ * node onto the right spine for good, so it takes O(n) in total.
+ *
+ * Nothing is walked if neither interface owns its objects (borrowed), and destroy()
+ * and dealloc() are called only for objects which need them, so a node with inline
+ * objects and no destructor costs no indirect call at all.
+ * The memory of the nodes belongs to the pool of the cmap object, so the caller
+ * resets or releases the pool afterwards.
  */
-static void cmap_node_destroy(cmap_node_t *node) {
-	if (node != NIL) {
-		node->destroy(node->left);
-		node->destroy(node->right);
-		if (node->key.destroy)
-			node->key.destroy(node->key.data);
-		if (node->val.destroy)
-			node->val.destroy(node->val.data);
-		node->key.dealloc(node->key.data);
-		node->val.dealloc(node->val.data);
-		node->dealloc(node);
+static void cmap_node_destroy(cmap_t *map, cmap_node_t *node) {
+	cmap_data_t *key_interface = &map->key_interface;
+	cmap_data_t *val_interface = &map->val_interface;
+	if (key_interface->borrowed && val_interface->borrowed)
+		return;
+	while (node != NIL) {
+		cmap_node_t *left = node->left;
+		if (left != NIL) {
+			node->left = left->right;
+			left->right = node;
+			node = left;
+			continue;
+		}
+		if (!key_interface->borrowed && node->key != NULL) {
+			if (key_interface->destroy)
+				key_interface->destroy(node->key);
+			if (node->key != cmap_node_inline_key(map, node))
+				key_interface->dealloc(node->key);
+		}
+		if (!val_interface->borrowed && node->val != NULL) {
+			if (val_interface->destroy)
+				val_interface->destroy(node->val);
+			if (node->val != cmap_node_inline_val(map, node))
+				val_interface->dealloc(node->val);
+		}
+		node = node->right;
+	}
+}
+
+/**
+ * cmap_node_release - destructor for a cmap node unlinked from a cmap object.
+ * @map:	the cmap object owning the node.
+ * @node:	an object of cmap node, which is no longer linked in @map.
+ *
+ * It destroies and deallocates the key and value of the node, then returning
+ * the node to the pool of the cmap object.
+ * erase() calls it directly unless the retire() hook of the cmap object is set,
+ * in which case the hook calls it once no one may access the node.
+ */
+void cmap_node_release(cmap_t *map, cmap_node_t *node) {
+	cmap_data_release(&map->key_interface, node->key,
+			  cmap_node_inline_key(map, node));
+	cmap_data_release(&map->val_interface, node->val,
+			  cmap_node_inline_val(map, node));
+	cmap_pool_free(&map->pool, node);
+}
+
+/**
+ * cmap_data_store - storing a copy of an object into a cmap node.
+ * @interface:	the interface of the object (key_interface or val_interface).
+ * @data:	the field of the node pointing to the stored data.
+ * @inline_data:the inline storage of the node for the object.
+ * @src:	the object given by user.
+ *
+ * If the size of the object is not larger than the inline_size of @interface,
+ * the object is copied into the inline storage of the node. Otherwise, an
+ * appropriate size is allocated for it. The destination is zeroed before
+ * calling copy() like calloc().
+ * A borrowed object is not copied, and the pointer given by user is kept.
+ */
+void cmap_data_store(cmap_data_t *interface, void **data, void *inline_data,
+		     const void *src) {
+	if (interface->borrowed) {
+		*data = (void *)src;
+		return;
+	}
+	size_t size = interface->data_size_get(src);
+	if (size <= interface->inline_size) {
+		memset(inline_data, 0, interface->inline_size);
+		*data = inline_data;
+	}
+	else
+		*data = calloc(1, size);
+	interface->copy(*data, src, size);
+}
+
+/**
+ * cmap_data_release - destroying and deallocating an object stored in a cmap node.
+ * @interface:	the interface of the object (key_interface or val_interface).
+ * @data:	the stored data.
+ * @inline_data:the inline storage of the node for the object.
+ *
+ * The object is destroyed by destroy() of @interface if it is given, and it is
+ * deallocated only if it is not stored in the inline storage.
+ * A borrowed object belongs to user, so nothing is done for it, and neither is
+ * anything done for an object taken out by cmap_data_detach() (NULL).
+ */
+void cmap_data_release(cmap_data_t *interface, void *data, void *inline_data) {
+	if (interface->borrowed || data == NULL)
+		return;
+	if (interface->destroy)
+		interface->destroy(data);
+	if (data != inline_data)
+		interface->dealloc(data);
+}
+
+/**
+ * cmap_data_detach - taking an object out of a cmap node without destroying it.
+ * @interface:	the interface of the object (key_interface or val_interface).
+ * @data:	the stored data.
+ * @inline_data:the inline storage of the node for the object.
+ *
+ * An allocated (or borrowed) object is handed over as it is. An object in the
+ * inline storage is moved into a buffer allocated by malloc(), since the node
+ * will be reused.
+ */
+void *cmap_data_detach(cmap_data_t *interface, void *data, void *inline_data) {
+	if (data != inline_data || interface->borrowed)
+		return data;
+	size_t size = interface->data_size_get(data);
+	void *moved = malloc(size);
+	memcpy(moved, data, size);
+	return moved;
+}
+
+/**
+ * cmap_pool_alloc - allocating the memory of a cmap node from a pool.
+ * @pool:	the pool of a cmap object.
+ *
+ * A node released by erase() is reused first, which is a pointer pop from
+ * the free list. Otherwise, the next unused node of the newest chunk is taken,
+ * and a new chunk with CMAP_POOL_CHUNK_NODES nodes is allocated only when the
+ * newest chunk is exhausted.
+ */
+void *cmap_pool_alloc(cmap_pool_t *pool) {
+	void *node = pool->free_nodes;
+	if (node != NULL) {
+		pool->free_nodes = *(void **)node;
+		return node;
+	}
+	if (pool->cursor == pool->limit)
+		cmap_pool_grow(pool, CMAP_POOL_CHUNK_NODES);
+	node = pool->cursor;
+	pool->cursor += pool->node_size;
+	return node;
+}
+
+/**
+ * cmap_pool_reserve - making sure that a pool has unused memory for several cmap nodes.
+ * @pool:	the pool of a cmap object.
+ * @nodes:	the number of the nodes which will be allocated.
+ *
+ * If the newest chunk cannot hold @nodes more nodes, a chunk large enough for all
+ * of them is allocated at once, so the following @nodes calls of cmap_pool_alloc()
+ * never allocate memory. (The rest of the previous chunk is left unused.)
+ */
+static void cmap_pool_reserve(cmap_pool_t *pool, size_t nodes) {
+	if ((size_t)(pool->limit - pool->cursor) / pool->node_size < nodes)
+		cmap_pool_grow(pool, nodes > CMAP_POOL_CHUNK_NODES ? nodes
+								  : CMAP_POOL_CHUNK_NODES);
+}
+
+/**
+ * cmap_pool_grow - allocating a new chunk for a pool.
+ * @pool:	the pool of a cmap object.
+ * @nodes:	the number of the nodes held by the new chunk.
+ *
+ * The new chunk becomes the newest chunk, whose nodes are taken by
+ * cmap_pool_alloc() one by one. A spare chunk left by cmap_pool_reset() is
+ * taken if it holds at least @nodes nodes, and then all of them are used.
+ */
+static void cmap_pool_grow(cmap_pool_t *pool, size_t nodes) {
+	struct cmap_pool_chunk *chunk, **link = (struct cmap_pool_chunk **)&pool->spare;
+	while (*link != NULL && (*link)->nodes < nodes)
+		link = &(*link)->next;
+	if (*link != NULL) {
+		chunk = *link;
+		*link = chunk->next;
+		nodes = chunk->nodes;
+	}
+	else {
+		chunk = malloc(sizeof(struct cmap_pool_chunk) + nodes * pool->node_size);
+		chunk->nodes = nodes;
+	}
+	chunk->next = pool->chunks;
+	pool->chunks = chunk;
+	pool->cursor = (char *)(chunk + 1);
+	pool->limit = pool->cursor + nodes * pool->node_size;
+}
+
+/**
+ * cmap_pool_free - returning the memory of a cmap node to a pool.
+ * @pool:	the pool of a cmap object.
+ * @node:	a node allocated by cmap_pool_alloc() from @pool.
+ *
+ * The node is pushed onto the intrusive free list of the pool; its first
+ * bytes are reused to link the next free node.
+ */
+void cmap_pool_free(cmap_pool_t *pool, void *node) {
+	*(void **)node = pool->free_nodes;
+	pool->free_nodes = node;
+}
+
+/**
+ * cmap_pool_reset - making all chunks of a pool unused for reuse.
+ * @pool:	the pool of a cmap object.
+ *
+ * All nodes allocated from the pool are given back at once without freeing any
+ * memory. Every chunk becomes a spare chunk, which cmap_pool_grow() takes again
+ * before allocating a new one, so refilling the cmap object needs no malloc()
+ * until it grows beyond its previous size.
+ */
+void cmap_pool_reset(cmap_pool_t *pool) {
+	struct cmap_pool_chunk *chunk = pool->chunks;
+	while (chunk != NULL) {
+		struct cmap_pool_chunk *next = chunk->next;
+		chunk->next = pool->spare;
+		pool->spare = chunk;
+		chunk = next;
+	}
+	pool->chunks = pool->free_nodes = NULL;
+	pool->cursor = pool->limit = NULL;
+}
+
+/**
+ * cmap_pool_destroy - releasing all chunks of a pool.
+ * @pool:	the pool of a cmap object.
+ *
+ * All nodes allocated from the pool are released at once, then the pool
+ * becomes empty and can be used again.
+ */
+void cmap_pool_destroy(cmap_pool_t *pool) {
+	cmap_pool_reset(pool);
+	struct cmap_pool_chunk *chunk = pool->spare;
+	while (chunk != NULL) {
+		struct cmap_pool_chunk *next = chunk->next;
+		free(chunk);
+		chunk = next;
+	}
+	*pool = (cmap_pool_t){.node_size = pool->node_size};
+}
+
+/**
+ * cmap_key_hash - the mixed hash of a key of a cmap object.
+ * @map:	the cmap object with the hash_index option.
+ * @key:	the key.
+ *
+ * The built-in kinds of keys are hashed without the indirect call, like
+ * cmap_node_cmp(). The hash is mixed so that the low bits used by the table
+ * depend on all bits of a weak hash given by user (the identity of integers).
+ * It has 64 bits even if size_t is narrower, since the Bloom filter takes its
+ * block from the high 32 bits and its bits from the low 32 bits.
+ */
+static inline uint64_t cmap_key_hash(cmap_t *map, const void *key) {
+	uint64_t hash;
+	switch (map->key_interface.kind) {
+	case CMAP_KIND_STRING:
+		hash = cmap_str_hash(key);
+		break;
+	case CMAP_KIND_INT32:
+		hash = (uint64_t)*(const int32_t *)key;
+		break;
+	case CMAP_KIND_INT64:
+	case CMAP_KIND_UINT64:
+		hash = *(const uint64_t *)key;
+		break;
+	default:
+		hash = map->key_interface.hash(key);
+	}
+	hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebULL;
+	return hash ^ (hash >> 31);
+}
+
+/**
+ * cmap_index_find - finding the node of a key by the hash index.
+ * @map:	the cmap object with the hash_index option.
+ * @key:	the target key.
+ *
+ * The slots are probed linearly from the slot of the hash until an empty one,
+ * and only the nodes with the same hash are compared, so a lookup usually reads
+ * one slot and one node. It returns NIL if the key does not exist.
+ */
+static cmap_node_t *cmap_index_find(cmap_t *map, const void *key) {
+	struct cmap_index_slot *slots = map->index.slots;
+	if (slots == NULL)
+		return NIL;
+	size_t hash = cmap_key_hash(map, key), mask = map->index.capacity - 1;
+	for (size_t i = hash & mask; slots[i].node != NIL; i = (i + 1) & mask)
+		if (slots[i].hash == hash && cmap_node_cmp(map, slots[i].node, key) == 0)
+			return slots[i].node;
+	return NIL;
+}
+
+/**
+ * cmap_index_insert - adding a new node into the hash index.
+ * @map:	the cmap object with the hash_index option.
+ * @node:	the new node, whose key is not in the index yet.
+ * @hash:	the hash of the key of @node by cmap_key_hash().
+ *
+ * The table is doubled first if the new node would make it more than 3/4 full.
+ */
+static void cmap_index_insert(cmap_t *map, cmap_node_t *node, size_t hash) {
+	if ((map->count + 1) * 4 > map->index.capacity * 3)
+		cmap_index_grow(map);
+	struct cmap_index_slot *slots = map->index.slots;
+	size_t mask = map->index.capacity - 1, i;
+	for (i = hash & mask; slots[i].node != NIL; i = (i + 1) & mask)
+		;
+	slots[i] = (struct cmap_index_slot){.hash = hash, .node = node};
+}
+
+/**
+ * cmap_index_grow - doubling the slots of the hash index.
+ * @map:	the cmap object with the hash_index option.
+ *
+ * Every node is moved into the new table by the hash kept in its slot.
+ */
+static void cmap_index_grow(cmap_t *map) {
+	struct cmap_index_slot *old_slots = map->index.slots;
+	size_t old_capacity = map->index.capacity;
+	size_t capacity = old_capacity == 0 ? CMAP_INDEX_MIN_CAPACITY : old_capacity * 2;
+	struct cmap_index_slot *slots = calloc(capacity, sizeof(struct cmap_index_slot));
+	for (size_t j = 0; j < old_capacity; j++) {
+		if (old_slots[j].node == NIL)
+			continue;
+		size_t i = old_slots[j].hash & (capacity - 1);
+		while (slots[i].node != NIL)
+			i = (i + 1) & (capacity - 1);
+		slots[i] = old_slots[j];
+	}
+	free(old_slots);
+	map->index = (cmap_index_t){.slots = slots, .capacity = capacity};
+}
+
+/**
+ * cmap_index_remove - removing a node from the hash index.
+ * @map:	the cmap object with the hash_index option.
+ * @node:	a node in the index, whose key is still stored.
+ *
+ * The following nodes of the probe sequence are shifted back into the hole when
+ * it is between their own slots and them, so no tombstone is left and a probe
+ * always stops at the first empty slot.
+ */
+static void cmap_index_remove(cmap_t *map, cmap_node_t *node) {
+	struct cmap_index_slot *slots = map->index.slots;
+	size_t mask = map->index.capacity - 1, i = cmap_key_hash(map, node->key) & mask;
+	while (slots[i].node != node)
+		i = (i + 1) & mask;
+	for (size_t j = (i + 1) & mask; slots[j].node != NIL; j = (j + 1) & mask) {
+		if (((j - slots[j].hash) & mask) >= ((j - i) & mask)) {
+			slots[i] = slots[j];
+			i = j;
+		}
 	}
+	slots[i].node = NIL;
+}
+
+/**
+ * cmap_index_reset - making the hash index empty.
+ * @map:	the cmap object.
+ * @release:	whether the table is released rather than kept for the following inserts.
+ */
+static void cmap_index_reset(cmap_t *map, bool release) {
+	if (release) {
+		free(map->index.slots);
+		map->index = (cmap_index_t){.slots = NULL, .capacity = 0};
+	}
+	else if (map->index.slots != NULL)
+		memset(map->index.slots, 0, map->index.capacity * sizeof(struct cmap_index_slot));
 }
 
 
@@ -235,14 +922,14 @@ static void cmap_node_destroy(cmap_node_t *node) {
 static int cmap_postorder(cmap_node_t *node) {
 	int leftpath = 0, rightpath = 0;
 	if (node != NIL) {
-		if ((node->left != NIL && node->left->parent != node) ||
-		    (node->right != NIL && node->right->parent != node)) {
+		if ((node->left != NIL && cmap_node_parent(node->left) != node) ||
+		    (node->right != NIL && cmap_node_parent(node->right) != node)) {
 			fprintf(stderr, "The child's parent is inequal to the "
 					"actual parent\n");
 			exit(0);
 		}
-		if (node->black == false && (node->left->black == false ||
-					     node->right->black == false)) {
+		if (!cmap_node_black(node) && (!cmap_node_black(node->left) ||
+					       !cmap_node_black(node->right))) {
 			fprintf(stderr,
 				"A red node has a least one red child node\n");
 			exit(0);
@@ -255,20 +942,87 @@ static int cmap_postorder(cmap_node_t *node) {
 			exit(0);
 		}
 	}
-	return leftpath + node->black;
+	return leftpath + cmap_node_black(node);
+}
+
+/**
+ * cmap_subtree_validate() is used by cmap_validate() to count the nodes of
+ * a subtree, and it checks the subtree sizes in the order statistics mode
+ * and that the Bloom filter of the bloom_filter option has every key.
+ */
+static size_t cmap_subtree_validate(cmap_t *map, cmap_node_t *node) {
+	if (node == NIL)
+		return 0;
+	size_t size = cmap_subtree_validate(map, node->left) +
+		      cmap_subtree_validate(map, node->right) + 1;
+	if (map->option.order_statistics && cmap_node_subtree_size(map, node) != size) {
+		fprintf(stderr, "The subtree size of a cmap node is wrong\n");
+		exit(0);
+	}
+	if (map->option.bloom_filter && !cmap_bloom_contains(map, node->key)) {
+		fprintf(stderr, "A key of the cmap is missed by the Bloom filter\n");
+		exit(0);
+	}
+	if (map->option.interval_end != NULL) {
+		const void *max_end = *cmap_node_max_end(map, node);
+		bool found = map->key_interface.cmp(
+				     map->option.interval_end(node->key, node->val), max_end) == 0;
+		for (int i = 0; i < 2; i++) {
+			cmap_node_t *child = i == 0 ? node->left : node->right;
+			if (child == NIL)
+				continue;
+			if (map->key_interface.cmp(*cmap_node_max_end(map, child), max_end) > 0) {
+				fprintf(stderr, "The largest end of a cmap node is too small\n");
+				exit(0);
+			}
+			found |= map->key_interface.cmp(*cmap_node_max_end(map, child), max_end) == 0;
+		}
+		if (!found) {
+			fprintf(stderr, "The largest end of a cmap node is too large\n");
+			exit(0);
+		}
+	}
+	return size;
 }
 
-static void cmap_validate(cmap_t *map) {
-	if (map->root->black == false) {
+/**
+ * cmap_validate - checking every property of the red-black tree of a cmap object (DEBUG).
+ * @map:	the target cmap object.
+ *
+ * It prints the broken property and exits if the tree is wrong. It is also used by
+ * the writers of cmap_concurrent.c which modify the tree without its methods.
+ */
+void cmap_validate(cmap_t *map) {
+	if (!cmap_node_black(map->root)) {
 		fprintf(stderr, "The root's color of the cmap is not black\n");
 		exit(0);
 	}
 	cmap_postorder(map->root);
-	if (nil_node.black == false || nil_node.parent != NIL ||
-	    nil_node.left != NIL || nil_node.right != NIL) {
-		fprintf(stderr, "The properties of nil_node has been broken\n");
+	if (map->root != NIL && cmap_node_parent(map->root) != NIL) {
+		fprintf(stderr, "The root of the cmap has a parent\n");
+		exit(0);
+	}
+	cmap_node_t *rightmost = map->root;
+	while (rightmost != NIL && rightmost->right != NIL)
+		rightmost = rightmost->right;
+	if (map->rightmost != rightmost) {
+		fprintf(stderr, "The rightmost node of the cmap is wrong\n");
+		exit(0);
+	}
+	if (cmap_subtree_validate(map, map->root) != map->count) {
+		fprintf(stderr, "The number of the nodes of the cmap is wrong\n");
 		exit(0);
 	}
+	if (map->option.hash_index) {
+		struct cmap_index_slot *slots = map->index.slots;
+		size_t indexed = 0;
+		for (size_t i = 0; i < map->index.capacity; i++)
+			indexed += slots[i].node != NIL;
+		if (indexed != map->count) {
+			fprintf(stderr, "The number of the nodes in the hash index of the cmap is wrong\n");
+			exit(0);
+		}
+	}
 }
 #endif
 
@@ -276,29 +1030,129 @@ static void cmap_validate(cmap_t *map) {
  * Functions for cmap
  * 
  * cmap_init():			Constructor of cmap.
+ * cmap_init3():		Constructor of cmap with options.
  * cmap_alloc():		Allocation of a cmap object.
+ * cmap_alloc3():		Allocation of a cmap object with options.
  * cmap_left_rotation():	Left rotation for a cmap object and its certain node.
  * cmap_right_rotation():	Right rotation for a cmap object and its certain node.
  * cmap_search():		The search function for cmap by given key.
  * cmap_insert():		Inserting the given key and value into a cmap object.
+ * cmap_locate():		Finding the node of a key, or linking a new node with the key.
+ * cmap_node_locate():		Finding the node of a key in a subtree, or linking a new node with the key.
+ * cmap_node_link():		Linking a new node at a missing child of a node.
+ * cmap_node_replace():		Replacing a node by a new node with the same key and a new value.
+ * cmap_node_insert():		Inserting the given key and value into a subtree of a cmap object.
+ * cmap_node_append():		Inserting a key larger than all keys of a cmap object.
+ * cmap_insert_hint():		Inserting the given key and value at a position given by user.
+ * cmap_get_or_insert():	The value of a key, which is inserted with a default value if it is missing.
+ * cmap_upsert():		Merging a delta into the value of a key in place, or inserting the delta.
+ * cmap_insert_move():		Inserting allocated key and value adopted without copying.
+ * cmap_insert_batch():		Inserting unsorted keys and values into a cmap object in ascending order.
+ * cmap_sort():			Sorting the indices of keys by merge sort.
  * cmap_insert_fixup():		Fixup function for a cmap object after inserting a new node.
  * cmap_erase():		Erasing a node with the assigned key from a cmap object.
+ * cmap_node_erase():		Erasing a given node from a cmap object.
+ * cmap_node_retire():		Handing a node unlinked from a cmap object to the retire hook or the pool.
  * cmap_erase_fixup():		Fixup function for a cmap object after erasing a node.
- * cmap_node_successor():	Finding the successor for a node in a cmap object.
+ * cmap_erase_range():		Erasing all keys in a range from a cmap object.
+ * cmap_count_range():		Counting the keys in a range of a cmap object.
+ * cmap_black_height():		The black height of a cmap object.
+ * cmap_node_join():		Joining two trees and a node between them into a tree.
+ * cmap_node_split():		Splitting a tree into the keys less than a key and the others.
+ * cmap_node_retire_tree():	Handing all nodes of a detached subtree to cmap_node_retire().
+ * cmap_build_sorted():		Building a cmap object from sorted keys and values.
+ * cmap_node_build():		Building a balanced subtree from a part of sorted keys and values.
+ * cmap_node_first():		Finding the node with the smallest key in a subtree.
+ * cmap_node_next():		Finding the next node in ascending order of keys.
+ * cmap_node_last():		Finding the node with the largest key in a subtree.
+ * cmap_node_prev():		Finding the previous node in ascending order of keys.
+ * cmap_foreach():		Visiting all keys and values of a cmap object in ascending order.
+ * cmap_iter():			Making an iterator at a node.
+ * cmap_begin():		The iterator at the smallest key.
+ * cmap_end():			The iterator after the largest key.
+ * cmap_next():			Moving an iterator to the next larger key.
+ * cmap_prev():			Moving an iterator to the next smaller key.
+ * cmap_find():			The iterator at a given key.
+ * cmap_lower_bound():		The iterator at the first key not less than a given key.
+ * cmap_upper_bound():		The iterator at the first key larger than a given key.
+ * cmap_aggregate_range():	The summary of the keys in a range.
+ * cmap_interval_overlaps():	Visiting the intervals overlapping a range.
+ * cmap_node_overlaps():	Visiting the intervals in a subtree overlapping a range.
+ * cmap_size():			The number of keys of a cmap object.
+ * cmap_stats():		The memory usage of a cmap object.
+ * cmap_select():		The iterator at the key with a given rank.
+ * cmap_rank():			The number of keys less than a given key.
  * cmap_destroy():		Destructor of cmap.
  *
  * All details about the above functions are mentioned at their implementation places.
  */
 cmap_t cmap_init(cmap_data_t *key_interface, cmap_data_t *val_interface); 
-void *cmap_alloc(cmap_data_t *key_interface, cmap_data_t *val_interface); 
+cmap_t cmap_init3(cmap_data_t *key_interface, cmap_data_t *val_interface,
+		 const cmap_option_t *option);
+void *cmap_alloc(cmap_data_t *key_interface, cmap_data_t *val_interface);
+void *cmap_alloc3(cmap_data_t *key_interface, cmap_data_t *val_interface,
+		  const cmap_option_t *option);
 static void cmap_left_rotation(cmap_t *map, cmap_node_t *node);
 static void cmap_right_rotation(cmap_t *map, cmap_node_t *node); 
 static void *cmap_search(cmap_t *map, const void *key);
 static void cmap_insert(cmap_t *map, const void *key, const void *val); 
-static void cmap_insert_fixup(cmap_t *map, cmap_node_t *node);
+static cmap_node_t *cmap_locate(cmap_t *map, const void *key, const void *val, bool move,
+				bool *found);
+static cmap_node_t *cmap_node_locate(cmap_t *map, cmap_node_t *node, const void *key,
+				     const void *val, bool move, bool *found);
+static cmap_node_t *cmap_node_insert(cmap_t *map, cmap_node_t *node, const void *key,
+				     const void *val);
+static void *cmap_get_or_insert(cmap_t *map, const void *key, const void *default_val);
+static void *cmap_upsert(cmap_t *map, const void *key, const void *delta, cmap_merge_t merge);
+static void cmap_insert_move(cmap_t *map, void *key, void *val);
+static cmap_node_t *cmap_node_append(cmap_t *map, const void *key, const void *val,
+				     bool move);
+static cmap_iter_t cmap_insert_hint(cmap_t *map, cmap_iter_t hint, const void *key,
+				    const void *val);
+static void cmap_insert_batch(cmap_t *map, const void *const *keys,
+			      const void *const *vals, size_t n);
+static bool cmap_insert_fixup(cmap_t *map, cmap_node_t *node);
 static bool cmap_erase(cmap_t *map, const void *key); 
-static void cmap_erase_fixup(cmap_t *map, cmap_node_t *node); 
-static cmap_node_t *cmap_node_successor(cmap_t *map, cmap_node_t *node);
+static bool cmap_extract(cmap_t *map, const void *key, void **key_out, void **val_out);
+static inline void cmap_node_retire(cmap_t *map, cmap_node_t *node);
+static void cmap_erase_fixup(cmap_t *map, cmap_node_t *node, cmap_node_t *parent); 
+static size_t cmap_erase_range(cmap_t *map, const void *low, const void *high);
+static size_t cmap_count_range(cmap_t *map, const void *low, const void *high);
+static size_t cmap_black_height(cmap_t *map);
+static cmap_node_t *cmap_node_join(cmap_t *map, cmap_node_t *left, size_t left_height,
+				   cmap_node_t *node, cmap_node_t *right,
+				   size_t right_height, size_t *height);
+static cmap_node_t *cmap_node_split(cmap_t *map, cmap_node_t *node, size_t height,
+				    const void *key, size_t *left_height,
+				    cmap_node_t **right, size_t *right_height);
+static size_t cmap_node_retire_tree(cmap_t *map, cmap_node_t *node);
+static bool cmap_build_sorted(cmap_t *map, const void *const *keys,
+			      const void *const *vals, size_t n);
+static cmap_node_t *cmap_node_build(cmap_t *map, const void *const *keys,
+				    const void *const *vals, size_t n, size_t depth,
+				    size_t red_depth, cmap_node_t *parent);
+static cmap_node_t *cmap_node_first(cmap_node_t *node);
+static cmap_node_t *cmap_node_next(cmap_node_t *node);
+static cmap_node_t *cmap_node_last(cmap_node_t *node);
+static cmap_node_t *cmap_node_prev(cmap_node_t *node);
+static bool cmap_foreach(cmap_t *map, cmap_visit_t visit, void *arg);
+static inline cmap_iter_t cmap_iter(cmap_node_t *node);
+static cmap_iter_t cmap_begin(cmap_t *map);
+static cmap_iter_t cmap_end(cmap_t *map);
+static cmap_iter_t cmap_next(cmap_t *map, cmap_iter_t iter);
+static cmap_iter_t cmap_prev(cmap_t *map, cmap_iter_t iter);
+static cmap_iter_t cmap_find(cmap_t *map, const void *key);
+static cmap_iter_t cmap_lower_bound(cmap_t *map, const void *key);
+static cmap_iter_t cmap_upper_bound(cmap_t *map, const void *key);
+static bool cmap_aggregate_range(cmap_t *map, const void *low, const void *high, void *summary);
+static bool cmap_interval_overlaps(cmap_t *map, const void *low, const void *high,
+				   cmap_visit_t visit, void *arg);
+static bool cmap_node_overlaps(cmap_t *map, cmap_node_t *node, const void *low,
+			       const void *high, cmap_visit_t visit, void *arg);
+static size_t cmap_size(cmap_t *map);
+static cmap_iter_t cmap_select(cmap_t *map, size_t rank);
+static size_t cmap_rank(cmap_t *map, const void *key);
+static void cmap_clear(cmap_t *map);
 static void cmap_destroy(cmap_t *);
 
 /**
@@ -307,15 +1161,81 @@ static void cmap_destroy(cmap_t *);
  * @val_interface:	an object of cmap_data type with defiend implementation assigned by user for value.
  * 
  * This function initializes a cmap object, which contains key's and value's methods, 
- * then returning the object.
+ * then returning the object. All options are off.
  */
 cmap_t cmap_init(cmap_data_t *key_interface, cmap_data_t *val_interface) {
+	return cmap_init3(key_interface, val_interface, NULL);
+}
+
+/**
+ * cmap_init3 - constructor of cmap with options.
+ * @key_interface:	an object of cmap_data type with defined implementation assigned by user for key.
+ * @val_interface:	an object of cmap_data type with defiend implementation assigned by user for value.
+ * @option:		the options of the cmap object, or NULL for the default options.
+ *
+ * The size of the nodes allocated by the pool of the cmap object depends on the
+ * inline_size of the two interfaces and the options: a node of the order statistics
+ * mode has the size of its subtree, a node of the interval mode has the largest end
+ * in its subtree, and a node of an augmented cmap object has the summary of its subtree.
+ * A node whose key is of CMAP_KIND_STRING also has the prefix of the key.
+ * An augmented cmap object also allocates the scratch summary of aggregate_range().
+ * In the B-tree mode, the object is initialized by cmap_btree_init3() instead.
+ */
+cmap_t cmap_init3(cmap_data_t *key_interface, cmap_data_t *val_interface,
+		  const cmap_option_t *option) {
+	cmap_option_t map_option = {.order_statistics = false, .interval_end = NULL, .aug_size = 0};
+	if (option != NULL && option->btree)
+		return cmap_btree_init3(key_interface, val_interface, option);
+	if (option != NULL)
+		map_option = *option;
+	if (key_interface->hash == NULL && key_interface->kind == CMAP_KIND_CUSTOM)
+		map_option.hash_index = map_option.bloom_filter = false;
 	cmap_t map = {.root = NIL,
+		      .rightmost = NIL,
 		      .key_interface = *key_interface,
 		      .val_interface = *val_interface,
+		      .option = map_option,
+		      .count = 0,
+		      .retire = NULL,
+		      .index = {.slots = NULL, .capacity = 0},
+		      .bloom = {.memory = NULL, .blocks = NULL, .block_count = 0},
+		      .pool = {.node_size = sizeof(cmap_node_t) +
+					    CMAP_PREFIX_SIZE(key_interface) +
+					    CMAP_INLINE_SIZE(key_interface) +
+					    CMAP_INLINE_SIZE(val_interface) +
+					    (map_option.order_statistics ? sizeof(size_t) : 0) +
+					    (map_option.interval_end != NULL ? sizeof(void *) : 0) +
+					    CMAP_ROUND_SIZE(map_option.aug_size)},
+		      .scratch = map_option.aug_size != 0
+					 ? malloc(CMAP_ROUND_SIZE(map_option.aug_size))
+					 : NULL,
 		      .search = cmap_search,
 		      .insert = cmap_insert,
+		      .get_or_insert = cmap_get_or_insert,
+		      .upsert = cmap_upsert,
+		      .insert_move = cmap_insert_move,
+		      .insert_hint = cmap_insert_hint,
+		      .insert_batch = cmap_insert_batch,
 		      .erase = cmap_erase,
+		      .extract = cmap_extract,
+		      .erase_range = cmap_erase_range,
+		      .count_range = cmap_count_range,
+		      .build_sorted = cmap_build_sorted,
+		      .foreach = cmap_foreach,
+		      .begin = cmap_begin,
+		      .end = cmap_end,
+		      .next = cmap_next,
+		      .prev = cmap_prev,
+		      .find = cmap_find,
+		      .lower_bound = cmap_lower_bound,
+		      .upper_bound = cmap_upper_bound,
+		      .aggregate_range = cmap_aggregate_range,
+		      .interval_overlaps = cmap_interval_overlaps,
+		      .size = cmap_size,
+		      .stats = cmap_stats,
+		      .select = cmap_select,
+		      .rank = cmap_rank,
+		      .clear = cmap_clear,
 		      .destroy = cmap_destroy,
 		      .dealloc = free};
 	map.key_interface.data = map.val_interface.data = NULL;
@@ -331,7 +1251,20 @@ cmap_t cmap_init(cmap_data_t *key_interface, cmap_data_t *val_interface) {
  * of the allocated object.
  */
 void *cmap_alloc(cmap_data_t *key_interface, cmap_data_t *val_interface) {
-	cmap_t map = cmap_init(key_interface, val_interface);
+	return cmap_alloc3(key_interface, val_interface, NULL);
+}
+
+/**
+ * cmap_alloc3 - allocation for an cmap object with options.
+ * @key_interface:	an object of cmap_data type with defined implementation assigned by user for key.
+ * @val_interface:	an object of cmap_data type with defiend implementation assigned by user for value.
+ * @option:		the options of the cmap object, or NULL for the default options.
+ *
+ * It is the same as cmap_alloc() except that the object is initialized by cmap_init3().
+ */
+void *cmap_alloc3(cmap_data_t *key_interface, cmap_data_t *val_interface,
+		  const cmap_option_t *option) {
+	cmap_t map = cmap_init3(key_interface, val_interface, option);
 	cmap_t *alloc_map = malloc(sizeof(cmap_t));
 	memcpy(alloc_map, &map, sizeof(cmap_t));
 	return alloc_map;
@@ -343,30 +1276,40 @@ void *cmap_alloc(cmap_data_t *key_interface, cmap_data_t *val_interface) {
  * @node:	a node in the cmap object @map.
  * 
  * Rotating left counterclockwise for a node object in a cmap object.
+ * The right child takes the place (and the subtree size, largest end and summary) of
+ * the node, and those of the node are computed again from its new children.
  */
 static void cmap_left_rotation(cmap_t *map, cmap_node_t *node) {
-	cmap_node_t *parent = node->parent;
+	cmap_node_t *parent = cmap_node_parent(node);
 	cmap_node_t *right = node->right;
-	cmap_node_t **parent_child = NULL;
-	if (node == parent->left)
-		parent_child = &parent->left;
-	else
-		parent_child = &parent->right;
+	cmap_node_t **parent_child = &map->root;
+	if (parent != NIL)
+		parent_child = node == parent->left ? &parent->left
+						    : &parent->right;
 
-	node->right = right->left;
+	CMAP_LINK(node->right, right->left);
 
 	if (right->left != NIL)
-		right->left->parent = node;
+		cmap_node_set_parent(right->left, node);
 
-	right->parent = parent;
+	cmap_node_set_parent(right, parent);
+	CMAP_LINK(*parent_child, right);
 
-	if (parent != NIL)
-		*parent_child = right;
-	else
-		map->root = right;
+	CMAP_LINK(right->left, node);
+	cmap_node_set_parent(node, right);
 
-	right->left = node;
-	node->parent = right;
+	if (map->option.order_statistics) {
+		cmap_node_set_subtree_size(map, right, cmap_node_subtree_size(map, node));
+		cmap_node_set_subtree_size(map, node,
+					   cmap_node_subtree_size(map, node->left) +
+						   cmap_node_subtree_size(map, node->right) + 1);
+	}
+	if (map->option.interval_end != NULL)
+		*cmap_node_max_end(map, right) = *cmap_node_max_end(map, node);
+	if (map->option.aug_size != 0)
+		memcpy(cmap_node_summary(map, right), cmap_node_summary(map, node),
+		       map->option.aug_size);
+	cmap_node_update_summary(map, node);
 }
 
 /**
@@ -375,29 +1318,38 @@ static void cmap_left_rotation(cmap_t *map, cmap_node_t *node) {
  * @node:	a node in the cmap object @map.
  * 
  * Rotating right counterclockwise for a node object in a cmap object.
+ * The subtree sizes, largest ends and summaries are fixed like cmap_left_rotation().
  */
 static void cmap_right_rotation(cmap_t *map, cmap_node_t *node) {
-	cmap_node_t *parent = node->parent;
+	cmap_node_t *parent = cmap_node_parent(node);
 	cmap_node_t *left = node->left;
-	cmap_node_t **parent_child = NULL;
-	if (node == parent->left)
-		parent_child = &parent->left;
-	else
-		parent_child = &parent->right;
+	cmap_node_t **parent_child = &map->root;
+	if (parent != NIL)
+		parent_child = node == parent->left ? &parent->left
+						    : &parent->right;
 
-	node->left = left->right;
+	CMAP_LINK(node->left, left->right);
 
 	if (left->right != NIL)
-		left->right->parent = node;
+		cmap_node_set_parent(left->right, node);
 
-	left->parent = parent;
+	cmap_node_set_parent(left, parent);
+	CMAP_LINK(*parent_child, left);
+	CMAP_LINK(left->right, node);
+	cmap_node_set_parent(node, left);
 
-	if (parent != NIL)
-		*parent_child = left;
-	else
-		map->root = left;
-	left->right = node;
-	node->parent = left;
+	if (map->option.order_statistics) {
+		cmap_node_set_subtree_size(map, left, cmap_node_subtree_size(map, node));
+		cmap_node_set_subtree_size(map, node,
+					   cmap_node_subtree_size(map, node->left) +
+						   cmap_node_subtree_size(map, node->right) + 1);
+	}
+	if (map->option.interval_end != NULL)
+		*cmap_node_max_end(map, left) = *cmap_node_max_end(map, node);
+	if (map->option.aug_size != 0)
+		memcpy(cmap_node_summary(map, left), cmap_node_summary(map, node),
+		       map->option.aug_size);
+	cmap_node_update_summary(map, node);
 }
 
 /**
@@ -408,13 +1360,22 @@ static void cmap_right_rotation(cmap_t *map, cmap_node_t *node) {
  * It does binary search in a cmap object for the target key,
  * thening returning either the pointer to the corresponding value 
  * or NULL pointer if the key is found or not found, respectively.
+ * With the hash_index option, the key is found by cmap_index_find() instead.
+ * With the bloom_filter option, a key missed by the filter returns NULL at once.
  */
 void *cmap_search(cmap_t *map, const void *key) {
+	if (map->option.bloom_filter && !cmap_bloom_contains(map, key))
+		return NULL;
+	if (map->option.hash_index) {
+		cmap_node_t *node = cmap_index_find(map, key);
+		return node == NIL ? NULL : node->val;
+	}
 	cmap_node_t **cursor = &map->root;
+	uint64_t key_prefix = cmap_key_prefix(map, key);
 	while (*cursor != NIL) {
-		int cmp = (*cursor)->cmp((*cursor), key);
+		int cmp = cmap_node_cmp_prefix(map, (*cursor), key, key_prefix);
 		if (cmp == 0)
-			return (*cursor)->val.data;
+			return (*cursor)->val;
 		else if (cmp < 0)
 			cursor = &(*cursor)->right;
 		else
@@ -430,22 +1391,107 @@ void *cmap_search(cmap_t *map, const void *key) {
  * @key:	the target key, whcih may be wanted to be inserted.
  * @value:	the target value wanted to inserted or updated.
  * 
- * This function searchs the given key by binary search.
- * If the key is found, it will update the corresponding value.
- * else, it will allocate a new node containing the key and value
- * and insert it into the cmap object.
- * If it conducts insertion, it will calls cmap_insert_fixup() to
- * do the fixup process.
+ * This function finds the key or links a new node by cmap_locate(), and the
+ * value of an existed key is updated.
  */
 void cmap_insert(cmap_t *map, const void *key, const void *val) {
-	cmap_node_t *prev_node = NIL;
-	cmap_node_t **cursor = &map->root;
+	bool found;
+	cmap_node_t *node = cmap_locate(map, key, val, false, &found);
+	if (found) {
+		cmap_node_insert_val(map, node, val);
+		cmap_node_update_path(map, node, 0);
+	}
+#if DEBUG == 1
+	cmap_validate(map);
+#endif
+}
+
+/**
+ * cmap_locate - finding the node of a key, or linking a new node with the key.
+ * @map:	the target cmap object.
+ * @key:	the target key.
+ * @val:	the value of the new node if @key is missing.
+ * @move:	whether @key and @val are adopted by the new node rather than copied.
+ * @found:	set to whether @key was in @map, where @key and @val are not used.
+ *
+ * It searches the key from the root by cmap_node_locate().
+ * If the key is larger than the key of the rightmost node, which is cached in
+ * the cmap object, it is appended after the rightmost node by one comparsion,
+ * so inserting increasing keys (timestamps, sequence numbers, ...) does not
+ * walk down the tree. With the hash_index option, an existed key is found by
+ * cmap_index_find() first, so updating it does not walk down the tree either.
+ * It returns the node holding @key.
+ */
+static cmap_node_t *cmap_locate(cmap_t *map, const void *key, const void *val, bool move,
+				bool *found) {
+	if (map->option.hash_index) {
+		cmap_node_t *node = cmap_index_find(map, key);
+		if (node != NIL) {
+			*found = true;
+			return node;
+		}
+	}
+	if (map->rightmost != NIL && cmap_node_cmp(map, map->rightmost, key) < 0) {
+		*found = false;
+		return cmap_node_append(map, key, val, move);
+	}
+	return cmap_node_locate(map, map->root, key, val, move, found);
+}
+
+/**
+ * cmap_node_insert - inserting the given key and value into a subtree of a cmap object,
+ *		      or updating the value for the existed key in the subtree.
+ * @map:	the target map wanted to inserted the data.
+ * @node:	the root of the subtree, whose range of keys must include @key.
+ *		(It is the root of @map or NIL for an empty cmap object.)
+ * @key:	the target key, whcih may be wanted to be inserted.
+ * @val:	the target value wanted to inserted or updated.
+ *
+ * It finds the key or links a new node by cmap_node_locate(), and the value of
+ * an existed key is updated.
+ * It returns the node holding @key.
+ */
+static cmap_node_t *cmap_node_insert(cmap_t *map, cmap_node_t *node, const void *key,
+				     const void *val) {
+	bool found;
+	node = cmap_node_locate(map, node, key, val, false, &found);
+	if (found) {
+		cmap_node_insert_val(map, node, val);
+		cmap_node_update_path(map, node, 0);
+	}
+	return node;
+}
+
+/**
+ * cmap_node_locate - finding the node of a key in a subtree, or linking a new node with the key.
+ * @map:	the target cmap object.
+ * @node:	the root of the subtree, whose range of keys must include @key.
+ *		(It is the root of @map or NIL for an empty cmap object.)
+ * @key:	the target key.
+ * @val:	the value of the new node if @key is missing.
+ * @move:	whether @key and @val are adopted by the new node rather than copied.
+ * @found:	set to whether @key was in @map, where @key and @val are not used.
+ *
+ * This function searchs the given key by binary search from @node.
+ * If the key is not found, it will allocate a new node containing the key
+ * and value and insert it into the cmap object, then calling cmap_insert_fixup()
+ * to do the fixup process.
+ * It returns the node holding @key, which is still in the tree after the fixup.
+ */
+static cmap_node_t *cmap_node_locate(cmap_t *map, cmap_node_t *node, const void *key,
+				     const void *val, bool move, bool *found) {
+	cmap_node_t *prev_node = node == NIL ? NIL : cmap_node_parent(node);
+	cmap_node_t **cursor = prev_node == NIL	     ? &map->root
+			       : prev_node->left == node ? &prev_node->left
+							 : &prev_node->right;
+	*found = false;
+	uint64_t key_prefix = cmap_key_prefix(map, key);
 	while (*cursor != NIL) {
 		prev_node = *cursor;
-		int cmp = (*cursor)->cmp((*cursor), key);
+		int cmp = cmap_node_cmp_prefix(map, (*cursor), key, key_prefix);
 		if (cmp == 0) {
-			(*cursor)->insert_val((*cursor), val);
-			goto INSERT_END;
+			*found = true;
+			return *cursor;
 		}
 		else if (cmp < 0)
 			cursor = &(*cursor)->right;
@@ -453,16 +1499,287 @@ void cmap_insert(cmap_t *map, const void *key, const void *val) {
 			cursor = &(*cursor)->left;
 	}
 
-	// Allocating a new node.
-	cmap_node_t *new_node = cmap_node_alloc(map, key, val);
-	*cursor = new_node;
-	new_node->parent = prev_node;
+	return cmap_node_link(map, prev_node, cursor, key, val, move);
+}
+
+/**
+ * cmap_node_link - linking a new node at a missing child of a node.
+ * @map:	the target cmap object.
+ * @parent:	the parent of the new node. (NIL for an empty cmap object.)
+ * @link:	the missing child of @parent (or the root) where the new node is linked,
+ *		which must be the place of the key in the order of keys.
+ * @key:	the key of the new node.
+ * @val:	the value of the new node.
+ * @move:	whether @key and @val are adopted by the new node rather than copied.
+ *
+ * It allocates the new node, keeps the rightmost node, the subtree sizes and the
+ * summaries, and calls cmap_insert_fixup(). It is the end of every descent of an
+ * insertion, including the type-specialized ones of cmap_define.h, so the tree
+ * is validated here (DEBUG) for all of them. It returns the new node.
+ */
+cmap_node_t *cmap_node_link(cmap_t *map, cmap_node_t *parent, cmap_node_t **link,
+			    const void *key, const void *val, bool move) {
+	cmap_node_t *new_node = cmap_node_alloc(map, key, val, move);
+	if (map->rightmost == NIL || link == &map->rightmost->right)
+		map->rightmost = new_node;
+	cmap_node_set_parent(new_node, parent);
+	CMAP_LINK(*link, new_node);
+	cmap_node_update_path(map, parent, 1);
 	cmap_insert_fixup(map, new_node);
-INSERT_END:
 #if DEBUG == 1
 	cmap_validate(map);
 #endif
-	return;
+	return new_node;
+}
+
+/**
+ * cmap_node_replace - replacing a node by a new node with the same key and a new value.
+ * @map:	the cmap object owning @node.
+ * @node:	the node of @key.
+ * @key:	the key of @node, which is copied into the new node.
+ * @val:	the new value, which is copied into the new node.
+ *
+ * The new node takes the place, color and subtree size of @node and is linked by a
+ * single store after it is built, then the summaries on its path are computed again.
+ * @node is retired rather than updated in place, so a reader of cmap_optimistic still
+ * copying the old value is not disturbed. It returns the new node.
+ */
+cmap_node_t *cmap_node_replace(cmap_t *map, cmap_node_t *node, const void *key,
+			       const void *val) {
+	cmap_node_t *new_node = cmap_node_alloc(map, key, val, false);
+	cmap_node_t *parent = cmap_node_parent(node);
+	cmap_node_t **cursor = parent == NIL	      ? &map->root
+			       : parent->left == node ? &parent->left
+						      : &parent->right;
+	new_node->parent_color = node->parent_color;
+	new_node->left = node->left;
+	new_node->right = node->right;
+	cmap_node_set_subtree_size(map, new_node, cmap_node_subtree_size(map, node));
+	CMAP_LINK(*cursor, new_node);
+	if (node->left != NIL)
+		cmap_node_set_parent(node->left, new_node);
+	if (node->right != NIL)
+		cmap_node_set_parent(node->right, new_node);
+	if (map->rightmost == node)
+		map->rightmost = new_node;
+	cmap_node_retire(map, node);
+	cmap_node_update_path(map, new_node, 0);
+	return new_node;
+}
+
+/**
+ * cmap_get_or_insert - the value of a key, which is inserted with a default value if it is missing.
+ * @map:		the target cmap object.
+ * @key:		the target key.
+ * @default_val:	the value inserted with @key if @key is missing.
+ *
+ * Both cases take one descent (or one comparsion for a key larger than all keys).
+ * It returns the pointer to the value of @key in @map, which can be changed in
+ * place until the key is erased, since erasing other keys never moves the data of
+ * a node (see cmap_node_erase()).
+ * The summaries of augmentation are not fixed after such a change.
+ */
+static void *cmap_get_or_insert(cmap_t *map, const void *key, const void *default_val) {
+	bool found;
+	cmap_node_t *node = cmap_locate(map, key, default_val, false, &found);
+#if DEBUG == 1
+	cmap_validate(map);
+#endif
+	return node->val;
+}
+
+/**
+ * cmap_upsert - merging a delta into the value of a key in place, or inserting the delta.
+ * @map:	the target cmap object.
+ * @key:	the target key.
+ * @delta:	the object merged into the value of @key, or the value of @key if it is missing.
+ * @merge:	the callback merging @delta into the value, like adding it to a counter.
+ *
+ * The value is neither released nor copied, so updating a counter takes one descent
+ * without any memory allocation. The summaries of augmentation are fixed after @merge.
+ * It returns the pointer to the value of @key like cmap_get_or_insert().
+ */
+static void *cmap_upsert(cmap_t *map, const void *key, const void *delta, cmap_merge_t merge) {
+	bool found;
+	cmap_node_t *node = cmap_locate(map, key, delta, false, &found);
+	if (found) {
+		merge(node->val, delta);
+		cmap_node_update_path(map, node, 0);
+	}
+#if DEBUG == 1
+	cmap_validate(map);
+#endif
+	return node->val;
+}
+
+/**
+ * cmap_insert_move - inserting allocated key and value adopted without copying.
+ * @map:	the target cmap object.
+ * @key:	the key allocated by the dealloc() compatible allocator of the key interface.
+ * @val:	the value allocated by the dealloc() compatible allocator of the val interface.
+ *
+ * The new node keeps @key and @val as they are, instead of copying them by copy().
+ * If the key exists, its old value is released and @val is adopted, while @key is
+ * released because the node keeps its own key. Either way, @map owns both objects
+ * after this call.
+ */
+static void cmap_insert_move(cmap_t *map, void *key, void *val) {
+	bool found;
+	cmap_node_t *node = cmap_locate(map, key, val, true, &found);
+	if (found) {
+		cmap_data_release(&map->key_interface, key, NULL);
+		cmap_data_release(&map->val_interface, node->val,
+				  cmap_node_inline_val(map, node));
+		node->val = val;
+		cmap_node_update_path(map, node, 0);
+	}
+#if DEBUG == 1
+	cmap_validate(map);
+#endif
+}
+
+/**
+ * cmap_node_append - inserting a key larger than all keys of a cmap object.
+ * @map:	the target cmap object.
+ * @key:	the target key, which is larger than the key of the rightmost node.
+ * @val:	the target value.
+ * @move:	whether @key and @val are adopted by the new node rather than copied.
+ *
+ * The rightmost node has no right child, so the new node becomes its right
+ * child (or the root of an empty cmap object) without any comparsion, and
+ * it is the new rightmost node.
+ */
+static cmap_node_t *cmap_node_append(cmap_t *map, const void *key, const void *val,
+				     bool move) {
+	cmap_node_t *rightmost = map->rightmost;
+	return cmap_node_link(map, rightmost, rightmost == NIL ? &map->root : &rightmost->right,
+			      key, val, move);
+}
+
+/**
+ * cmap_insert_hint - inserting the given key and value at a position given by user.
+ * @map:	the target cmap object.
+ * @hint:	the iterator at the position just after @key, like the hint of <map> in C++.
+ * @key:	the target key.
+ * @val:	the target value.
+ *
+ * If @key is between the key before @hint and the key of @hint, the new node is linked
+ * next to them without searching: as the left child of @hint if it has no left child,
+ * otherwise as the right child of the previous node, which never has a right child then.
+ * For the end iterator, @key is appended after the rightmost node. If @hint holds @key,
+ * its value is updated. Otherwise the hint is wrong and the key is inserted from the root.
+ * It returns the iterator at @key.
+ */
+static cmap_iter_t cmap_insert_hint(cmap_t *map, cmap_iter_t hint, const void *key,
+				    const void *val) {
+	cmap_node_t *node = hint.node, *prev = map->rightmost;
+	bool wrong_hint = false;
+	if (node != NIL) {
+		int cmp = cmap_node_cmp(map, node, key);
+		if (cmp == 0) {
+			cmap_node_insert_val(map, node, val);
+			cmap_node_update_path(map, node, 0);
+			return cmap_iter(node);
+		}
+		wrong_hint = cmp < 0;
+		prev = cmap_node_prev(node);
+	}
+
+	if (wrong_hint || (prev != NIL && cmap_node_cmp(map, prev, key) >= 0))
+		node = cmap_node_insert(map, map->root, key, val);
+	else if (node == NIL)
+		node = cmap_node_append(map, key, val, false);
+	else if (node->left == NIL)
+		node = cmap_node_link(map, node, &node->left, key, val, false);
+	else
+		node = cmap_node_link(map, prev, &prev->right, key, val, false);
+#if DEBUG == 1
+	cmap_validate(map);
+#endif
+	return cmap_iter(node);
+}
+
+/**
+ * cmap_insert_batch - inserting unsorted keys and values into a cmap object in ascending order.
+ * @map:	the target cmap object.
+ * @keys:	the keys in any order.
+ * @vals:	the values of @keys.
+ * @n:		the number of keys and values.
+ *
+ * The batch is sorted by cmap_sort() first. Then every key is not less than the
+ * previous one, so its descent starts from the node of the previous key (the
+ * finger) rather than the root: it climbs from the finger until the subtree
+ * covers the key, which is usually a few levels for a dense batch, then
+ * descends from there.
+ * The sort is stable, so the last value of a duplicated key in the batch is kept,
+ * which is the same as inserting the batch key by key.
+ */
+static void cmap_insert_batch(cmap_t *map, const void *const *keys,
+			      const void *const *vals, size_t n) {
+	size_t *order = malloc(sizeof(size_t) * (n + 1));
+	cmap_sort(keys, order, n, map->key_interface.cmp);
+
+	cmap_node_t *finger = map->root;
+	for (size_t i = 0; i < n; i++) {
+		const void *key = keys[order[i]];
+		cmap_node_t *node = finger;
+		if (i > 0) {
+			/*
+			 * The keys of the subtree of @node are less than the parent of
+			 * the first ancestor which is a left child.
+			 */
+			cmap_node_t *parent;
+			uint64_t key_prefix = cmap_key_prefix(map, key);
+			while ((parent = cmap_node_parent(node)) != NIL &&
+			       (node == parent->right ||
+				cmap_node_cmp_prefix(map, parent, key, key_prefix) <= 0))
+				node = parent;
+		}
+		finger = cmap_node_insert(map, node, key, vals[order[i]]);
+	}
+	free(order);
+#if DEBUG == 1
+	cmap_validate(map);
+#endif
+}
+
+/**
+ * cmap_sort - sorting the indices of keys by merge sort.
+ * @keys:	the array of pointers to keys.
+ * @order:	the array receiving the indices of @keys in ascending order of keys.
+ * @n:		the number of keys.
+ * @cmp:	the comparsion of keys.
+ *
+ * qsort() cannot pass the comparsion of the keys to its callback, so this is
+ * a bottom-up merge sort on the indices of keys. It is stable: the indices of
+ * equal keys stay in their original order.
+ */
+void cmap_sort(const void *const *keys, size_t *order, size_t n,
+	       int (*cmp)(const void *, const void *)) {
+	size_t *buf = malloc(sizeof(size_t) * (n + 1));
+	size_t *src = order, *dst = buf;
+	for (size_t i = 0; i < n; i++)
+		order[i] = i;
+	for (size_t width = 1; width < n; width *= 2) {
+		for (size_t low = 0; low < n; low += 2 * width) {
+			size_t mid = low + width < n ? low + width : n;
+			size_t high = mid + width < n ? mid + width : n;
+			size_t i = low, j = mid, k = low;
+			while (i < mid && j < high)
+				dst[k++] = cmp(keys[src[j]], keys[src[i]]) < 0 ? src[j++]
+									       : src[i++];
+			while (i < mid)
+				dst[k++] = src[i++];
+			while (j < high)
+				dst[k++] = src[j++];
+		}
+		size_t *tmp = src;
+		src = dst;
+		dst = tmp;
+	}
+	if (src != order)
+		memcpy(order, src, sizeof(size_t) * n);
+	free(buf);
 }
 
 /**
@@ -477,11 +1794,14 @@ INSERT_END:
  * It has three situations needed to be fixed and they have 
  * correspoding strategies to be repaired.
  * They are showed in the documentation of this repository.
+ *
+ * It returns whether the black height of the tree has grown, which happens
+ * when the recoloring reaches the root and the root is painted black again.
  */
-static void cmap_insert_fixup(cmap_t *map, cmap_node_t *node) {
-	while (node->parent->black == false) {
-		cmap_node_t *parent = node->parent;
-		cmap_node_t *grandparent = parent->parent;
+static bool cmap_insert_fixup(cmap_t *map, cmap_node_t *node) {
+	while (!cmap_node_black(cmap_node_parent(node))) {
+		cmap_node_t *parent = cmap_node_parent(node);
+		cmap_node_t *grandparent = cmap_node_parent(parent);
 		cmap_node_t *uncle = NIL;
 
 		if (parent == grandparent->left) {
@@ -491,21 +1811,21 @@ static void cmap_insert_fixup(cmap_t *map, cmap_node_t *node) {
 			uncle = grandparent->left;
 		}
 
-		if (uncle->black == false) {
-			parent->black = true;
-			uncle->black = true;
-			grandparent->black = false;
+		if (!cmap_node_black(uncle)) {
+			cmap_node_set_black(parent, true);
+			cmap_node_set_black(uncle, true);
+			cmap_node_set_black(grandparent, false);
 			node = grandparent;
 		}
 		else if (parent == grandparent->left) {
 			if (node == parent->right) {
 				node = parent;
 				cmap_left_rotation(map, node);
-				parent = node->parent;
-				grandparent = parent->parent;
+				parent = cmap_node_parent(node);
+				grandparent = cmap_node_parent(parent);
 			}
-			parent->black = true;
-			grandparent->black = false;
+			cmap_node_set_black(parent, true);
+			cmap_node_set_black(grandparent, false);
 			cmap_right_rotation(map, grandparent);
 		}
 
@@ -513,15 +1833,17 @@ static void cmap_insert_fixup(cmap_t *map, cmap_node_t *node) {
 			if (node == parent->left) {
 				node = parent;
 				cmap_right_rotation(map, node);
-				parent = node->parent;
-				grandparent = parent->parent;
+				parent = cmap_node_parent(node);
+				grandparent = cmap_node_parent(parent);
 			}
-			parent->black = true;
-			grandparent->black = false;
+			cmap_node_set_black(parent, true);
+			cmap_node_set_black(grandparent, false);
 			cmap_left_rotation(map, grandparent);
 		}
 	}
-	map->root->black = true;
+	bool grown = !cmap_node_black(map->root);
+	cmap_node_set_black(map->root, true);
+	return grown;
 }
 
 /**
@@ -532,62 +1854,179 @@ static void cmap_insert_fixup(cmap_t *map, cmap_node_t *node) {
  * It searchs the given key in a cmap object and removes the node with
  * the key if it is existed. Otherwise, it does nothing.
  *
- * If the erasion is certain to be conducted, it will find the successor
- * for the node and changes their data (key and value), then erasing
- * the successor with the specific key after changing rather than the
- * original node with the key.
- * It will calls cmap_erase_fixup() to do fixup process for the erasion
- * if it occurs.
+ * If the erasion is certain to be conducted, the node is erased by
+ * cmap_node_erase(). With the hash_index option, the node is found by
+ * cmap_index_find() instead of the descent, and with the bloom_filter option,
+ * a key missed by the filter returns at once. The filter may be rebuilt after
+ * the erasion (see cmap_bloom_maintain()).
  */
 bool cmap_erase(cmap_t *map, const void *key) {
-	cmap_node_t **cursor = &map->root;
-	while (*cursor != NIL) {
-		int cmp = (*cursor)->cmp((*cursor), key);
-		if (cmp == 0) {
-			bool erase_black = false;
-			cmap_node_t *successor =
-				cmap_node_successor(map, (*cursor));
-			cmap_node_t *erase_node = NIL;
-			if (successor != NIL) {
-				void *tmp = (*cursor)->key.data;
-				(*cursor)->key.data = successor->key.data;
-				successor->key.data = tmp;
-				tmp = (*cursor)->val.data;
-				(*cursor)->val.data = successor->val.data;
-				successor->val.data = tmp;
-				cursor = successor->parent->left == successor
-						 ? &successor->parent->left
-						 : &successor->parent->right;
-			}
-			erase_node = (*cursor);
-			erase_black = erase_node->black;
-			(*cursor) = erase_node->left != NIL ? erase_node->left
-							    : erase_node->right;
-			(*cursor)->parent = erase_node->parent;
-			erase_node->left = erase_node->right = NIL;
-			erase_node->destroy(erase_node);
-			if (erase_black) {
-				cmap_erase_fixup(map, *cursor);
-			}
-			nil_node.black = true;
-			nil_node.parent = NIL;
+	cmap_node_t *node = map->root;
+	if (map->option.bloom_filter && !cmap_bloom_contains(map, key))
+		return false;
+	if (map->option.hash_index)
+		node = cmap_index_find(map, key);
+	uint64_t key_prefix = cmap_key_prefix(map, key);
+	while (node != NIL) {
+		int cmp = cmap_node_cmp_prefix(map, node, key, key_prefix);
+		if (cmp == 0)
+			break;
+		else if (cmp < 0)
+			node = node->right;
+		else
+			node = node->left;
+	}
+	if (node == NIL)
+		return false;
+	cmap_node_erase(map, node);
+	if (map->option.bloom_filter)
+		cmap_bloom_maintain(map, 0);
 #if DEBUG == 1
-			cmap_validate(map);
+	cmap_validate(map);
+#endif
+	return true;
+}
+
+/**
+ * cmap_extract - erasing a key and handing its key and value over to user.
+ * @map:	the target cmap object.
+ * @key:	the target key.
+ * @key_out:	receiving the key of the node, or NULL if the key should be released.
+ * @val_out:	receiving the value of the node, or NULL if the value should be released.
+ *
+ * The objects taken out by cmap_data_detach() are neither destroyed nor deallocated,
+ * so user owns them and releases them by the destroy() and dealloc() of the interfaces.
+ * (An object stored inline is moved into a buffer allocated by malloc().)
+ * It returns false if the key does not exist.
+ */
+static bool cmap_extract(cmap_t *map, const void *key, void **key_out, void **val_out) {
+	cmap_node_t *node = map->root;
+	uint64_t key_prefix = cmap_key_prefix(map, key);
+	while (node != NIL) {
+		int cmp = cmap_node_cmp_prefix(map, node, key, key_prefix);
+		if (cmp == 0)
+			break;
+		node = cmp < 0 ? node->right : node->left;
+	}
+	if (node == NIL)
+		return false;
+
+	if (key_out != NULL) {
+		// The key is needed to find its slot, so it leaves the index before the node.
+		if (map->option.hash_index)
+			cmap_index_remove(map, node);
+		*key_out = cmap_data_detach(&map->key_interface, node->key,
+					    cmap_node_inline_key(map, node));
+		node->key = NULL;
+	}
+	if (val_out != NULL) {
+		*val_out = cmap_data_detach(&map->val_interface, node->val,
+					    cmap_node_inline_val(map, node));
+		node->val = NULL;
+	}
+	cmap_node_erase(map, node);
+	if (map->option.bloom_filter)
+		cmap_bloom_maintain(map, 0);
+#if DEBUG == 1
+	cmap_validate(map);
 #endif
-			return true;
+	return true;
+}
+
+/**
+ * cmap_node_erase - erasing a given node from a cmap object.
+ * @map:	the cmap object owning the node.
+ * @node:	the node wanted to be erased.
+ *
+ * A node with at most one child is replaced by the child. Otherwise, its successor
+ * (the smallest key of its right subtree) is unlinked from its place and relinked
+ * into the place of the node, taking its color and subtree size. The data of the
+ * nodes are never moved, so the pointers to the keys and values of other nodes (and
+ * the iterators at them) stay valid.
+ * The removed black node is fixed by cmap_erase_fixup() from the place the removed
+ * (or moved) node leaves, where the subtree sizes and summaries are fixed first.
+ * It is also the erasure of the type-specialized cmaps of cmap_define.h, so the tree
+ * is validated here (DEBUG) for them.
+ */
+void cmap_node_erase(cmap_t *map, cmap_node_t *node) {
+	if (node == map->rightmost)
+		map->rightmost = cmap_node_prev(node);
+	cmap_node_t *erase_parent = cmap_node_parent(node);
+	cmap_node_t **cursor = erase_parent == NIL	  ? &map->root
+			       : erase_parent->left == node ? &erase_parent->left
+							    : &erase_parent->right;
+	cmap_node_t *child, *fix_parent;
+	bool erase_black;
+	if (node->left == NIL || node->right == NIL) {
+		child = node->left != NIL ? node->left : node->right;
+		erase_black = cmap_node_black(node);
+		fix_parent = erase_parent;
+		CMAP_LINK(*cursor, child);
+		if (child != NIL)
+			cmap_node_set_parent(child, erase_parent);
+	}
+	else {
+		cmap_node_t *successor = cmap_node_first(node->right);
+		child = successor->right;
+		erase_black = cmap_node_black(successor);
+		fix_parent = cmap_node_parent(successor);
+		if (fix_parent == node) {
+			fix_parent = successor;
 		}
-		else if (cmp < 0)
-			cursor = &(*cursor)->right;
-		else
-			cursor = &(*cursor)->left;
+		else {
+			CMAP_LINK(fix_parent->left, child);
+			if (child != NIL)
+				cmap_node_set_parent(child, fix_parent);
+			CMAP_LINK(successor->right, node->right);
+			cmap_node_set_parent(successor->right, successor);
+		}
+		CMAP_LINK(successor->left, node->left);
+		cmap_node_set_parent(successor->left, successor);
+		successor->parent_color = node->parent_color;
+		cmap_node_set_subtree_size(map, successor, cmap_node_subtree_size(map, node));
+		CMAP_LINK(*cursor, successor);
+	}
+	CMAP_LINK(node->left, NIL);
+	CMAP_LINK(node->right, NIL);
+	cmap_node_retire(map, node);
+	cmap_node_update_path(map, fix_parent, (size_t)-1);
+	if (erase_black) {
+		cmap_erase_fixup(map, child, fix_parent);
 	}
-	return false;
+#if DEBUG == 1
+	cmap_validate(map);
+#endif
+}
+
+/**
+ * cmap_node_retire - handing a node unlinked from a cmap object to the retire hook or the pool.
+ * @map:	the cmap object owning the node.
+ * @node:	the unlinked node.
+ *
+ * The node leaves the hash index of the hash_index option here, unless its key
+ * has been taken by cmap_extract(), which removes the node from the index first.
+ * Its key stays in the Bloom filter, which only counts it as erased.
+ */
+static inline void cmap_node_retire(cmap_t *map, cmap_node_t *node) {
+	if (map->option.hash_index && node->key != NULL)
+		cmap_index_remove(map, node);
+	if (map->option.bloom_filter)
+		map->bloom.erased++;
+	map->count--;
+	if (map->retire)
+		map->retire(map, node);
+	else
+		cmap_node_release(map, node);
 }
 
 /**
  * cmap_erase_fixup - Fixup the imbalance after erasing a node into a cmap object.
  * @map:	the cmap object being imbalance after erasing.
  * @node:	the target node being fixup.
+ * @parent:	the parent of @node.
+ *
+ * Because NIL is a NULL pointer without any field, @node may be NIL and its
+ * parent is passed separately and tracked during the fixup process.
  * 
  * After erasion, a cmap object may be imbalance because of breaking
  * the rules of Red-Black Tree. Therefore, it must conduct the fixup process
@@ -597,16 +2036,15 @@ bool cmap_erase(cmap_t *map, const void *key) {
  * correspoding strategies to be repaired.
  * They are showed in the documentation of this repository.
  */
-static void cmap_erase_fixup(cmap_t *map, cmap_node_t *node) {
+static void cmap_erase_fixup(cmap_t *map, cmap_node_t *node, cmap_node_t *parent) {
 
-	while (node != map->root && node->black) {
-		cmap_node_t *parent = node->parent;
+	while (node != map->root && cmap_node_black(node)) {
 		bool node_is_left = (node == parent->left);
 		cmap_node_t *sibling =
 			node_is_left ? parent->right : parent->left;
-		if (sibling->black == false) {
-			sibling->black = true;
-			node->parent->black = false;
+		if (!cmap_node_black(sibling)) {
+			cmap_node_set_black(sibling, true);
+			cmap_node_set_black(parent, false);
 			if (node_is_left) {
 				cmap_left_rotation(map, parent);
 				sibling = parent->right;
@@ -616,56 +2054,935 @@ static void cmap_erase_fixup(cmap_t *map, cmap_node_t *node) {
 				sibling = parent->left;
 			}
 		}
-		if (sibling->left->black && sibling->right->black) {
-			sibling->black = false;
+		if (cmap_node_black(sibling->left) &&
+		    cmap_node_black(sibling->right)) {
+			cmap_node_set_black(sibling, false);
 			node = parent;
+			parent = cmap_node_parent(node);
 		}
 		else if (node_is_left) {
-			if (sibling->right->black) {
-				sibling->black = false;
-				sibling->left->black = true;
+			if (cmap_node_black(sibling->right)) {
+				cmap_node_set_black(sibling, false);
+				cmap_node_set_black(sibling->left, true);
 				cmap_right_rotation(map, sibling);
 				sibling = parent->right;
 			}
-			sibling->black = parent->black;
-			parent->black = true;
-			sibling->right->black = true;
+			cmap_node_set_black(sibling, cmap_node_black(parent));
+			cmap_node_set_black(parent, true);
+			cmap_node_set_black(sibling->right, true);
 			cmap_left_rotation(map, parent);
 			node = map->root;
 		}
 		else {
-			if (sibling->left->black) {
-				sibling->black = false;
-				sibling->right->black = true;
+			if (cmap_node_black(sibling->left)) {
+				cmap_node_set_black(sibling, false);
+				cmap_node_set_black(sibling->right, true);
 				cmap_left_rotation(map, sibling);
 				sibling = parent->left;
 			}
-			sibling->black = parent->black;
-			parent->black = true;
-			sibling->left->black = true;
+			cmap_node_set_black(sibling, cmap_node_black(parent));
+			cmap_node_set_black(parent, true);
+			cmap_node_set_black(sibling->left, true);
 			cmap_right_rotation(map, parent);
 			node = map->root;
 		}
 	}
-	node->black = true;
+	if (node != NIL)
+		cmap_node_set_black(node, true);
 }
 
 /**
- * cmap_node_successor - finding the successor for a cmap node instance in a cmap object.
- * @map:	a cmap instance.
- * @node:	a node, in the cmap instance @map, 
- *		wanted to be found the successor.
- * 
- * For cmap_erase() behavior, it must find the successor for the target 
- * node wanted to be erased and change the data (key and value) between
- * the successor and target node, then erasing the successor.
- * So, this function returns the successor for the given node in a cmap object.
+ * cmap_erase_range - erasing all keys in a range from a cmap object.
+ * @map:	the target cmap object.
+ * @low:	the smallest key of the range.
+ * @high:	the key after the range, which is not erased.
+ *
+ * The keys in [@low, @high) are erased, and the number of the erased keys is
+ * returned. Instead of erasing the keys one by one, the tree is split into
+ * the keys less than @low, the keys in the range and the keys not less than
+ * @high. The middle tree is released node by node without any rebalancing,
+ * and the other two trees are joined again. Splitting and joining take
+ * O(log n), so erasing k keys takes O(k + log n).
+ * Joining two trees needs a node between them, so the root of the middle tree
+ * is borrowed for the join and erased from the joined tree afterwards.
+ *
+ * Splitting and joining cost more than a few erasions, so a range with less
+ * than CMAP_RANGE_SPLIT keys is erased key by key.
+ */
+static size_t cmap_erase_range(cmap_t *map, const void *low, const void *high) {
+	size_t count = 0;
+	uint64_t high_prefix = cmap_key_prefix(map, high);
+	for (cmap_node_t *node = cmap_lower_bound(map, low).node;
+	     node != NIL && count < CMAP_RANGE_SPLIT &&
+	     cmap_node_cmp_prefix(map, node, high, high_prefix) < 0;
+	     node = cmap_node_next(node))
+		count++;
+	if (count < CMAP_RANGE_SPLIT) {
+		for (size_t i = 0; i < count; i++)
+			cmap_node_erase(map, cmap_lower_bound(map, low).node);
+		if (map->option.bloom_filter)
+			cmap_bloom_maintain(map, 0);
+#if DEBUG == 1
+		cmap_validate(map);
+#endif
+		return count;
+	}
+
+	size_t left_height, middle_height, right_height;
+	cmap_node_t *root = map->root, *middle, *right;
+	size_t height = cmap_black_height(map);
+	map->root = NIL;
+	cmap_node_t *left = cmap_node_split(map, root, height, low, &left_height,
+					    &middle, &middle_height);
+	middle = cmap_node_split(map, middle, middle_height, high, &middle_height,
+				 &right, &right_height);
+
+	count = cmap_node_retire_tree(map, middle->left) +
+		cmap_node_retire_tree(map, middle->right) + 1;
+	middle->left = middle->right = NIL;
+	map->root = cmap_node_join(map, left, left_height, middle, right,
+				   right_height, &height);
+	map->rightmost = cmap_node_last(map->root);
+	cmap_node_erase(map, middle);
+	if (map->option.bloom_filter)
+		cmap_bloom_maintain(map, 0);
+#if DEBUG == 1
+	cmap_validate(map);
+#endif
+	return count;
+}
+
+/**
+ * cmap_count_range - counting the keys in a range of a cmap object.
+ * @map:	the target cmap object.
+ * @low:	the smallest key of the range.
+ * @high:	the key after the range.
+ *
+ * It finds @low once and walks the keys in [@low, @high) by cmap_node_next().
+ * In the order statistics mode, it is the difference of two ranks instead, which
+ * takes O(log n).
+ */
+static size_t cmap_count_range(cmap_t *map, const void *low, const void *high) {
+	if (map->option.order_statistics) {
+		size_t low_rank = cmap_rank(map, low), high_rank = cmap_rank(map, high);
+		return high_rank > low_rank ? high_rank - low_rank : 0;
+	}
+	size_t count = 0;
+	uint64_t high_prefix = cmap_key_prefix(map, high);
+	for (cmap_node_t *node = cmap_lower_bound(map, low).node;
+	     node != NIL && cmap_node_cmp_prefix(map, node, high, high_prefix) < 0;
+	     node = cmap_node_next(node))
+		count++;
+	return count;
+}
+
+/**
+ * cmap_black_height - the black height of a cmap object.
+ * @map:	the target cmap object.
+ *
+ * Every path from the root to NIL has the same number of black nodes, so
+ * the leftmost path is counted.
+ */
+static size_t cmap_black_height(cmap_t *map) {
+	size_t height = 0;
+	for (cmap_node_t *node = map->root; node != NIL; node = node->left)
+		height += cmap_node_black(node);
+	return height;
+}
+
+/**
+ * cmap_node_join - joining two trees and a node between them into a tree.
+ * @map:		the cmap object owning the nodes. Its root is used during the join.
+ * @left:		a detached tree whose keys are less than the key of @node.
+ * @left_height:	the black height of @left, where a red root is not counted.
+ * @node:		a detached node.
+ * @right:		a detached tree whose keys are larger than the key of @node.
+ * @right_height:	the black height of @right, where a red root is not counted.
+ * @height:		the black height of the joined tree.
+ *
+ * The roots of the two trees are painted black first. If the trees have the same
+ * black height, @node becomes the root above them. Otherwise, @node is linked
+ * as a red node to the spine of the higher tree, next to the black node with the
+ * same black height as the lower tree, and the red-red violation is repaired by
+ * cmap_insert_fixup(). It takes O(|@left_height - @right_height| + 1).
+ */
+static cmap_node_t *cmap_node_join(cmap_t *map, cmap_node_t *left, size_t left_height,
+				   cmap_node_t *node, cmap_node_t *right,
+				   size_t right_height, size_t *height) {
+	if (!cmap_node_black(left)) {
+		cmap_node_set_black(left, true);
+		left_height++;
+	}
+	if (!cmap_node_black(right)) {
+		cmap_node_set_black(right, true);
+		right_height++;
+	}
+
+	if (left_height == right_height) {
+		node->left = left;
+		node->right = right;
+		node->parent_color = CMAP_BLACK;
+		cmap_node_set_subtree_size(map, node,
+					   cmap_node_subtree_size(map, left) +
+						   cmap_node_subtree_size(map, right) + 1);
+		cmap_node_update_summary(map, node);
+		if (left != NIL)
+			cmap_node_set_parent(left, node);
+		if (right != NIL)
+			cmap_node_set_parent(right, node);
+		*height = left_height + 1;
+		return node;
+	}
+
+	bool left_higher = left_height > right_height;
+	cmap_node_t *parent = NIL, *cursor = left_higher ? left : right;
+	size_t cursor_height = left_higher ? left_height : right_height;
+	size_t lower_height = left_higher ? right_height : left_height;
+	map->root = cursor;
+	while (!cmap_node_black(cursor) || cursor_height != lower_height) {
+		cursor_height -= cmap_node_black(cursor);
+		parent = cursor;
+		cursor = left_higher ? cursor->right : cursor->left;
+	}
+
+	node->parent_color = (uintptr_t)parent;
+	if (left_higher) {
+		node->left = cursor;
+		node->right = right;
+		parent->right = node;
+	}
+	else {
+		node->left = left;
+		node->right = cursor;
+		parent->left = node;
+	}
+	if (node->left != NIL)
+		cmap_node_set_parent(node->left, node);
+	if (node->right != NIL)
+		cmap_node_set_parent(node->right, node);
+	cmap_node_set_subtree_size(map, node,
+				   cmap_node_subtree_size(map, node->left) +
+					   cmap_node_subtree_size(map, node->right) + 1);
+	cmap_node_update_summary(map, node);
+	cmap_node_update_path(map, parent,
+			       cmap_node_subtree_size(map, node) - cmap_node_subtree_size(map, cursor));
+	*height = (left_higher ? left_height : right_height) + cmap_insert_fixup(map, node);
+	node = map->root;
+	map->root = NIL;
+	return node;
+}
+
+/**
+ * cmap_node_split - splitting a tree into the keys less than a key and the others.
+ * @map:		the cmap object owning the nodes.
+ * @node:		the root of a detached tree.
+ * @height:		the black height of the tree, where a red root is not counted.
+ * @key:		the key splitting the tree.
+ * @left_height:	the black height of the returned tree.
+ * @right:		the tree of the keys not less than @key.
+ * @right_height:	the black height of @right.
+ *
+ * It returns the tree of the keys less than @key. The tree is cut along the path
+ * searching @key, and the subtrees hanging on each side of the path are joined
+ * with the nodes on the path by cmap_node_join(). The black heights of the joined
+ * trees grow along the path, so the costs of the joins sum up to O(log n).
+ */
+static cmap_node_t *cmap_node_split(cmap_t *map, cmap_node_t *node, size_t height,
+				    const void *key, size_t *left_height,
+				    cmap_node_t **right, size_t *right_height) {
+	if (node == NIL) {
+		*right = NIL;
+		*left_height = *right_height = 0;
+		return NIL;
+	}
+
+	size_t child_height = height - cmap_node_black(node);
+	cmap_node_t *left = node->left, *rest = node->right, *split;
+	size_t split_height;
+	if (left != NIL)
+		cmap_node_set_parent(left, NIL);
+	if (rest != NIL)
+		cmap_node_set_parent(rest, NIL);
+
+	if (cmap_node_cmp(map, node, key) >= 0) {
+		split = cmap_node_split(map, left, child_height, key, left_height,
+					&left, &split_height);
+		*right = cmap_node_join(map, left, split_height, node, rest,
+					child_height, right_height);
+		return split;
+	}
+	split = cmap_node_split(map, rest, child_height, key, &split_height, right,
+				right_height);
+	return cmap_node_join(map, left, child_height, node, split, split_height,
+			      left_height);
+}
+
+/**
+ * cmap_node_retire_tree - handing all nodes of a detached subtree to cmap_node_retire().
+ * @map:	the cmap object owning the nodes.
+ * @node:	the root of the subtree.
+ *
+ * It returns the number of the nodes in the subtree.
+ */
+static size_t cmap_node_retire_tree(cmap_t *map, cmap_node_t *node) {
+	if (node == NIL)
+		return 0;
+	size_t count = cmap_node_retire_tree(map, node->left) +
+		       cmap_node_retire_tree(map, node->right) + 1;
+	node->left = node->right = NIL;
+	cmap_node_retire(map, node);
+	return count;
+}
+
+/**
+ * cmap_build_sorted - building a cmap object from sorted keys and values.
+ * @map:	the target cmap object, which must be empty.
+ * @keys:	the keys in strictly ascending order.
+ * @vals:	the values of @keys.
+ * @n:		the number of keys and values.
+ *
+ * Inserting sorted keys one by one walks from the root and runs the fixup n times.
+ * Instead, the middle key becomes the root and both halves are built in the same
+ * way, so the tree is balanced and every node is visited once, which takes O(n).
+ * The memory of all nodes is reserved from the pool at once.
+ *
+ * It returns false and does nothing if @map is not empty or @keys are not in
+ * strictly ascending order (including duplicated keys).
+ */
+static bool cmap_build_sorted(cmap_t *map, const void *const *keys,
+			      const void *const *vals, size_t n) {
+	if (map->root != NIL)
+		return false;
+	for (size_t i = 1; i < n; i++) {
+		if (map->key_interface.cmp(keys[i - 1], keys[i]) >= 0)
+			return false;
+	}
+
+	size_t red_depth = 0;
+	while (((size_t)2 << red_depth) - 1 <= n)
+		red_depth++;
+	cmap_pool_reserve(&map->pool, n);
+	// The nodes are linked after their allocation, so the filter must not be rebuilt meanwhile.
+	if (map->option.bloom_filter)
+		cmap_bloom_rebuild(map, n);
+	map->root = cmap_node_build(map, keys, vals, n, 0, red_depth, NIL);
+	map->rightmost = cmap_node_last(map->root);
+#if DEBUG == 1
+	cmap_validate(map);
+#endif
+	return true;
+}
+
+/**
+ * cmap_node_build - building a balanced subtree from a part of sorted keys and values.
+ * @map:	the cmap object owning the nodes.
+ * @keys:	the sorted keys of the subtree.
+ * @vals:	the values of @keys.
+ * @n:		the number of keys of the subtree.
+ * @depth:	the depth of the root of the subtree.
+ * @red_depth:	the depth of the red nodes.
+ * @parent:	the parent of the root of the subtree.
+ *
+ * The sizes of two halves differ by at most one, so all paths from the root to
+ * NIL have either red_depth or red_depth + 1 nodes, where red_depth is
+ * floor(log2(n + 1)) of the whole tree. Only the nodes of the incomplete last
+ * level at @red_depth are red, so every path has red_depth black nodes and
+ * no red node has a red child.
+ */
+static cmap_node_t *cmap_node_build(cmap_t *map, const void *const *keys,
+				    const void *const *vals, size_t n, size_t depth,
+				    size_t red_depth, cmap_node_t *parent) {
+	if (n == 0)
+		return NIL;
+	size_t mid = n / 2;
+	cmap_node_t *node = cmap_node_alloc(map, keys[mid], vals[mid], false);
+	node->parent_color = (uintptr_t)parent | (depth == red_depth ? 0 : CMAP_BLACK);
+	node->left = cmap_node_build(map, keys, vals, mid, depth + 1, red_depth, node);
+	node->right = cmap_node_build(map, keys + mid + 1, vals + mid + 1, n - mid - 1,
+				      depth + 1, red_depth, node);
+	cmap_node_set_subtree_size(map, node, n);
+	cmap_node_update_summary(map, node);
+	return node;
+}
+
+/**
+ * cmap_node_first - finding the node with the smallest key in a subtree.
+ * @node:	the root of the subtree.
+ *
+ * It returns the leftmost node of the subtree, or NIL if the subtree is empty.
+ */
+static cmap_node_t *cmap_node_first(cmap_node_t *node) {
+	if (node == NIL)
+		return NIL;
+	while (node->left != NIL)
+		node = node->left;
+	return node;
+}
+
+/**
+ * cmap_node_next - finding the next node in ascending order of keys.
+ * @node:	a node in a cmap object.
+ *
+ * If the node has a right subtree, the next node is the leftmost node of it.
+ * Otherwise, it climbs by the parent pointers until it comes from a left child.
+ * It returns NIL if @node has the largest key.
+ */
+static cmap_node_t *cmap_node_next(cmap_node_t *node) {
+	if (node->right != NIL)
+		return cmap_node_first(node->right);
+	cmap_node_t *parent = cmap_node_parent(node);
+	while (parent != NIL && node == parent->right) {
+		node = parent;
+		parent = cmap_node_parent(node);
+	}
+	return parent;
+}
+
+/**
+ * cmap_node_last - finding the node with the largest key in a subtree.
+ * @node:	the root of the subtree.
+ *
+ * It returns the rightmost node of the subtree, or NIL if the subtree is empty.
+ */
+static cmap_node_t *cmap_node_last(cmap_node_t *node) {
+	if (node == NIL)
+		return NIL;
+	while (node->right != NIL)
+		node = node->right;
+	return node;
+}
+
+/**
+ * cmap_node_prev - finding the previous node in ascending order of keys.
+ * @node:	a node in a cmap object.
+ *
+ * It is the mirror of cmap_node_next(), and it returns NIL if @node has
+ * the smallest key.
+ */
+static cmap_node_t *cmap_node_prev(cmap_node_t *node) {
+	if (node->left != NIL)
+		return cmap_node_last(node->left);
+	cmap_node_t *parent = cmap_node_parent(node);
+	while (parent != NIL && node == parent->left) {
+		node = parent;
+		parent = cmap_node_parent(node);
+	}
+	return parent;
+}
+
+/**
+ * cmap_foreach - visiting all keys and values of a cmap object in ascending order.
+ * @map:	the target cmap object.
+ * @visit:	the callback receiving a key, its value and @arg.
+ * @arg:	the argument passed to @visit.
+ *
+ * It walks the nodes by cmap_node_next() without recursion. If @visit returns
+ * false, the walk stops and this function returns false.
+ * The callback must not insert into or erase from @map.
+ */
+static bool cmap_foreach(cmap_t *map, cmap_visit_t visit, void *arg) {
+	for (cmap_node_t *node = cmap_node_first(map->root); node != NIL;
+	     node = cmap_node_next(node)) {
+		if (!visit(node->key, node->val, arg))
+			return false;
+	}
+	return true;
+}
+
+/**
+ * cmap_iter - making an iterator at a node.
+ * @node:	a node in a cmap object, or NIL for the end iterator.
+ */
+static inline cmap_iter_t cmap_iter(cmap_node_t *node) {
+	cmap_iter_t iter = {.node = node, .key = NULL, .val = NULL};
+	if (node != NIL) {
+		iter.key = node->key;
+		iter.val = node->val;
+	}
+	return iter;
+}
+
+/**
+ * cmap_begin - the iterator at the smallest key.
+ * @map:	the target cmap object.
+ *
+ * It returns the end iterator if @map is empty.
  */
-static cmap_node_t *cmap_node_successor(cmap_t *map, cmap_node_t *node) {
-	cmap_node_t *successor = node->right;
-	while (successor->left != NIL)
-		successor = successor->left;
-	return successor;
+static cmap_iter_t cmap_begin(cmap_t *map) {
+	return cmap_iter(cmap_node_first(map->root));
+}
+
+/**
+ * cmap_end - the iterator after the largest key.
+ * @map:	the target cmap object.
+ *
+ * The node of the end iterator is NULL, so "iter.node == NULL" is the
+ * condition to stop a walk.
+ */
+static cmap_iter_t cmap_end(cmap_t *map) {
+	return cmap_iter(NIL);
+}
+
+/**
+ * cmap_next - moving an iterator to the next larger key.
+ * @map:	the target cmap object.
+ * @iter:	an iterator of @map.
+ *
+ * It walks by the parent pointers, so no stack is needed. The end iterator
+ * stays at the end.
+ */
+static cmap_iter_t cmap_next(cmap_t *map, cmap_iter_t iter) {
+	if (iter.node == NIL)
+		return iter;
+	return cmap_iter(cmap_node_next(iter.node));
+}
+
+/**
+ * cmap_prev - moving an iterator to the next smaller key.
+ * @map:	the target cmap object.
+ * @iter:	an iterator of @map.
+ *
+ * Like <map> in C++, the previous position of the end iterator is the
+ * largest key, so a map can be walked backwards from end(). The previous
+ * position of the smallest key is the end iterator.
+ */
+static cmap_iter_t cmap_prev(cmap_t *map, cmap_iter_t iter) {
+	if (iter.node == NIL)
+		return cmap_iter(cmap_node_last(map->root));
+	return cmap_iter(cmap_node_prev(iter.node));
+}
+
+/**
+ * cmap_find - the iterator at a given key.
+ * @map:	the target cmap object.
+ * @key:	the target key.
+ *
+ * It searches like cmap_search() (by the Bloom filter and the hash index
+ * if they are kept), and returns the end iterator if the key does not exist.
+ */
+static cmap_iter_t cmap_find(cmap_t *map, const void *key) {
+	if (map->option.bloom_filter && !cmap_bloom_contains(map, key))
+		return cmap_iter(NIL);
+	if (map->option.hash_index)
+		return cmap_iter(cmap_index_find(map, key));
+	cmap_node_t *node = map->root;
+	uint64_t key_prefix = cmap_key_prefix(map, key);
+	while (node != NIL) {
+		int cmp = cmap_node_cmp_prefix(map, node, key, key_prefix);
+		if (cmp == 0)
+			break;
+		node = cmp < 0 ? node->right : node->left;
+	}
+	return cmap_iter(node);
+}
+
+/**
+ * cmap_lower_bound - the iterator at the first key not less than a given key.
+ * @map:	the target cmap object.
+ * @key:	the target key.
+ *
+ * While descending from the root, the last node whose key is not less than
+ * @key is remembered. It returns the end iterator if all keys are less than @key.
+ */
+static cmap_iter_t cmap_lower_bound(cmap_t *map, const void *key) {
+	cmap_node_t *node = map->root, *bound = NIL;
+	uint64_t key_prefix = cmap_key_prefix(map, key);
+	while (node != NIL) {
+		if (cmap_node_cmp_prefix(map, node, key, key_prefix) >= 0) {
+			bound = node;
+			node = node->left;
+		} else {
+			node = node->right;
+		}
+	}
+	return cmap_iter(bound);
+}
+
+/**
+ * cmap_upper_bound - the iterator at the first key larger than a given key.
+ * @map:	the target cmap object.
+ * @key:	the target key.
+ *
+ * It is the same as cmap_lower_bound() except that a key equal to @key is
+ * skipped. It returns the end iterator if no key is larger than @key.
+ */
+static cmap_iter_t cmap_upper_bound(cmap_t *map, const void *key) {
+	cmap_node_t *node = map->root, *bound = NIL;
+	uint64_t key_prefix = cmap_key_prefix(map, key);
+	while (node != NIL) {
+		if (cmap_node_cmp_prefix(map, node, key, key_prefix) > 0) {
+			bound = node;
+			node = node->left;
+		} else {
+			node = node->right;
+		}
+	}
+	return cmap_iter(bound);
+}
+
+/**
+ * cmap_aggregate_range - the summary of the keys in a range.
+ * @map:	the target cmap object, which should be augmented.
+ * @low:	the smallest key of the range.
+ * @high:	the key after the range, which is not in the range.
+ * @summary:	the buffer of aug_size bytes receiving the summary of the keys in [@low, @high).
+ *
+ * It finds the highest node in the range, then walks down to @low on its left and
+ * to @high on its right. A node on the left walk which is in the range comes with its
+ * whole right subtree, and so does a node on the right walk with its left subtree, so
+ * the summary is combined from O(log n) subtree summaries, where the part of each
+ * node is built in the scratch buffer of @map. (So two threads must not aggregate
+ * the same cmap object at the same time.)
+ * It returns false and leaves @summary untouched if no key is in the range or @map is
+ * not augmented.
+ */
+static bool cmap_aggregate_range(cmap_t *map, const void *low, const void *high, void *summary) {
+	if (map->option.aug_size == 0)
+		return false;
+	cmap_node_t *node = map->root;
+	uint64_t low_prefix = cmap_key_prefix(map, low), high_prefix = cmap_key_prefix(map, high);
+	while (node != NIL) {
+		if (cmap_node_cmp_prefix(map, node, low, low_prefix) < 0)
+			node = node->right;
+		else if (cmap_node_cmp_prefix(map, node, high, high_prefix) >= 0)
+			node = node->left;
+		else
+			break;
+	}
+	if (node == NIL)
+		return false;
+
+	// The scratch buffer is released by destroy(), after which the object may be filled again.
+	if (map->scratch == NULL)
+		map->scratch = malloc(CMAP_ROUND_SIZE(map->option.aug_size));
+	void *part = map->scratch;
+	map->option.aug_lift(summary, node->key, node->val);
+	for (cmap_node_t *cursor = node->left; cursor != NIL;) {
+		if (cmap_node_cmp_prefix(map, cursor, low, low_prefix) < 0) {
+			cursor = cursor->right;
+			continue;
+		}
+		map->option.aug_lift(part, cursor->key, cursor->val);
+		if (cursor->right != NIL)
+			map->option.aug_combine(part, part, cmap_node_summary(map, cursor->right));
+		map->option.aug_combine(summary, part, summary);
+		cursor = cursor->left;
+	}
+	for (cmap_node_t *cursor = node->right; cursor != NIL;) {
+		if (cmap_node_cmp_prefix(map, cursor, high, high_prefix) >= 0) {
+			cursor = cursor->left;
+			continue;
+		}
+		map->option.aug_lift(part, cursor->key, cursor->val);
+		if (cursor->left != NIL)
+			map->option.aug_combine(part, cmap_node_summary(map, cursor->left), part);
+		map->option.aug_combine(summary, summary, part);
+		cursor = cursor->right;
+	}
+	return true;
+}
+
+/**
+ * cmap_interval_overlaps - visiting the intervals overlapping a range.
+ * @map:	the target cmap object, which should be in the interval mode.
+ * @low:	the start of the range.
+ * @high:	the end of the range, which is not in the range.
+ * @visit:	the callback receiving the start (key) and the value of an interval, and @arg.
+ * @arg:	the argument passed to @visit.
+ *
+ * An interval [start, end) overlaps [@low, @high) if start < @high and end > @low.
+ * They are visited in ascending order of their starts by cmap_node_overlaps().
+ * If @visit returns false, the walk stops and this function returns false.
+ * It visits nothing and returns false if @map is not in the interval mode.
+ * The callback must not insert into or erase from @map.
+ */
+static bool cmap_interval_overlaps(cmap_t *map, const void *low, const void *high,
+				   cmap_visit_t visit, void *arg) {
+	if (map->option.interval_end == NULL)
+		return false;
+	return cmap_node_overlaps(map, map->root, low, high, visit, arg);
+}
+
+/**
+ * cmap_node_overlaps - visiting the intervals in a subtree overlapping a range.
+ * @map:	the cmap object owning the nodes.
+ * @node:	the root of the subtree.
+ * @low:	the start of the range.
+ * @high:	the end of the range.
+ * @visit:	the callback.
+ * @arg:	the argument passed to @visit.
+ *
+ * A subtree whose largest end is not larger than @low cannot overlap the range, and
+ * neither can the right subtree of a node starting at or after @high, so only the
+ * subtrees with an overlapping interval and the O(log n) nodes on the border of the
+ * range are walked. A node only knows the largest end of its subtree, so every
+ * overlapping interval may cost a path of its own, and k intervals take
+ * O(log n + k log(n / k)) rather than O(log n + k).
+ */
+static bool cmap_node_overlaps(cmap_t *map, cmap_node_t *node, const void *low,
+			       const void *high, cmap_visit_t visit, void *arg) {
+	if (node == NIL || map->key_interface.cmp(*cmap_node_max_end(map, node), low) <= 0)
+		return true;
+	if (!cmap_node_overlaps(map, node->left, low, high, visit, arg))
+		return false;
+	if (cmap_node_cmp(map, node, high) >= 0)
+		return true;
+	if (map->key_interface.cmp(map->option.interval_end(node->key, node->val), low) > 0 &&
+	    !visit(node->key, node->val, arg))
+		return false;
+	return cmap_node_overlaps(map, node->right, low, high, visit, arg);
+}
+
+/**
+ * cmap_size - the number of keys of a cmap object.
+ * @map:	the target cmap object.
+ *
+ * Every cmap object counts its nodes, so it takes O(1).
+ */
+static size_t cmap_size(cmap_t *map) {
+	return map->count;
+}
+
+/**
+ * cmap_stats - the memory usage of a cmap object.
+ * @map:	the target cmap object.
+ * @stats:	receiving the memory usage.
+ *
+ * The chunks of the pool (used and spare) are walked, so it takes O(number of chunks).
+ * The expected false-positive rate of the Bloom filter is the mean over its blocks
+ * of the chance that all 8 bits chosen in a block are set, which walks the filter.
+ * It is shared by the B-tree mode, whose nodes come from the same kind of pool.
+ */
+void cmap_stats(cmap_t *map, cmap_stats_t *stats) {
+	*stats = (cmap_stats_t){.count = map->count,
+				.node_size = map->pool.node_size,
+				.node_memory = 0,
+				.index_capacity = map->index.capacity,
+				.index_memory = map->index.capacity * sizeof(struct cmap_index_slot),
+				.bloom_memory = map->bloom.block_count * CMAP_BLOOM_BLOCK_SIZE,
+				.bloom_fpr = 0};
+	for (int i = 0; i < 2; i++) {
+		struct cmap_pool_chunk *chunk = i == 0 ? map->pool.chunks : map->pool.spare;
+		for (; chunk != NULL; chunk = chunk->next)
+			stats->node_memory += sizeof(struct cmap_pool_chunk) +
+					      chunk->nodes * map->pool.node_size;
+	}
+	const uint64_t *words = map->bloom.blocks;
+	for (size_t i = 0; i < map->bloom.block_count; i++) {
+		double pass = 1;
+		for (int word = 0; word < 8; word++) {
+			int bits = 0;
+			for (uint64_t bit = words[8 * i + word]; bit != 0; bit &= bit - 1)
+				bits++;
+			pass *= bits / 64.0;
+		}
+		stats->bloom_fpr += pass / map->bloom.block_count;
+	}
+}
+
+/**
+ * cmap_bloom_bit - the bit set by a hash in a word of a block of the Bloom filter.
+ * @hash:	the hash of a key by cmap_key_hash().
+ * @word:	the index of the 64-bit word in the block. (0 to 7)
+ *
+ * Every word of the block has one bit of a key, which is chosen by the low 32
+ * bits of the hash multiplied by a different odd salt, like the split block Bloom
+ * filter of Parquet. The block itself is chosen by the high bits of the hash.
+ */
+static inline uint64_t cmap_bloom_bit(uint64_t hash, int word) {
+	static const uint32_t salts[8] = {0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+					  0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+	return (uint64_t)1 << (((uint32_t)hash * salts[word]) >> 26);
+}
+
+/**
+ * cmap_bloom_block - the index of the block of a hash in the Bloom filter.
+ * @map:	the cmap object with the bloom_filter option, whose filter is built.
+ * @hash:	the hash of a key by cmap_key_hash().
+ *
+ * The high 32 bits of @hash are scaled to the number of blocks by a multiplication and
+ * a shift instead of a mask, so the number of blocks needs not be a power of two.
+ */
+static inline size_t cmap_bloom_block(cmap_t *map, uint64_t hash) {
+	return (size_t)(((hash >> 32) * (uint64_t)map->bloom.block_count) >> 32);
+}
+
+/**
+ * cmap_bloom_add - adding the hash of a key into the Bloom filter.
+ * @map:	the cmap object with the bloom_filter option, whose filter has room for the key.
+ * @hash:	the hash of the key by cmap_key_hash().
+ */
+static inline void cmap_bloom_add(cmap_t *map, uint64_t hash) {
+	uint64_t *block = (uint64_t *)map->bloom.blocks + 8 * cmap_bloom_block(map, hash);
+	for (int word = 0; word < 8; word++)
+		block[word] |= cmap_bloom_bit(hash, word);
+	map->bloom.keys++;
+}
+
+/**
+ * cmap_bloom_contains - whether a key may be in a cmap object by the Bloom filter.
+ * @map:	the cmap object with the bloom_filter option.
+ * @key:	the target key.
+ *
+ * It reads one block, which is a single cache line. It returns false only if the key
+ * is certainly missing, and true for every key in @map (and a few missing keys).
+ */
+static inline bool cmap_bloom_contains(cmap_t *map, const void *key) {
+	if (map->bloom.blocks == NULL)
+		return false;
+	uint64_t hash = cmap_key_hash(map, key);
+	const uint64_t *block = (const uint64_t *)map->bloom.blocks + 8 * cmap_bloom_block(map, hash);
+	for (int word = 0; word < 8; word++) {
+		uint64_t bit = cmap_bloom_bit(hash, word);
+		if ((block[word] & bit) != bit)
+			return false;
+	}
+	return true;
+}
+
+/**
+ * cmap_bloom_maintain - rebuilding the Bloom filter if it is full or has too many erased keys.
+ * @map:	the cmap object with the bloom_filter option, whose nodes are all in the tree.
+ * @adding:	the number of keys which are going to be added.
+ *
+ * The filter is rebuilt once the keys added since it was built exceed its size, or
+ * the erased keys exceed bloom_churn (or the half of the keys added since it was built),
+ * so the cost of a rebuild is spread over the inserts and erases before it.
+ */
+static inline void cmap_bloom_maintain(cmap_t *map, size_t adding) {
+	cmap_bloom_t *bloom = &map->bloom;
+	size_t churn = map->option.bloom_churn != 0 ? map->option.bloom_churn : bloom->keys / 2;
+	if (bloom->keys + adding > bloom->block_count * CMAP_BLOOM_BLOCK_KEYS ||
+	    bloom->erased > churn)
+		cmap_bloom_rebuild(map, map->count + adding);
+}
+
+/**
+ * cmap_bloom_rebuild - building the Bloom filter again from the keys in the tree.
+ * @map:	the cmap object with the bloom_filter option, whose nodes are all in the tree.
+ * @keys:	the number of keys the filter should hold.
+ *
+ * The filter is sized for exactly twice @keys (rounded up to a whole block), and every key in the tree is hashed and added
+ * again, which drops the erased keys. The memory is reused if the size is the same.
+ */
+static void cmap_bloom_rebuild(cmap_t *map, size_t keys) {
+	cmap_bloom_t *bloom = &map->bloom;
+	size_t block_count = (2 * keys + CMAP_BLOOM_BLOCK_KEYS - 1) / CMAP_BLOOM_BLOCK_KEYS;
+	if (block_count == 0)
+		block_count = 1;
+	if (block_count != bloom->block_count) {
+		free(bloom->memory);
+		bloom->memory = malloc(block_count * CMAP_BLOOM_BLOCK_SIZE + CMAP_BLOOM_BLOCK_SIZE - 1);
+		bloom->blocks = (void *)(((uintptr_t)bloom->memory + CMAP_BLOOM_BLOCK_SIZE - 1) &
+					 ~(uintptr_t)(CMAP_BLOOM_BLOCK_SIZE - 1));
+		bloom->block_count = block_count;
+	}
+	memset(bloom->blocks, 0, block_count * CMAP_BLOOM_BLOCK_SIZE);
+	bloom->keys = bloom->erased = 0;
+	for (cmap_node_t *node = cmap_node_first(map->root); node != NIL; node = cmap_node_next(node))
+		cmap_bloom_add(map, cmap_key_hash(map, node->key));
+}
+
+/**
+ * cmap_bloom_reset - making the Bloom filter empty.
+ * @map:	the cmap object.
+ * @release:	whether the filter is released rather than kept for the following inserts.
+ */
+static void cmap_bloom_reset(cmap_t *map, bool release) {
+	if (release) {
+		free(map->bloom.memory);
+		map->bloom = (cmap_bloom_t){.memory = NULL, .blocks = NULL, .block_count = 0};
+	}
+	else if (map->bloom.blocks != NULL)
+		memset(map->bloom.blocks, 0, map->bloom.block_count * CMAP_BLOOM_BLOCK_SIZE);
+	map->bloom.keys = map->bloom.erased = 0;
+}
+
+/**
+ * cmap_select - the iterator at the key with a given rank.
+ * @map:	the target cmap object.
+ * @rank:	the number of keys less than the wanted key, which is 0 for the smallest key.
+ *
+ * In the order statistics mode, the subtree size of the left child tells how many
+ * keys of a subtree are less than its root, so the descent takes O(log n).
+ * Otherwise, it walks @rank keys from the smallest one.
+ * It returns the end iterator if @rank is not less than the number of keys.
+ */
+static cmap_iter_t cmap_select(cmap_t *map, size_t rank) {
+	if (rank >= map->count)
+		return cmap_iter(NIL);
+	if (!map->option.order_statistics) {
+		cmap_node_t *node = cmap_node_first(map->root);
+		while (rank-- > 0)
+			node = cmap_node_next(node);
+		return cmap_iter(node);
+	}
+
+	cmap_node_t *node = map->root;
+	for (;;) {
+		size_t left_size = cmap_node_subtree_size(map, node->left);
+		if (rank == left_size)
+			return cmap_iter(node);
+		if (rank < left_size) {
+			node = node->left;
+		}
+		else {
+			rank -= left_size + 1;
+			node = node->right;
+		}
+	}
+}
+
+/**
+ * cmap_rank - the number of keys less than a given key.
+ * @map:	the target cmap object.
+ * @key:	the target key, which does not have to be in @map.
+ *
+ * In the order statistics mode, the left subtree and the node itself are counted
+ * whenever the descent goes right, so it takes O(log n). Otherwise, it walks the
+ * keys from the smallest one.
+ */
+static size_t cmap_rank(cmap_t *map, const void *key) {
+	size_t rank = 0;
+	uint64_t key_prefix = cmap_key_prefix(map, key);
+	if (!map->option.order_statistics) {
+		for (cmap_node_t *node = cmap_node_first(map->root);
+		     node != NIL && cmap_node_cmp_prefix(map, node, key, key_prefix) < 0;
+		     node = cmap_node_next(node))
+			rank++;
+		return rank;
+	}
+
+	cmap_node_t *node = map->root;
+	while (node != NIL) {
+		if (cmap_node_cmp_prefix(map, node, key, key_prefix) < 0) {
+			rank += cmap_node_subtree_size(map, node->left) + 1;
+			node = node->right;
+		}
+		else {
+			node = node->left;
+		}
+	}
+	return rank;
+}
+
+/**
+ * cmap_clear - erasing all keys of cmap while keeping its memory.
+ * @map:	an object of cmap.
+ *
+ * Every key and value is destroyed as destroy() does, but the chunks of the pool
+ * holding the nodes are kept, so the next fill cycle of the cmap object reuses
+ * them instead of allocating memory again. Options and interfaces are unchanged.
+ * It takes O(n), or O(number of chunks) if both interfaces are borrowed.
+ * All iterators become invalid.
+ */
+static void cmap_clear(cmap_t *map) {
+	cmap_node_destroy(map, map->root);
+	map->root = map->rightmost = NIL;
+	map->count = 0;
+	cmap_pool_reset(&map->pool);
+	cmap_index_reset(map, false);
+	cmap_bloom_reset(map, false);
 }
 
 /**
@@ -676,9 +2993,69 @@ static cmap_node_t *cmap_node_successor(cmap_t *map, cmap_node_t *node) {
  * use the method destroy(), whcih is pointed to cmap_destroy(), to
  * destroy the cmap object.
  * For the field root in a cmap instance, whcih is an instance of cmap node, 
- * it calls its destroy() to destroy the entire tree and points to NIL.
+ * it calls cmap_node_destroy() to destroy the entire tree without recursion and
+ * points to NIL.
+ * Then the chunks of the pool holding all nodes are released at once.
  */
 void cmap_destroy(cmap_t *map) {
-	map->root->destroy(map->root);
-	map->root = NIL;
+	cmap_node_destroy(map, map->root);
+	map->root = map->rightmost = NIL;
+	map->count = 0;
+	cmap_pool_destroy(&map->pool);
+	cmap_index_reset(map, true);
+	cmap_bloom_reset(map, true);
+	free(map->scratch);
+	map->scratch = NULL;
+}
+
+/*
+ * The built-in methods of the interfaces of C strings and integers (see cmap.h).
+ * The comparsions and hashes of the keys of these kinds in a cmap object are usually
+ * done by cmap_node_cmp() and cmap_key_hash() without calling them, and they are
+ * called by the other paths.
+ */
+int cmap_str_cmp(const void *d1, const void *d2) {
+	return strcmp(d1, d2);
+}
+
+size_t cmap_str_size_get(const void *d1) {
+	return strlen(d1) + 1;
+}
+
+int cmap_int32_cmp(const void *d1, const void *d2) {
+	const int32_t *int1 = d1, *int2 = d2;
+	return (*int1 > *int2) - (*int1 < *int2);
+}
+
+size_t cmap_int32_size_get(const void *d1) {
+	return sizeof(int32_t);
+}
+
+int cmap_int64_cmp(const void *d1, const void *d2) {
+	const int64_t *int1 = d1, *int2 = d2;
+	return (*int1 > *int2) - (*int1 < *int2);
+}
+
+int cmap_uint64_cmp(const void *d1, const void *d2) {
+	const uint64_t *int1 = d1, *int2 = d2;
+	return (*int1 > *int2) - (*int1 < *int2);
+}
+
+size_t cmap_int64_size_get(const void *d1) {
+	return sizeof(int64_t);
+}
+
+size_t cmap_str_hash(const void *d1) {
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	for (const unsigned char *str = d1; *str != '\0'; str++)
+		hash = (hash ^ *str) * 0x100000001b3ULL;
+	return (size_t)hash;
+}
+
+size_t cmap_int32_hash(const void *d1) {
+	return (size_t)(uint64_t)*(const int32_t *)d1;
+}
+
+size_t cmap_int64_hash(const void *d1) {
+	return (size_t)*(const uint64_t *)d1;
 }
@@ -0,0 +1,1343 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "cmap.h"
+#include "cmap_internal.h"
+#ifndef DEBUG
+#define DEBUG 1
+#endif
+#if DEBUG == 1
+#include <stdio.h>
+#endif
+
+/**
+ * C map B-tree -	The B+ tree backend of cmap, which is selected by the btree
+ *			option of cmap_init3().
+ *
+ * A red-black tree node holds one key, so a search in a large cmap object takes
+ * one cache miss per level. A node of the B+ tree holds many keys, and small keys
+ * are stored in the node itself, so a search takes a few cache misses in each of
+ * a few levels, and the leaves are linked for walking the keys in order.
+ *
+ * Rules of the B+ tree.
+ * 1.	Every leaf is at the same depth and holds at most CMAP_BTREE_ORDER keys and
+ *	their values in ascending order. The leaves are linked in ascending order.
+ * 2.	An internal node holds at most CMAP_BTREE_ORDER children and a separator key
+ *	between every two adjacent children. A separator is a copy of the smallest
+ *	key in the subtree of the child on its right.
+ * 3.	Every node except the root holds at least CMAP_BTREE_MIN keys (a leaf) or
+ *	children (an internal node). An internal root has at least two children.
+ *
+ * A full child is split before it is walked down by an insertion, and a child with
+ * CMAP_BTREE_MIN keys or children is filled before it is walked down by an erasion,
+ * so neither walks back up and a node needs no parent pointer.
+ */
+
+/**
+ * CMAP_BTREE_ORDER - the largest number of keys in a leaf and children of an internal node.
+ * CMAP_BTREE_MIN - the smallest number of keys or children of a node except the root.
+ *
+ * The order must be even, so that a full node is split into two nodes of CMAP_BTREE_MIN.
+ */
+#ifndef CMAP_BTREE_ORDER
+#define CMAP_BTREE_ORDER 32
+#endif
+#if CMAP_BTREE_ORDER < 4 || CMAP_BTREE_ORDER % 2 != 0
+#error "CMAP_BTREE_ORDER must be an even number not less than 4"
+#endif
+#define CMAP_BTREE_MIN (CMAP_BTREE_ORDER / 2)
+
+/**
+ * struct cmap_bnode - a node of the B+ tree of a cmap object.
+ * @prev:	the previous leaf in ascending order of keys. (NULL for the first leaf
+ *		and internal nodes.)
+ * @next:	the next leaf in ascending order of keys. (NULL for the last leaf and
+ *		internal nodes.)
+ * @count:	the number of keys of a leaf, or the number of children of an internal node.
+ * @leaf:	whether the node is a leaf.
+ * @keys:	the keys of a leaf, or the @count - 1 separators of an internal node.
+ * @vals:	the values of a leaf, or the children of an internal node.
+ *
+ * The inline storage of CMAP_BTREE_ORDER keys, then that of CMAP_BTREE_ORDER values,
+ * follows the node, and the i-th key (or separator) and value stored inline are in
+ * the i-th slots. Moving a key or value stored inline to another slot also moves
+ * its data, while an allocated or borrowed one only moves its pointer.
+ * Nodes are allocated from the pool of the cmap object like red-black tree nodes.
+ */
+struct cmap_bnode {
+	struct cmap_bnode *prev, *next;
+	unsigned int count;
+	bool leaf;
+	void *keys[CMAP_BTREE_ORDER];
+	void *vals[CMAP_BTREE_ORDER];
+};
+
+/*
+ * Functions for struct cmap_bnode
+ *
+ * cmap_bnode_alloc():		Allocation for a B+ tree node.
+ * cmap_bnode_inline_key():	The inline storage of a key slot of a B+ tree node.
+ * cmap_bnode_inline_val():	The inline storage of a value slot of a B+ tree node.
+ * cmap_bnode_child():		A child of an internal node.
+ * cmap_bnode_search():		The first key of a node not less than a given key.
+ * cmap_bnode_index():		The slot of a key in a leaf, which is given by an iterator.
+ * cmap_bnode_move_data():	Moving objects between slots, including their inline data.
+ * cmap_bnode_move_keys():	Moving keys (or separators) between slots of B+ tree nodes.
+ * cmap_bnode_move_vals():	Moving values (or children) between slots of B+ tree nodes.
+ * cmap_bnode_store():		Storing a new key and value into a slot of a leaf.
+ * cmap_bnode_split():		Splitting a full child of an internal node.
+ * cmap_bnode_fill():		Making a child of an internal node hold more than CMAP_BTREE_MIN.
+ * cmap_bnode_merge():		Merging two adjacent children of an internal node.
+ * cmap_bnode_first():		The first leaf of a B+ tree.
+ * cmap_bnode_destroy():	Destructor for the keys, values and separators in a subtree.
+ *
+ * All details about the above functions are mentioned at their implementation places.
+ */
+static struct cmap_bnode *cmap_bnode_alloc(cmap_t *map, bool leaf);
+static inline void *cmap_bnode_inline_key(cmap_t *map, struct cmap_bnode *node, size_t i);
+static inline void *cmap_bnode_inline_val(cmap_t *map, struct cmap_bnode *node, size_t i);
+static inline struct cmap_bnode *cmap_bnode_child(struct cmap_bnode *node, size_t i);
+static size_t cmap_bnode_search(cmap_t *map, struct cmap_bnode *node, const void *key,
+				bool *equal);
+static size_t cmap_bnode_index(struct cmap_bnode *leaf, const void *key);
+static void cmap_bnode_move_data(void **dst, char *dst_inline, void **src, char *src_inline,
+				 size_t size, size_t n);
+static void cmap_bnode_move_keys(cmap_t *map, struct cmap_bnode *dst, size_t to,
+				 struct cmap_bnode *src, size_t from, size_t n);
+static void cmap_bnode_move_vals(cmap_t *map, struct cmap_bnode *dst, size_t to,
+				 struct cmap_bnode *src, size_t from, size_t n);
+static void cmap_bnode_store(cmap_t *map, struct cmap_bnode *leaf, size_t i, const void *key,
+			     const void *val, bool move);
+static void cmap_bnode_split(cmap_t *map, struct cmap_bnode *parent, size_t i);
+static size_t cmap_bnode_fill(cmap_t *map, struct cmap_bnode *parent, size_t i);
+static void cmap_bnode_merge(cmap_t *map, struct cmap_bnode *parent, size_t i);
+static struct cmap_bnode *cmap_bnode_first(cmap_t *map);
+static void cmap_bnode_destroy(cmap_t *map, struct cmap_bnode *node);
+
+/*
+ * Functions for cmap in the B-tree mode
+ *
+ * cmap_btree_init3():		Constructor of cmap in the B-tree mode.
+ * cmap_btree_root():		The root node of a cmap object.
+ * cmap_btree_seek():		The leaf and slot of the first key not less than a given key.
+ * cmap_btree_locate():		Finding the slot of a key, or storing the key into a new slot.
+ * cmap_btree_remove():		Erasing a key and releasing or handing over its data.
+ * cmap_btree_search():		The search function by a given key.
+ * cmap_btree_insert():		Inserting the given key and value.
+ * cmap_btree_get_or_insert():	The value of a key, which is inserted with a default value if it is missing.
+ * cmap_btree_upsert():		Merging a delta into the value of a key in place, or inserting the delta.
+ * cmap_btree_insert_move():	Inserting allocated key and value adopted without copying.
+ * cmap_btree_insert_hint():	Inserting the given key and value, returning its iterator.
+ * cmap_btree_insert_batch():	Inserting several keys and values.
+ * cmap_btree_erase():		Erasing a key.
+ * cmap_btree_extract():	Erasing a key and handing its key and value over to user.
+ * cmap_btree_erase_range():	Erasing all keys in a range.
+ * cmap_btree_count_range():	Counting the keys in a range.
+ * cmap_btree_build_sorted():	Filling an empty cmap object from sorted keys and values.
+ * cmap_btree_foreach():	Visiting all keys and values in ascending order.
+ * cmap_btree_iter():		Making an iterator at a slot of a leaf.
+ * cmap_btree_begin():		The iterator at the smallest key.
+ * cmap_btree_end():		The iterator after the largest key.
+ * cmap_btree_next():		Moving an iterator to the next larger key.
+ * cmap_btree_prev():		Moving an iterator to the next smaller key.
+ * cmap_btree_find():		The iterator at a given key.
+ * cmap_btree_lower_bound():	The iterator at the first key not less than a given key.
+ * cmap_btree_upper_bound():	The iterator at the first key larger than a given key.
+ * cmap_btree_aggregate_range():Not supported in the B-tree mode.
+ * cmap_btree_interval_overlaps():Not supported in the B-tree mode.
+ * cmap_btree_size():		The number of keys.
+ * cmap_btree_select():		The iterator at the key with a given rank.
+ * cmap_btree_rank():		The number of keys less than a given key.
+ * cmap_btree_clear():		Erasing all keys while keeping the memory.
+ * cmap_btree_destroy():	Destructor of cmap in the B-tree mode.
+ *
+ * All details about the above functions are mentioned at their implementation places.
+ */
+cmap_t cmap_btree_init3(cmap_data_t *key_interface, cmap_data_t *val_interface,
+			const cmap_option_t *option);
+static inline struct cmap_bnode *cmap_btree_root(cmap_t *map);
+static struct cmap_bnode *cmap_btree_seek(cmap_t *map, const void *key, size_t *index,
+					  bool *equal);
+static struct cmap_bnode *cmap_btree_locate(cmap_t *map, const void *key, const void *val,
+					    bool move, bool *found, size_t *index);
+static bool cmap_btree_remove(cmap_t *map, const void *key, void **key_out, void **val_out);
+static void *cmap_btree_search(cmap_t *map, const void *key);
+static void cmap_btree_insert(cmap_t *map, const void *key, const void *val);
+static void *cmap_btree_get_or_insert(cmap_t *map, const void *key, const void *default_val);
+static void *cmap_btree_upsert(cmap_t *map, const void *key, const void *delta,
+			       cmap_merge_t merge);
+static void cmap_btree_insert_move(cmap_t *map, void *key, void *val);
+static cmap_iter_t cmap_btree_insert_hint(cmap_t *map, cmap_iter_t hint, const void *key,
+					  const void *val);
+static void cmap_btree_insert_batch(cmap_t *map, const void *const *keys,
+				    const void *const *vals, size_t n);
+static bool cmap_btree_erase(cmap_t *map, const void *key);
+static bool cmap_btree_extract(cmap_t *map, const void *key, void **key_out, void **val_out);
+static size_t cmap_btree_erase_range(cmap_t *map, const void *low, const void *high);
+static size_t cmap_btree_count_range(cmap_t *map, const void *low, const void *high);
+static bool cmap_btree_build_sorted(cmap_t *map, const void *const *keys,
+				    const void *const *vals, size_t n);
+static bool cmap_btree_foreach(cmap_t *map, cmap_visit_t visit, void *arg);
+static inline cmap_iter_t cmap_btree_iter(struct cmap_bnode *leaf, size_t i);
+static cmap_iter_t cmap_btree_begin(cmap_t *map);
+static cmap_iter_t cmap_btree_end(cmap_t *map);
+static cmap_iter_t cmap_btree_next(cmap_t *map, cmap_iter_t iter);
+static cmap_iter_t cmap_btree_prev(cmap_t *map, cmap_iter_t iter);
+static cmap_iter_t cmap_btree_find(cmap_t *map, const void *key);
+static cmap_iter_t cmap_btree_lower_bound(cmap_t *map, const void *key);
+static cmap_iter_t cmap_btree_upper_bound(cmap_t *map, const void *key);
+static bool cmap_btree_aggregate_range(cmap_t *map, const void *low, const void *high,
+				       void *summary);
+static bool cmap_btree_interval_overlaps(cmap_t *map, const void *low, const void *high,
+					 cmap_visit_t visit, void *arg);
+static size_t cmap_btree_size(cmap_t *map);
+static cmap_iter_t cmap_btree_select(cmap_t *map, size_t rank);
+static size_t cmap_btree_rank(cmap_t *map, const void *key);
+static void cmap_btree_clear(cmap_t *map);
+static void cmap_btree_destroy(cmap_t *map);
+
+/**
+ * cmap_bnode_alloc - allocation for a B+ tree node.
+ * @map:	the cmap object owning the node.
+ * @leaf:	whether the node is a leaf.
+ *
+ * The memory is taken from the pool of @map, and the new node is empty and unlinked.
+ */
+static struct cmap_bnode *cmap_bnode_alloc(cmap_t *map, bool leaf) {
+	struct cmap_bnode *node = cmap_pool_alloc(&map->pool);
+	node->prev = node->next = NULL;
+	node->count = 0;
+	node->leaf = leaf;
+	return node;
+}
+
+/**
+ * cmap_bnode_inline_key - the inline storage of a key slot of a B+ tree node.
+ * cmap_bnode_inline_val - the inline storage of a value slot of a B+ tree node.
+ * @map:	the cmap object owning the node.
+ * @node:	a B+ tree node.
+ * @i:		the index of the slot.
+ */
+static inline void *cmap_bnode_inline_key(cmap_t *map, struct cmap_bnode *node, size_t i) {
+	return (char *)(node + 1) + i * CMAP_INLINE_SIZE(&map->key_interface);
+}
+
+static inline void *cmap_bnode_inline_val(cmap_t *map, struct cmap_bnode *node, size_t i) {
+	return (char *)(node + 1) + CMAP_BTREE_ORDER * CMAP_INLINE_SIZE(&map->key_interface) +
+	       i * CMAP_INLINE_SIZE(&map->val_interface);
+}
+
+/**
+ * cmap_bnode_child - a child of an internal node.
+ * @node:	an internal node.
+ * @i:		the index of the child.
+ */
+static inline struct cmap_bnode *cmap_bnode_child(struct cmap_bnode *node, size_t i) {
+	return node->vals[i];
+}
+
+/**
+ * cmap_bnode_search - the first key of a node not less than a given key.
+ * @map:	the cmap object owning the node.
+ * @node:	a B+ tree node.
+ * @key:	the target key.
+ * @equal:	set to whether the key at the returned index is equal to @key.
+ *
+ * The keys of a leaf (or the separators of an internal node) are searched by binary
+ * search. It returns the number of them if all are less than @key.
+ * For an internal node, @key is in the subtree of the child at the returned index,
+ * or at the next one if @equal is set.
+ */
+static size_t cmap_bnode_search(cmap_t *map, struct cmap_bnode *node, const void *key,
+				bool *equal) {
+	size_t low = 0, high = node->leaf ? node->count : node->count - 1;
+	*equal = false;
+	while (low < high) {
+		size_t mid = low + (high - low) / 2;
+		int cmp = map->key_interface.cmp(node->keys[mid], key);
+		if (cmp == 0) {
+			*equal = true;
+			return mid;
+		}
+		if (cmp < 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	return low;
+}
+
+/**
+ * cmap_bnode_index - the slot of a key in a leaf, which is given by an iterator.
+ * @leaf:	the leaf of the iterator.
+ * @key:	the key of the iterator.
+ *
+ * An iterator keeps the pointer to its key, so the slot is found by comparing the
+ * pointers without calling cmp().
+ */
+static size_t cmap_bnode_index(struct cmap_bnode *leaf, const void *key) {
+	size_t i = 0;
+	while (i < leaf->count && leaf->keys[i] != key)
+		i++;
+	return i;
+}
+
+/**
+ * cmap_bnode_move_data - moving objects between slots, including their inline data.
+ * @dst:	the first destination pointer.
+ * @dst_inline:	the inline storage of the first destination slot.
+ * @src:	the first source pointer.
+ * @src_inline:	the inline storage of the first source slot.
+ * @size:	the size of an inline slot, which is 0 if nothing is stored inline.
+ * @n:		the number of objects.
+ *
+ * An object stored in the inline storage of its slot is copied into the inline
+ * storage of the destination slot, and the other objects keep their memory.
+ * The slots may overlap within a node, like memmove().
+ */
+static void cmap_bnode_move_data(void **dst, char *dst_inline, void **src, char *src_inline,
+				 size_t size, size_t n) {
+	bool backward = (uintptr_t)dst > (uintptr_t)src;
+	for (size_t k = 0; k < n; k++) {
+		size_t i = backward ? n - 1 - k : k;
+		void *data = src[i];
+		if (size != 0 && data == src_inline + i * size)
+			data = memcpy(dst_inline + i * size, data, size);
+		dst[i] = data;
+	}
+}
+
+/**
+ * cmap_bnode_move_keys - moving keys (or separators) between slots of B+ tree nodes.
+ * cmap_bnode_move_vals - moving values (or children) between slots of B+ tree nodes.
+ * @map:	the cmap object owning the nodes.
+ * @dst:	the destination node.
+ * @to:		the first destination slot.
+ * @src:	the source node, which may be @dst.
+ * @from:	the first source slot.
+ * @n:		the number of slots.
+ *
+ * The counts of the nodes are not changed. The children of an internal node have no
+ * inline storage, so only their pointers are moved.
+ */
+static void cmap_bnode_move_keys(cmap_t *map, struct cmap_bnode *dst, size_t to,
+				 struct cmap_bnode *src, size_t from, size_t n) {
+	cmap_bnode_move_data(&dst->keys[to], cmap_bnode_inline_key(map, dst, to), &src->keys[from],
+			     cmap_bnode_inline_key(map, src, from),
+			     CMAP_INLINE_SIZE(&map->key_interface), n);
+}
+
+static void cmap_bnode_move_vals(cmap_t *map, struct cmap_bnode *dst, size_t to,
+				 struct cmap_bnode *src, size_t from, size_t n) {
+	cmap_bnode_move_data(&dst->vals[to], cmap_bnode_inline_val(map, dst, to), &src->vals[from],
+			     cmap_bnode_inline_val(map, src, from),
+			     src->leaf ? CMAP_INLINE_SIZE(&map->val_interface) : 0, n);
+}
+
+/**
+ * cmap_bnode_store - storing a new key and value into a slot of a leaf.
+ * @map:	the cmap object owning the leaf.
+ * @leaf:	the target leaf.
+ * @i:		the free slot.
+ * @key:	the key given by user.
+ * @val:	the value given by user.
+ * @move:	whether @key and @val are allocated buffers adopted as they are.
+ *
+ * Like a red-black tree node, the key and value are copied into the inline storage
+ * of the slot or allocated memory by cmap_data_store() unless they are adopted.
+ */
+static void cmap_bnode_store(cmap_t *map, struct cmap_bnode *leaf, size_t i, const void *key,
+			     const void *val, bool move) {
+	if (move) {
+		leaf->keys[i] = (void *)key;
+		leaf->vals[i] = (void *)val;
+		return;
+	}
+	cmap_data_store(&map->key_interface, &leaf->keys[i], cmap_bnode_inline_key(map, leaf, i),
+			key);
+	cmap_data_store(&map->val_interface, &leaf->vals[i], cmap_bnode_inline_val(map, leaf, i),
+			val);
+}
+
+/**
+ * cmap_bnode_split - splitting a full child of an internal node.
+ * @map:	the cmap object owning the nodes.
+ * @parent:	an internal node which is not full.
+ * @i:		the index of the full child.
+ *
+ * The upper half of the child is moved into a new node on its right. For a leaf, the
+ * new leaf is linked after the child and a copy of its smallest key becomes the new
+ * separator; for an internal node, the separator in the middle moves up to @parent.
+ */
+static void cmap_bnode_split(cmap_t *map, struct cmap_bnode *parent, size_t i) {
+	struct cmap_bnode *child = cmap_bnode_child(parent, i);
+	struct cmap_bnode *sibling = cmap_bnode_alloc(map, child->leaf);
+	cmap_bnode_move_keys(map, parent, i + 1, parent, i, parent->count - 1 - i);
+	cmap_bnode_move_vals(map, parent, i + 2, parent, i + 1, parent->count - 1 - i);
+	if (child->leaf) {
+		cmap_bnode_move_keys(map, sibling, 0, child, CMAP_BTREE_MIN,
+				     CMAP_BTREE_ORDER - CMAP_BTREE_MIN);
+		cmap_bnode_move_vals(map, sibling, 0, child, CMAP_BTREE_MIN,
+				     CMAP_BTREE_ORDER - CMAP_BTREE_MIN);
+		sibling->prev = child;
+		sibling->next = child->next;
+		if (child->next != NULL)
+			child->next->prev = sibling;
+		else
+			map->rightmost = (cmap_node_t *)sibling;
+		child->next = sibling;
+		cmap_data_store(&map->key_interface, &parent->keys[i],
+				cmap_bnode_inline_key(map, parent, i), sibling->keys[0]);
+	}
+	else {
+		cmap_bnode_move_keys(map, sibling, 0, child, CMAP_BTREE_MIN,
+				     CMAP_BTREE_ORDER - 1 - CMAP_BTREE_MIN);
+		cmap_bnode_move_vals(map, sibling, 0, child, CMAP_BTREE_MIN,
+				     CMAP_BTREE_ORDER - CMAP_BTREE_MIN);
+		cmap_bnode_move_keys(map, parent, i, child, CMAP_BTREE_MIN - 1, 1);
+	}
+	child->count = CMAP_BTREE_MIN;
+	sibling->count = CMAP_BTREE_ORDER - CMAP_BTREE_MIN;
+	parent->vals[i + 1] = sibling;
+	parent->count++;
+}
+
+/**
+ * cmap_bnode_fill - making a child of an internal node hold more than CMAP_BTREE_MIN.
+ * @map:	the cmap object owning the nodes.
+ * @parent:	an internal node with at least two children, which holds more than
+ *		CMAP_BTREE_MIN children unless it is the root.
+ * @i:		the index of the child holding CMAP_BTREE_MIN keys or children.
+ *
+ * A key (or child) is borrowed from an adjacent sibling holding more than CMAP_BTREE_MIN.
+ * Otherwise, the child is merged with a sibling, where @parent loses a child.
+ * A borrowed key changes the separator between the two nodes: for leaves, it becomes a
+ * copy of the new smallest key of the right one; for internal nodes, the separator moves
+ * down and the one of the sibling moves up.
+ * It returns the index of the child covering the keys of the original child.
+ */
+static size_t cmap_bnode_fill(cmap_t *map, struct cmap_bnode *parent, size_t i) {
+	cmap_data_t *key_interface = &map->key_interface;
+	struct cmap_bnode *child = cmap_bnode_child(parent, i);
+	struct cmap_bnode *left = i > 0 ? cmap_bnode_child(parent, i - 1) : NULL;
+	struct cmap_bnode *right = i + 1 < parent->count ? cmap_bnode_child(parent, i + 1) : NULL;
+
+	if (right != NULL && right->count > CMAP_BTREE_MIN) {
+		if (child->leaf) {
+			cmap_bnode_move_keys(map, child, child->count, right, 0, 1);
+			cmap_bnode_move_vals(map, child, child->count, right, 0, 1);
+			cmap_bnode_move_keys(map, right, 0, right, 1, right->count - 1);
+			cmap_bnode_move_vals(map, right, 0, right, 1, right->count - 1);
+			cmap_data_release(key_interface, parent->keys[i],
+					  cmap_bnode_inline_key(map, parent, i));
+			cmap_data_store(key_interface, &parent->keys[i],
+					cmap_bnode_inline_key(map, parent, i), right->keys[0]);
+		}
+		else {
+			cmap_bnode_move_keys(map, child, child->count - 1, parent, i, 1);
+			cmap_bnode_move_vals(map, child, child->count, right, 0, 1);
+			cmap_bnode_move_keys(map, parent, i, right, 0, 1);
+			cmap_bnode_move_keys(map, right, 0, right, 1, right->count - 2);
+			cmap_bnode_move_vals(map, right, 0, right, 1, right->count - 1);
+		}
+		child->count++;
+		right->count--;
+	}
+	else if (left != NULL && left->count > CMAP_BTREE_MIN) {
+		if (child->leaf) {
+			cmap_bnode_move_keys(map, child, 1, child, 0, child->count);
+			cmap_bnode_move_vals(map, child, 1, child, 0, child->count);
+			cmap_bnode_move_keys(map, child, 0, left, left->count - 1, 1);
+			cmap_bnode_move_vals(map, child, 0, left, left->count - 1, 1);
+			cmap_data_release(key_interface, parent->keys[i - 1],
+					  cmap_bnode_inline_key(map, parent, i - 1));
+			cmap_data_store(key_interface, &parent->keys[i - 1],
+					cmap_bnode_inline_key(map, parent, i - 1), child->keys[0]);
+		}
+		else {
+			cmap_bnode_move_keys(map, child, 1, child, 0, child->count - 1);
+			cmap_bnode_move_vals(map, child, 1, child, 0, child->count);
+			cmap_bnode_move_keys(map, child, 0, parent, i - 1, 1);
+			cmap_bnode_move_vals(map, child, 0, left, left->count - 1, 1);
+			cmap_bnode_move_keys(map, parent, i - 1, left, left->count - 2, 1);
+		}
+		child->count++;
+		left->count--;
+	}
+	else if (right != NULL) {
+		cmap_bnode_merge(map, parent, i);
+	}
+	else {
+		cmap_bnode_merge(map, parent, i - 1);
+		i--;
+	}
+	return i;
+}
+
+/**
+ * cmap_bnode_merge - merging two adjacent children of an internal node.
+ * @map:	the cmap object owning the nodes.
+ * @parent:	an internal node.
+ * @i:		the index of the left child, which absorbs the right child.
+ *
+ * Both children hold at most CMAP_BTREE_MIN keys (or children), so the merged node
+ * fits. The separator between them is released for leaves, or moves down into the
+ * merged node for internal nodes, and the right child returns to the pool.
+ */
+static void cmap_bnode_merge(cmap_t *map, struct cmap_bnode *parent, size_t i) {
+	struct cmap_bnode *child = cmap_bnode_child(parent, i);
+	struct cmap_bnode *right = cmap_bnode_child(parent, i + 1);
+	if (child->leaf) {
+		cmap_bnode_move_keys(map, child, child->count, right, 0, right->count);
+		cmap_bnode_move_vals(map, child, child->count, right, 0, right->count);
+		child->next = right->next;
+		if (right->next != NULL)
+			right->next->prev = child;
+		else
+			map->rightmost = (cmap_node_t *)child;
+		cmap_data_release(&map->key_interface, parent->keys[i],
+				  cmap_bnode_inline_key(map, parent, i));
+	}
+	else {
+		cmap_bnode_move_keys(map, child, child->count - 1, parent, i, 1);
+		cmap_bnode_move_keys(map, child, child->count, right, 0, right->count - 1);
+		cmap_bnode_move_vals(map, child, child->count, right, 0, right->count);
+	}
+	child->count += right->count;
+	cmap_bnode_move_keys(map, parent, i, parent, i + 1, parent->count - 2 - i);
+	cmap_bnode_move_vals(map, parent, i + 1, parent, i + 2, parent->count - 2 - i);
+	parent->count--;
+	cmap_pool_free(&map->pool, right);
+}
+
+/**
+ * cmap_bnode_first - the first leaf of a B+ tree.
+ * @map:	a cmap object in the B-tree mode.
+ *
+ * It returns NULL if @map is empty.
+ */
+static struct cmap_bnode *cmap_bnode_first(cmap_t *map) {
+	struct cmap_bnode *node = cmap_btree_root(map);
+	while (node != NULL && !node->leaf)
+		node = cmap_bnode_child(node, 0);
+	return node;
+}
+
+/**
+ * cmap_bnode_destroy - destructor for the keys, values and separators in a subtree.
+ * @map:	the cmap object owning the subtree.
+ * @node:	the root of the subtree.
+ *
+ * The recursion is as deep as the height of the tree, which is a few levels even
+ * for billions of keys. The memory of the nodes belongs to the pool of @map, so
+ * the caller resets or releases the pool afterwards.
+ */
+static void cmap_bnode_destroy(cmap_t *map, struct cmap_bnode *node) {
+	if (node->leaf) {
+		for (size_t i = 0; i < node->count; i++) {
+			cmap_data_release(&map->key_interface, node->keys[i],
+					  cmap_bnode_inline_key(map, node, i));
+			cmap_data_release(&map->val_interface, node->vals[i],
+					  cmap_bnode_inline_val(map, node, i));
+		}
+		return;
+	}
+	for (size_t i = 0; i + 1 < node->count; i++)
+		cmap_data_release(&map->key_interface, node->keys[i],
+				  cmap_bnode_inline_key(map, node, i));
+	for (size_t i = 0; i < node->count; i++)
+		cmap_bnode_destroy(map, cmap_bnode_child(node, i));
+}
+
+#if DEBUG == 1
+/**
+ * cmap_bnode_validate() is used by cmap_btree_validate() to verify a subtree.
+ *
+ * It checks the number of keys or children of every node, the order of the keys,
+ * the separators (each one is equal to the smallest key on its right), the depth
+ * of the leaves and the links between the leaves.
+ * @low is the separator on the left of the subtree (NULL for none), @depth is the
+ * depth of the subtree, @leaf_depth receives the depth of the first leaf and @last
+ * is the last leaf visited. It returns the number of keys in the subtree.
+ */
+static size_t cmap_bnode_validate(cmap_t *map, struct cmap_bnode *node, const void *low,
+				  size_t depth, size_t *leaf_depth, struct cmap_bnode **last) {
+	int (*cmp)(const void *, const void *) = map->key_interface.cmp;
+	bool root = node == cmap_btree_root(map);
+	size_t keys = node->leaf ? node->count : node->count - 1;
+	if (node->count > CMAP_BTREE_ORDER ||
+	    node->count < (root ? (node->leaf ? 1 : 2) : CMAP_BTREE_MIN)) {
+		fprintf(stderr, "The number of the keys of a cmap B+ tree node is wrong\n");
+		exit(0);
+	}
+	for (size_t i = 1; i < keys; i++) {
+		if (cmp(node->keys[i - 1], node->keys[i]) >= 0) {
+			fprintf(stderr, "The keys of a cmap B+ tree node are not sorted\n");
+			exit(0);
+		}
+	}
+	if (node->leaf) {
+		if ((low != NULL && cmp(node->keys[0], low) < 0) ||
+		    (*last != NULL && cmp((*last)->keys[(*last)->count - 1], node->keys[0]) >= 0)) {
+			fprintf(stderr, "The keys of the cmap B+ tree are not sorted\n");
+			exit(0);
+		}
+		if (*leaf_depth == 0)
+			*leaf_depth = depth;
+		if (*leaf_depth != depth || node->prev != *last ||
+		    (*last != NULL && (*last)->next != node)) {
+			fprintf(stderr, "The leaves of the cmap B+ tree are wrong\n");
+			exit(0);
+		}
+		*last = node;
+		return node->count;
+	}
+	size_t count = 0;
+	for (size_t i = 0; i < node->count; i++) {
+		struct cmap_bnode *child = cmap_bnode_child(node, i);
+		const void *separator = i > 0 ? node->keys[i - 1] : low;
+		if (i > 0) {
+			struct cmap_bnode *first = child;
+			while (!first->leaf)
+				first = cmap_bnode_child(first, 0);
+			if (cmp(first->keys[0], separator) != 0) {
+				fprintf(stderr, "A separator of the cmap B+ tree is wrong\n");
+				exit(0);
+			}
+		}
+		count += cmap_bnode_validate(map, child, separator, depth + 1, leaf_depth, last);
+	}
+	return count;
+}
+
+static void cmap_btree_validate(cmap_t *map) {
+	struct cmap_bnode *root = cmap_btree_root(map), *last = NULL;
+	size_t leaf_depth = 0, count = 0;
+	if (root != NULL)
+		count = cmap_bnode_validate(map, root, NULL, 1, &leaf_depth, &last);
+	if ((cmap_node_t *)last != map->rightmost || (last != NULL && last->next != NULL)) {
+		fprintf(stderr, "The last leaf of the cmap B+ tree is wrong\n");
+		exit(0);
+	}
+	if (count != map->count) {
+		fprintf(stderr, "The number of the keys of the cmap B+ tree is wrong\n");
+		exit(0);
+	}
+}
+#endif
+
+/**
+ * cmap_btree_init3 - constructor of cmap in the B-tree mode.
+ * @key_interface:	an object of cmap_data type with defined implementation assigned by user for key.
+ * @val_interface:	an object of cmap_data type with defiend implementation assigned by user for value.
+ * @option:		the options of the cmap object, whose btree is set.
+ *
+ * The methods of the object are the functions of this file, so user calls them
+ * like the methods of a red-black tree. Every node of the pool has the inline storage
+ * of CMAP_BTREE_ORDER keys and values, which is unused by internal nodes.
+ */
+cmap_t cmap_btree_init3(cmap_data_t *key_interface, cmap_data_t *val_interface,
+			const cmap_option_t *option) {
+	cmap_t map = {.root = NIL,
+		      .rightmost = NIL,
+		      .key_interface = *key_interface,
+		      .val_interface = *val_interface,
+		      .option = *option,
+		      .count = 0,
+		      .retire = NULL,
+		      .pool = {.node_size = sizeof(struct cmap_bnode) +
+					    CMAP_BTREE_ORDER * (CMAP_INLINE_SIZE(key_interface) +
+								CMAP_INLINE_SIZE(val_interface))},
+		      .search = cmap_btree_search,
+		      .insert = cmap_btree_insert,
+		      .get_or_insert = cmap_btree_get_or_insert,
+		      .upsert = cmap_btree_upsert,
+		      .insert_move = cmap_btree_insert_move,
+		      .insert_hint = cmap_btree_insert_hint,
+		      .insert_batch = cmap_btree_insert_batch,
+		      .erase = cmap_btree_erase,
+		      .extract = cmap_btree_extract,
+		      .erase_range = cmap_btree_erase_range,
+		      .count_range = cmap_btree_count_range,
+		      .build_sorted = cmap_btree_build_sorted,
+		      .foreach = cmap_btree_foreach,
+		      .begin = cmap_btree_begin,
+		      .end = cmap_btree_end,
+		      .next = cmap_btree_next,
+		      .prev = cmap_btree_prev,
+		      .find = cmap_btree_find,
+		      .lower_bound = cmap_btree_lower_bound,
+		      .upper_bound = cmap_btree_upper_bound,
+		      .aggregate_range = cmap_btree_aggregate_range,
+		      .interval_overlaps = cmap_btree_interval_overlaps,
+		      .size = cmap_btree_size,
+		      .stats = cmap_stats,
+		      .select = cmap_btree_select,
+		      .rank = cmap_btree_rank,
+		      .clear = cmap_btree_clear,
+		      .destroy = cmap_btree_destroy,
+		      .dealloc = free};
+	map.key_interface.data = map.val_interface.data = NULL;
+	return map;
+}
+
+/**
+ * cmap_btree_root - the root node of a cmap object in the B-tree mode.
+ * @map:	a cmap object in the B-tree mode.
+ *
+ * The root field of cmap_t keeps the root of either tree, so it is converted here.
+ */
+static inline struct cmap_bnode *cmap_btree_root(cmap_t *map) {
+	return (struct cmap_bnode *)map->root;
+}
+
+/**
+ * cmap_btree_seek - the leaf and slot of the first key not less than a given key.
+ * @map:	the target cmap object.
+ * @key:	the target key.
+ * @index:	receiving the slot in the returned leaf, which is the count of the leaf
+ *		if all keys of the leaf are less than @key.
+ * @equal:	receiving whether the key in the slot is equal to @key.
+ *
+ * It walks down from the root by binary search in every node without changing
+ * anything. It returns NULL if @map is empty.
+ */
+static struct cmap_bnode *cmap_btree_seek(cmap_t *map, const void *key, size_t *index,
+					  bool *equal) {
+	struct cmap_bnode *node = cmap_btree_root(map);
+	*equal = false;
+	*index = 0;
+	if (node == NULL)
+		return NULL;
+	while (!node->leaf) {
+		size_t i = cmap_bnode_search(map, node, key, equal);
+		node = cmap_bnode_child(node, i + *equal);
+	}
+	*index = cmap_bnode_search(map, node, key, equal);
+	return node;
+}
+
+/**
+ * cmap_btree_locate - finding the slot of a key, or storing the key into a new slot.
+ * @map:	the target cmap object.
+ * @key:	the target key.
+ * @val:	the value of the new slot if @key is missing.
+ * @move:	whether @key and @val are adopted by the new slot rather than copied.
+ * @found:	set to whether @key was in @map, where @key and @val are not used.
+ * @index:	receiving the slot of @key in the returned leaf.
+ *
+ * A key larger than all keys is appended to the last leaf, which is cached in the
+ * cmap object, by one comparsion if the leaf is not full. Otherwise, it walks down
+ * from the root and splits every full node on the way (a full root gets a new root
+ * above it first), so the leaf always has room for the new key.
+ * It returns the leaf holding @key.
+ */
+static struct cmap_bnode *cmap_btree_locate(cmap_t *map, const void *key, const void *val,
+					    bool move, bool *found, size_t *index) {
+	struct cmap_bnode *node = (struct cmap_bnode *)map->rightmost;
+	size_t i;
+	bool equal = false;
+	if (node == NULL) {
+		node = cmap_bnode_alloc(map, true);
+		map->root = map->rightmost = (cmap_node_t *)node;
+		i = 0;
+	}
+	else if (node->count < CMAP_BTREE_ORDER &&
+		 map->key_interface.cmp(node->keys[node->count - 1], key) < 0) {
+		i = node->count;
+	}
+	else {
+		node = cmap_btree_root(map);
+		if (node->count == CMAP_BTREE_ORDER) {
+			struct cmap_bnode *root = cmap_bnode_alloc(map, false);
+			root->vals[0] = node;
+			root->count = 1;
+			map->root = (cmap_node_t *)root;
+			cmap_bnode_split(map, root, 0);
+			node = root;
+		}
+		while (!node->leaf) {
+			i = cmap_bnode_search(map, node, key, &equal) + equal;
+			if (cmap_bnode_child(node, i)->count == CMAP_BTREE_ORDER) {
+				cmap_bnode_split(map, node, i);
+				if (map->key_interface.cmp(node->keys[i], key) <= 0)
+					i++;
+			}
+			node = cmap_bnode_child(node, i);
+		}
+		i = cmap_bnode_search(map, node, key, &equal);
+	}
+
+	*found = equal;
+	*index = i;
+	if (equal)
+		return node;
+	cmap_bnode_move_keys(map, node, i + 1, node, i, node->count - i);
+	cmap_bnode_move_vals(map, node, i + 1, node, i, node->count - i);
+	cmap_bnode_store(map, node, i, key, val, move);
+	node->count++;
+	map->count++;
+	return node;
+}
+
+/**
+ * cmap_btree_remove - erasing a key and releasing or handing over its data.
+ * @map:	the target cmap object.
+ * @key:	the target key.
+ * @key_out:	receiving the key by cmap_data_detach(), or NULL if the key should be released.
+ * @val_out:	receiving the value like @key_out.
+ *
+ * It walks down from the root and fills every child holding CMAP_BTREE_MIN keys or
+ * children before walking into it, so the leaf can lose a key. A root left with one
+ * child is replaced by the child.
+ * If the key was the smallest key of a leaf other than the first one, it is also a
+ * separator of an ancestor, which is replaced by a copy of the next key before the
+ * key is released. It returns false if the key does not exist.
+ */
+static bool cmap_btree_remove(cmap_t *map, const void *key, void **key_out, void **val_out) {
+	struct cmap_bnode *node = cmap_btree_root(map);
+	bool equal;
+	if (node == NULL)
+		return false;
+	while (!node->leaf) {
+		size_t i = cmap_bnode_search(map, node, key, &equal) + equal;
+		if (cmap_bnode_child(node, i)->count == CMAP_BTREE_MIN) {
+			i = cmap_bnode_fill(map, node, i);
+			if (node->count == 1) {
+				map->root = (cmap_node_t *)cmap_bnode_child(node, 0);
+				cmap_pool_free(&map->pool, node);
+				node = cmap_btree_root(map);
+				continue;
+			}
+		}
+		node = cmap_bnode_child(node, i);
+	}
+	size_t i = cmap_bnode_search(map, node, key, &equal);
+	if (!equal)
+		return false;
+
+	if (i == 0 && node->prev != NULL) {
+		struct cmap_bnode *parent = cmap_btree_root(map);
+		for (;;) {
+			size_t j = cmap_bnode_search(map, parent, key, &equal);
+			if (equal) {
+				cmap_data_release(&map->key_interface, parent->keys[j],
+						  cmap_bnode_inline_key(map, parent, j));
+				cmap_data_store(&map->key_interface, &parent->keys[j],
+						cmap_bnode_inline_key(map, parent, j), node->keys[1]);
+				break;
+			}
+			parent = cmap_bnode_child(parent, j);
+		}
+	}
+	if (key_out != NULL)
+		*key_out = cmap_data_detach(&map->key_interface, node->keys[i],
+					    cmap_bnode_inline_key(map, node, i));
+	else
+		cmap_data_release(&map->key_interface, node->keys[i],
+				  cmap_bnode_inline_key(map, node, i));
+	if (val_out != NULL)
+		*val_out = cmap_data_detach(&map->val_interface, node->vals[i],
+					    cmap_bnode_inline_val(map, node, i));
+	else
+		cmap_data_release(&map->val_interface, node->vals[i],
+				  cmap_bnode_inline_val(map, node, i));
+	cmap_bnode_move_keys(map, node, i, node, i + 1, node->count - 1 - i);
+	cmap_bnode_move_vals(map, node, i, node, i + 1, node->count - 1 - i);
+	node->count--;
+	map->count--;
+	if (node->count == 0) {
+		cmap_pool_free(&map->pool, node);
+		map->root = map->rightmost = NIL;
+	}
+	return true;
+}
+
+/**
+ * cmap_btree_search - the search function for cmap in the B-tree mode by a given key.
+ * @map:	the target cmap object.
+ * @key:	the target key.
+ *
+ * It returns the pointer to the value of the key, or NULL if the key does not exist.
+ * The pointer stays valid until the next change of @map.
+ */
+static void *cmap_btree_search(cmap_t *map, const void *key) {
+	size_t i;
+	bool equal;
+	struct cmap_bnode *leaf = cmap_btree_seek(map, key, &i, &equal);
+	return equal ? leaf->vals[i] : NULL;
+}
+
+/**
+ * cmap_btree_insert - inserting the given key and value, or updating the value of an
+ *		       existed key.
+ * @map:	the target cmap object.
+ * @key:	the target key.
+ * @val:	the target value.
+ */
+static void cmap_btree_insert(cmap_t *map, const void *key, const void *val) {
+	size_t i;
+	bool found;
+	struct cmap_bnode *leaf = cmap_btree_locate(map, key, val, false, &found, &i);
+	if (found) {
+		cmap_data_release(&map->val_interface, leaf->vals[i],
+				  cmap_bnode_inline_val(map, leaf, i));
+		cmap_data_store(&map->val_interface, &leaf->vals[i],
+				cmap_bnode_inline_val(map, leaf, i), val);
+	}
+#if DEBUG == 1
+	cmap_btree_validate(map);
+#endif
+}
+
+/**
+ * cmap_btree_get_or_insert - the value of a key, which is inserted with a default value
+ *			      if it is missing.
+ * @map:		the target cmap object.
+ * @key:		the target key.
+ * @default_val:	the value inserted with @key if @key is missing.
+ *
+ * It returns the pointer to the value of @key, which can be changed in place until
+ * the next change of @map.
+ */
+static void *cmap_btree_get_or_insert(cmap_t *map, const void *key, const void *default_val) {
+	size_t i;
+	bool found;
+	struct cmap_bnode *leaf = cmap_btree_locate(map, key, default_val, false, &found, &i);
+#if DEBUG == 1
+	cmap_btree_validate(map);
+#endif
+	return leaf->vals[i];
+}
+
+/**
+ * cmap_btree_upsert - merging a delta into the value of a key in place, or inserting the delta.
+ * @map:	the target cmap object.
+ * @key:	the target key.
+ * @delta:	the object merged into the value of @key, or the value of @key if it is missing.
+ * @merge:	the callback merging @delta into the value.
+ *
+ * It returns the pointer to the value of @key like cmap_btree_get_or_insert().
+ */
+static void *cmap_btree_upsert(cmap_t *map, const void *key, const void *delta,
+			       cmap_merge_t merge) {
+	size_t i;
+	bool found;
+	struct cmap_bnode *leaf = cmap_btree_locate(map, key, delta, false, &found, &i);
+	if (found)
+		merge(leaf->vals[i], delta);
+#if DEBUG == 1
+	cmap_btree_validate(map);
+#endif
+	return leaf->vals[i];
+}
+
+/**
+ * cmap_btree_insert_move - inserting allocated key and value adopted without copying.
+ * @map:	the target cmap object.
+ * @key:	the key allocated by the dealloc() compatible allocator of the key interface.
+ * @val:	the value allocated by the dealloc() compatible allocator of the val interface.
+ *
+ * Like the red-black tree, the slot keeps @key and @val as they are, and @key is
+ * released if the key exists, where the old value is replaced by @val.
+ */
+static void cmap_btree_insert_move(cmap_t *map, void *key, void *val) {
+	size_t i;
+	bool found;
+	struct cmap_bnode *leaf = cmap_btree_locate(map, key, val, true, &found, &i);
+	if (found) {
+		cmap_data_release(&map->key_interface, key, NULL);
+		cmap_data_release(&map->val_interface, leaf->vals[i],
+				  cmap_bnode_inline_val(map, leaf, i));
+		leaf->vals[i] = val;
+	}
+#if DEBUG == 1
+	cmap_btree_validate(map);
+#endif
+}
+
+/**
+ * cmap_btree_insert_hint - inserting the given key and value, returning its iterator.
+ * @map:	the target cmap object.
+ * @hint:	an iterator given by user, which is not used.
+ * @key:	the target key.
+ * @val:	the target value.
+ *
+ * A search of the B+ tree takes a few levels, so the hint is ignored. (A key larger
+ * than all keys is still appended by one comparsion.)
+ */
+static cmap_iter_t cmap_btree_insert_hint(cmap_t *map, cmap_iter_t hint, const void *key,
+					  const void *val) {
+	size_t i;
+	bool found;
+	struct cmap_bnode *leaf = cmap_btree_locate(map, key, val, false, &found, &i);
+	if (found) {
+		cmap_data_release(&map->val_interface, leaf->vals[i],
+				  cmap_bnode_inline_val(map, leaf, i));
+		cmap_data_store(&map->val_interface, &leaf->vals[i],
+				cmap_bnode_inline_val(map, leaf, i), val);
+	}
+#if DEBUG == 1
+	cmap_btree_validate(map);
+#endif
+	return cmap_btree_iter(leaf, i);
+}
+
+/**
+ * cmap_btree_insert_batch - inserting several keys and values.
+ * @map:	the target cmap object.
+ * @keys:	the keys in any order.
+ * @vals:	the values of @keys.
+ * @n:		the number of keys and values.
+ *
+ * The keys are inserted in the given order, so the last value of a duplicated key
+ * is kept like the red-black tree.
+ */
+static void cmap_btree_insert_batch(cmap_t *map, const void *const *keys,
+				    const void *const *vals, size_t n) {
+	for (size_t i = 0; i < n; i++)
+		cmap_btree_insert(map, keys[i], vals[i]);
+}
+
+/**
+ * cmap_btree_erase - erasing a key.
+ * @map:	the target cmap object.
+ * @key:	the target key.
+ *
+ * It returns false if the key does not exist.
+ */
+static bool cmap_btree_erase(cmap_t *map, const void *key) {
+	bool erased = cmap_btree_remove(map, key, NULL, NULL);
+#if DEBUG == 1
+	cmap_btree_validate(map);
+#endif
+	return erased;
+}
+
+/**
+ * cmap_btree_extract - erasing a key and handing its key and value over to user.
+ * @map:	the target cmap object.
+ * @key:	the target key.
+ * @key_out:	receiving the key, or NULL if the key should be released.
+ * @val_out:	receiving the value, or NULL if the value should be released.
+ *
+ * It is the same as the red-black tree. It returns false if the key does not exist.
+ */
+static bool cmap_btree_extract(cmap_t *map, const void *key, void **key_out, void **val_out) {
+	bool erased = cmap_btree_remove(map, key, key_out, val_out);
+#if DEBUG == 1
+	cmap_btree_validate(map);
+#endif
+	return erased;
+}
+
+/**
+ * cmap_btree_erase_range - erasing all keys in a range.
+ * @map:	the target cmap object.
+ * @low:	the smallest key of the range.
+ * @high:	the key after the range, which is not in the range.
+ *
+ * The keys in [@low, @high) are erased one by one from the smallest, which takes
+ * O(k log n). The key to erase is detached from its slot first, because erasing
+ * moves the keys of the leaves, and the detached key is released by the erasion.
+ * It returns the number of erased keys.
+ */
+static size_t cmap_btree_erase_range(cmap_t *map, const void *low, const void *high) {
+	size_t erased = 0;
+	for (;;) {
+		size_t i;
+		bool equal;
+		struct cmap_bnode *leaf = cmap_btree_seek(map, low, &i, &equal);
+		if (leaf != NULL && i == leaf->count) {
+			leaf = leaf->next;
+			i = 0;
+		}
+		if (leaf == NULL || map->key_interface.cmp(leaf->keys[i], high) >= 0)
+			break;
+		leaf->keys[i] = cmap_data_detach(&map->key_interface, leaf->keys[i],
+						 cmap_bnode_inline_key(map, leaf, i));
+		cmap_btree_remove(map, leaf->keys[i], NULL, NULL);
+		erased++;
+	}
+#if DEBUG == 1
+	cmap_btree_validate(map);
+#endif
+	return erased;
+}
+
+/**
+ * cmap_btree_count_range - counting the keys in a range.
+ * @map:	the target cmap object.
+ * @low:	the smallest key of the range.
+ * @high:	the key after the range, which is not in the range.
+ *
+ * It walks the leaves from @low, which takes O(log n + k).
+ */
+static size_t cmap_btree_count_range(cmap_t *map, const void *low, const void *high) {
+	size_t count = 0;
+	for (cmap_iter_t it = cmap_btree_lower_bound(map, low);
+	     it.node != NULL && map->key_interface.cmp(it.key, high) < 0;
+	     it = cmap_btree_next(map, it))
+		count++;
+	return count;
+}
+
+/**
+ * cmap_btree_build_sorted - filling an empty cmap object from sorted keys and values.
+ * @map:	the target cmap object, which must be empty.
+ * @keys:	the keys in strictly ascending order.
+ * @vals:	the values of @keys.
+ * @n:		the number of keys and values.
+ *
+ * Every key is larger than the previous one, so it is appended to the last leaf
+ * by one comparsion until the leaf is full.
+ * It returns false and does nothing if @map is not empty or @keys are not in
+ * strictly ascending order (including duplicated keys).
+ */
+static bool cmap_btree_build_sorted(cmap_t *map, const void *const *keys,
+				    const void *const *vals, size_t n) {
+	if (map->root != NIL)
+		return false;
+	for (size_t i = 1; i < n; i++) {
+		if (map->key_interface.cmp(keys[i - 1], keys[i]) >= 0)
+			return false;
+	}
+	for (size_t i = 0; i < n; i++) {
+		size_t index;
+		bool found;
+		cmap_btree_locate(map, keys[i], vals[i], false, &found, &index);
+	}
+#if DEBUG == 1
+	cmap_btree_validate(map);
+#endif
+	return true;
+}
+
+/**
+ * cmap_btree_foreach - visiting all keys and values in ascending order.
+ * @map:	the target cmap object.
+ * @visit:	the callback receiving a key, its value and @arg.
+ * @arg:	the argument passed to @visit.
+ *
+ * It walks the linked leaves. If @visit returns false, the walk stops and this
+ * function returns false. The callback must not insert into or erase from @map.
+ */
+static bool cmap_btree_foreach(cmap_t *map, cmap_visit_t visit, void *arg) {
+	for (struct cmap_bnode *leaf = cmap_bnode_first(map); leaf != NULL; leaf = leaf->next) {
+		for (size_t i = 0; i < leaf->count; i++) {
+			if (!visit(leaf->keys[i], leaf->vals[i], arg))
+				return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * cmap_btree_iter - making an iterator at a slot of a leaf.
+ * @leaf:	a leaf, or NULL for the end iterator.
+ * @i:		the slot, where the count of @leaf means the first slot of the next leaf.
+ *
+ * The node of the iterator is the leaf, and its key tells the slot.
+ */
+static inline cmap_iter_t cmap_btree_iter(struct cmap_bnode *leaf, size_t i) {
+	cmap_iter_t iter = {.node = NULL, .key = NULL, .val = NULL};
+	if (leaf != NULL && i == leaf->count) {
+		leaf = leaf->next;
+		i = 0;
+	}
+	if (leaf != NULL) {
+		iter.node = (cmap_node_t *)leaf;
+		iter.key = leaf->keys[i];
+		iter.val = leaf->vals[i];
+	}
+	return iter;
+}
+
+/**
+ * cmap_btree_begin - the iterator at the smallest key.
+ * @map:	the target cmap object.
+ *
+ * It returns the end iterator if @map is empty.
+ */
+static cmap_iter_t cmap_btree_begin(cmap_t *map) {
+	return cmap_btree_iter(cmap_bnode_first(map), 0);
+}
+
+/**
+ * cmap_btree_end - the iterator after the largest key.
+ * @map:	the target cmap object.
+ */
+static cmap_iter_t cmap_btree_end(cmap_t *map) {
+	return cmap_btree_iter(NULL, 0);
+}
+
+/**
+ * cmap_btree_next - moving an iterator to the next larger key.
+ * @map:	the target cmap object.
+ * @iter:	an iterator of @map.
+ *
+ * The next key is in the same leaf or the first key of the next leaf. The end
+ * iterator stays at the end.
+ */
+static cmap_iter_t cmap_btree_next(cmap_t *map, cmap_iter_t iter) {
+	if (iter.node == NULL)
+		return iter;
+	struct cmap_bnode *leaf = (struct cmap_bnode *)iter.node;
+	return cmap_btree_iter(leaf, cmap_bnode_index(leaf, iter.key) + 1);
+}
+
+/**
+ * cmap_btree_prev - moving an iterator to the next smaller key.
+ * @map:	the target cmap object.
+ * @iter:	an iterator of @map.
+ *
+ * Like the red-black tree, the previous position of the end iterator is the
+ * largest key, and the previous position of the smallest key is the end iterator.
+ */
+static cmap_iter_t cmap_btree_prev(cmap_t *map, cmap_iter_t iter) {
+	struct cmap_bnode *leaf = (struct cmap_bnode *)map->rightmost;
+	size_t i = leaf == NULL ? 0 : leaf->count;
+	if (iter.node != NULL) {
+		leaf = (struct cmap_bnode *)iter.node;
+		i = cmap_bnode_index(leaf, iter.key);
+	}
+	if (leaf != NULL && i == 0) {
+		leaf = leaf->prev;
+		i = leaf == NULL ? 0 : leaf->count;
+	}
+	return leaf == NULL ? cmap_btree_iter(NULL, 0) : cmap_btree_iter(leaf, i - 1);
+}
+
+/**
+ * cmap_btree_find - the iterator at a given key.
+ * @map:	the target cmap object.
+ * @key:	the target key.
+ *
+ * It returns the end iterator if the key does not exist.
+ */
+static cmap_iter_t cmap_btree_find(cmap_t *map, const void *key) {
+	size_t i;
+	bool equal;
+	struct cmap_bnode *leaf = cmap_btree_seek(map, key, &i, &equal);
+	return equal ? cmap_btree_iter(leaf, i) : cmap_btree_iter(NULL, 0);
+}
+
+/**
+ * cmap_btree_lower_bound - the iterator at the first key not less than a given key.
+ * @map:	the target cmap object.
+ * @key:	the target key.
+ *
+ * It returns the end iterator if all keys are less than @key.
+ */
+static cmap_iter_t cmap_btree_lower_bound(cmap_t *map, const void *key) {
+	size_t i;
+	bool equal;
+	struct cmap_bnode *leaf = cmap_btree_seek(map, key, &i, &equal);
+	return cmap_btree_iter(leaf, i);
+}
+
+/**
+ * cmap_btree_upper_bound - the iterator at the first key larger than a given key.
+ * @map:	the target cmap object.
+ * @key:	the target key.
+ *
+ * It returns the end iterator if no key is larger than @key.
+ */
+static cmap_iter_t cmap_btree_upper_bound(cmap_t *map, const void *key) {
+	size_t i;
+	bool equal;
+	struct cmap_bnode *leaf = cmap_btree_seek(map, key, &i, &equal);
+	return cmap_btree_iter(leaf, i + equal);
+}
+
+/**
+ * cmap_btree_aggregate_range - not supported in the B-tree mode.
+ * cmap_btree_interval_overlaps - not supported in the B-tree mode.
+ *
+ * A B+ tree node keeps no summary or largest end, so both return false like a
+ * red-black tree which is not augmented or not in the interval mode.
+ */
+static bool cmap_btree_aggregate_range(cmap_t *map, const void *low, const void *high,
+				       void *summary) {
+	return false;
+}
+
+static bool cmap_btree_interval_overlaps(cmap_t *map, const void *low, const void *high,
+					 cmap_visit_t visit, void *arg) {
+	return false;
+}
+
+/**
+ * cmap_btree_size - the number of keys.
+ * @map:	the target cmap object.
+ */
+static size_t cmap_btree_size(cmap_t *map) {
+	return map->count;
+}
+
+/**
+ * cmap_btree_select - the iterator at the key with a given rank.
+ * @map:	the target cmap object.
+ * @rank:	the number of keys less than the wanted key.
+ *
+ * It skips whole leaves by their counts, which takes O(rank / CMAP_BTREE_MIN).
+ * It returns the end iterator if @rank is not less than the number of keys.
+ */
+static cmap_iter_t cmap_btree_select(cmap_t *map, size_t rank) {
+	if (rank >= map->count)
+		return cmap_btree_iter(NULL, 0);
+	struct cmap_bnode *leaf = cmap_bnode_first(map);
+	while (rank >= leaf->count) {
+		rank -= leaf->count;
+		leaf = leaf->next;
+	}
+	return cmap_btree_iter(leaf, rank);
+}
+
+/**
+ * cmap_btree_rank - the number of keys less than a given key.
+ * @map:	the target cmap object.
+ * @key:	the target key, which does not have to be in @map.
+ *
+ * The leaf of @key is found by a descent, then the keys of the previous leaves
+ * are counted by their counts.
+ */
+static size_t cmap_btree_rank(cmap_t *map, const void *key) {
+	size_t rank;
+	bool equal;
+	struct cmap_bnode *leaf = cmap_btree_seek(map, key, &rank, &equal);
+	if (leaf == NULL)
+		return 0;
+	for (leaf = leaf->prev; leaf != NULL; leaf = leaf->prev)
+		rank += leaf->count;
+	return rank;
+}
+
+/**
+ * cmap_btree_clear - erasing all keys while keeping the memory.
+ * @map:	the target cmap object.
+ *
+ * Like the red-black tree, the chunks of the pool are kept for the next fill cycle.
+ * Nothing is walked if both interfaces are borrowed.
+ */
+static void cmap_btree_clear(cmap_t *map) {
+	if (map->root != NIL &&
+	    !(map->key_interface.borrowed && map->val_interface.borrowed))
+		cmap_bnode_destroy(map, cmap_btree_root(map));
+	map->root = map->rightmost = NIL;
+	map->count = 0;
+	cmap_pool_reset(&map->pool);
+}
+
+/**
+ * cmap_btree_destroy - destructor of cmap in the B-tree mode.
+ * @map:	the target cmap object.
+ *
+ * The keys, values and separators are released, then the chunks of the pool
+ * holding all nodes are released at once.
+ */
+static void cmap_btree_destroy(cmap_t *map) {
+	cmap_btree_clear(map);
+	cmap_pool_destroy(&map->pool);
+}
@@ -0,0 +1,638 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include "cmap.h"
+#include "cmap_concurrent.h"
+#include "cmap_internal.h"
+#ifndef DEBUG
+#define DEBUG 1
+#endif
+
+/**
+ * C map concurrent -	cmap objects which can be manipulated by several threads.
+ *
+ * A cmap object has no synchronization, so the structures in this file wrap
+ * cmap objects with locks and provide the methods like cmap.
+ * cmap_optimistic takes no lock for searching; its readers validate their
+ * walks by a sequence counter instead.
+ */
+
+/* 
+ * Functions for cmap_concurrent
+ * 
+ * cmap_concurrent_alloc():	Allocation of a cmap_concurrent object.
+ * cmap_concurrent_search():	Searching a key and copying its value under the read lock.
+ * cmap_concurrent_insert():	Inserting a key and value under the write lock.
+ * cmap_concurrent_erase():	Erasing a key under the write lock.
+ * cmap_concurrent_destroy():	Destructor of cmap_concurrent.
+ *
+ * All details about the above functions are mentioned at their implementation places.
+ */
+void *cmap_concurrent_alloc(cmap_data_t *key_interface, cmap_data_t *val_interface);
+static bool cmap_concurrent_search(cmap_concurrent_t *cmap, const void *key, void *val);
+static void cmap_concurrent_insert(cmap_concurrent_t *cmap, const void *key, const void *val);
+static bool cmap_concurrent_erase(cmap_concurrent_t *cmap, const void *key);
+static void cmap_concurrent_destroy(cmap_concurrent_t *cmap);
+
+/* 
+ * Functions for cmap_sharded
+ * 
+ * cmap_sharded_alloc():	Allocation of a cmap_sharded object with given split keys.
+ * cmap_sharded_alloc_sampled():Allocation of a cmap_sharded object with sampled split keys.
+ * cmap_sharded_index():	Finding the shard of a key.
+ * cmap_sharded_search():	Searching a key and copying its value under the read lock of its shard.
+ * cmap_sharded_insert():	Inserting a key and value under the write lock of its shard.
+ * cmap_sharded_erase():	Erasing a key under the write lock of its shard.
+ * cmap_sharded_foreach():	Visiting all keys and values in ascending order, shard by shard.
+ * cmap_sharded_destroy():	Destructor of cmap_sharded.
+ *
+ * All details about the above functions are mentioned at their implementation places.
+ */
+void *cmap_sharded_alloc(cmap_data_t *key_interface, cmap_data_t *val_interface,
+			 size_t shards, const void *const *splits);
+void *cmap_sharded_alloc_sampled(cmap_data_t *key_interface, cmap_data_t *val_interface,
+				 size_t shards, const void *const *keys,
+				 const void *const *vals, size_t n);
+static size_t cmap_sharded_index(cmap_sharded_t *cmap, const void *key);
+static bool cmap_sharded_search(cmap_sharded_t *cmap, const void *key, void *val);
+static void cmap_sharded_insert(cmap_sharded_t *cmap, const void *key, const void *val);
+static bool cmap_sharded_erase(cmap_sharded_t *cmap, const void *key);
+static bool cmap_sharded_foreach(cmap_sharded_t *cmap, cmap_visit_t visit, void *arg);
+static void cmap_sharded_destroy(cmap_sharded_t *cmap);
+
+/* 
+ * Functions for cmap_optimistic
+ * 
+ * cmap_optimistic_alloc():	Allocation of a cmap_optimistic object.
+ * cmap_optimistic_register():	Registering the calling thread as a reader.
+ * cmap_optimistic_unregister():Unregistering a reader.
+ * cmap_optimistic_search():	Searching a key and copying its value without locks.
+ * cmap_optimistic_insert():	Inserting a key and value under the writer lock.
+ * cmap_optimistic_erase():	Erasing a key under the writer lock.
+ * cmap_optimistic_retire():	Deferring the release of a node unlinked by erase().
+ * cmap_optimistic_reclaim():	Releasing the retired nodes which no reader can access.
+ * cmap_optimistic_destroy():	Destructor of cmap_optimistic.
+ *
+ * All details about the above functions are mentioned at their implementation places.
+ */
+void *cmap_optimistic_alloc(cmap_data_t *key_interface, cmap_data_t *val_interface);
+static cmap_reader_t *cmap_optimistic_register(cmap_optimistic_t *cmap);
+static void cmap_optimistic_unregister(cmap_optimistic_t *cmap, cmap_reader_t *reader);
+static bool cmap_optimistic_search(cmap_optimistic_t *cmap, cmap_reader_t *reader,
+				   const void *key, void *val);
+static void cmap_optimistic_insert(cmap_optimistic_t *cmap, const void *key, const void *val);
+static bool cmap_optimistic_erase(cmap_optimistic_t *cmap, const void *key);
+static void cmap_optimistic_retire(cmap_t *map, cmap_node_t *node);
+static void cmap_optimistic_reclaim(cmap_optimistic_t *cmap);
+static void cmap_optimistic_destroy(cmap_optimistic_t *cmap);
+
+/**
+ * CMAP_OPTIMISTIC_RECLAIM - the number of retired nodes which makes a writer try to release them.
+ * CMAP_OPTIMISTIC_STEPS - the maximum number of nodes visited by one attempt of a search.
+ *
+ * A red-black tree with n nodes is at most 2 * log2(n + 1) high, so a walk longer
+ * than CMAP_OPTIMISTIC_STEPS can only be caused by concurrent rotations.
+ */
+#ifndef CMAP_OPTIMISTIC_RECLAIM
+#define CMAP_OPTIMISTIC_RECLAIM 64
+#endif
+#define CMAP_OPTIMISTIC_STEPS 128
+
+/**
+ * cmap_concurrent_alloc - allocation for a cmap_concurrent object.
+ * @key_interface:	an object of cmap_data type with defined implementation assigned by user for key.
+ * @val_interface:	an object of cmap_data type with defiend implementation assigned by user for value.
+ *
+ * It initializes a cmap object by cmap_init() and the lock in the allocated object.
+ */
+void *cmap_concurrent_alloc(cmap_data_t *key_interface, cmap_data_t *val_interface) {
+	cmap_concurrent_t cmap = {.map = cmap_init(key_interface, val_interface),
+				  .search = cmap_concurrent_search,
+				  .insert = cmap_concurrent_insert,
+				  .erase = cmap_concurrent_erase,
+				  .destroy = cmap_concurrent_destroy,
+				  .dealloc = free};
+	cmap_concurrent_t *alloc_cmap = malloc(sizeof(cmap_concurrent_t));
+	memcpy(alloc_cmap, &cmap, sizeof(cmap_concurrent_t));
+	pthread_rwlock_init(&alloc_cmap->lock, NULL);
+	return alloc_cmap;
+}
+
+/**
+ * cmap_concurrent_search - searching the value by the given key.
+ * @cmap:	the target cmap_concurrent object.
+ * @key:	the target key.
+ * @val:	the buffer receiving the value.
+ *
+ * The search() method of cmap writes nothing, so several threads hold the
+ * read lock and search at the same time. If the key is found, the value is
+ * copied into @val by copy() method of the val_interface before releasing
+ * the lock.
+ */
+static bool cmap_concurrent_search(cmap_concurrent_t *cmap, const void *key, void *val) {
+	cmap_t *map = &cmap->map;
+	pthread_rwlock_rdlock(&cmap->lock);
+	void *data = map->search(map, key);
+	if (data != NULL)
+		cmap_data_read(&map->val_interface, val, data);
+	pthread_rwlock_unlock(&cmap->lock);
+	return data != NULL;
+}
+
+/**
+ * cmap_concurrent_insert - inserting (or updating) the given key and value.
+ * @cmap:	the target cmap_concurrent object.
+ * @key:	the target key.
+ * @val:	the target value.
+ *
+ * It calls insert() method of the cmap object while holding the write lock.
+ */
+static void cmap_concurrent_insert(cmap_concurrent_t *cmap, const void *key, const void *val) {
+	cmap_t *map = &cmap->map;
+	pthread_rwlock_wrlock(&cmap->lock);
+	map->insert(map, key, val);
+	pthread_rwlock_unlock(&cmap->lock);
+}
+
+/**
+ * cmap_concurrent_erase - erasing the node with the given key.
+ * @cmap:	the target cmap_concurrent object.
+ * @key:	the target key.
+ *
+ * It calls erase() method of the cmap object while holding the write lock.
+ */
+static bool cmap_concurrent_erase(cmap_concurrent_t *cmap, const void *key) {
+	cmap_t *map = &cmap->map;
+	pthread_rwlock_wrlock(&cmap->lock);
+	bool erased = map->erase(map, key);
+	pthread_rwlock_unlock(&cmap->lock);
+	return erased;
+}
+
+/**
+ * cmap_concurrent_destroy - destructor of cmap_concurrent.
+ * @cmap:	the target cmap_concurrent object.
+ *
+ * No thread should use the object any longer, so it destroys the cmap object
+ * and the lock without locking.
+ */
+static void cmap_concurrent_destroy(cmap_concurrent_t *cmap) {
+	cmap->map.destroy(&cmap->map);
+	pthread_rwlock_destroy(&cmap->lock);
+}
+
+/**
+ * cmap_sharded_alloc - allocation for a cmap_sharded object.
+ * @key_interface:	an object of cmap_data type with defined implementation assigned by user for key.
+ * @val_interface:	an object of cmap_data type with defiend implementation assigned by user for value.
+ * @shards:		the number of shards.
+ * @splits:		@shards - 1 split keys in ascending order.
+ *
+ * The split keys are copied by the methods of @key_interface, and every shard
+ * is initialized by cmap_init() and its own lock. The shards are aligned to 64 bytes
+ * so that each of them starts a cache line.
+ */
+void *cmap_sharded_alloc(cmap_data_t *key_interface, cmap_data_t *val_interface,
+			 size_t shards, const void *const *splits) {
+	if (shards == 0)
+		return NULL;
+	for (size_t i = 1; i + 1 < shards; i++) {
+		if (key_interface->cmp(splits[i - 1], splits[i]) > 0)
+			return NULL;
+	}
+	void *shards_memory;
+	if (posix_memalign(&shards_memory, 64, sizeof(cmap_shard_t) * shards) != 0)
+		return NULL;
+
+	cmap_sharded_t cmap = {.shards_count = shards,
+			       .shards = shards_memory,
+			       .splits = malloc(sizeof(void *) * shards),
+			       .key_interface = *key_interface,
+			       .search = cmap_sharded_search,
+			       .insert = cmap_sharded_insert,
+			       .erase = cmap_sharded_erase,
+			       .foreach = cmap_sharded_foreach,
+			       .destroy = cmap_sharded_destroy,
+			       .dealloc = free};
+	for (size_t i = 0; i + 1 < shards; i++) {
+		if (key_interface->borrowed) {
+			cmap.splits[i] = (void *)splits[i];
+			continue;
+		}
+		size_t size = key_interface->data_size_get(splits[i]);
+		cmap.splits[i] = calloc(1, size);
+		key_interface->copy(cmap.splits[i], splits[i], size);
+	}
+	for (size_t i = 0; i < shards; i++) {
+		cmap_t map = cmap_init(key_interface, val_interface);
+		memcpy(&cmap.shards[i].map, &map, sizeof(cmap_t));
+		pthread_rwlock_init(&cmap.shards[i].lock, NULL);
+	}
+
+	cmap_sharded_t *alloc_cmap = malloc(sizeof(cmap_sharded_t));
+	memcpy(alloc_cmap, &cmap, sizeof(cmap_sharded_t));
+	return alloc_cmap;
+}
+
+/**
+ * cmap_sharded_alloc_sampled - allocation for a cmap_sharded object with sampled split keys.
+ * @key_interface:	an object of cmap_data type with defined implementation assigned by user for key.
+ * @val_interface:	an object of cmap_data type with defiend implementation assigned by user for value.
+ * @shards:		the number of shards.
+ * @keys:		the keys of the bulk load.
+ * @vals:		the values of the bulk load.
+ * @n:			the number of keys and values.
+ *
+ * At most 32 keys per shard are sampled evenly from @keys and sorted, then the
+ * quantiles of the sample become the split keys. If @keys is empty, there is
+ * nothing to sample and the object has only one shard.
+ * Finally, the bulk load is inserted into the object. It returns NULL if @shards
+ * is 0 or the object cannot be allocated.
+ */
+void *cmap_sharded_alloc_sampled(cmap_data_t *key_interface, cmap_data_t *val_interface,
+				 size_t shards, const void *const *keys,
+				 const void *const *vals, size_t n) {
+	if (shards == 0)
+		return NULL;
+	if (n == 0)
+		shards = 1;
+	size_t samples_count = shards * 32 < n ? shards * 32 : n;
+	const void **samples = calloc(samples_count + 1, sizeof(void *));
+	size_t *order = malloc(sizeof(size_t) * (samples_count + 1));
+	for (size_t i = 0; i < samples_count; i++)
+		samples[i] = keys[i * n / samples_count];
+	cmap_sort(samples, order, samples_count, key_interface->cmp);
+
+	const void **splits = calloc(shards, sizeof(void *));
+	for (size_t i = 0; i + 1 < shards; i++)
+		splits[i] = samples[order[(i + 1) * samples_count / shards]];
+	cmap_sharded_t *cmap =
+		cmap_sharded_alloc(key_interface, val_interface, shards, splits);
+	free(splits);
+	free(order);
+	free(samples);
+	if (cmap == NULL)
+		return NULL;
+
+	for (size_t i = 0; i < n; i++)
+		cmap->insert(cmap, keys[i], vals[i]);
+	return cmap;
+}
+
+/**
+ * cmap_sharded_index - finding the shard of a key.
+ * @cmap:	a cmap_sharded object.
+ * @key:	the target key.
+ *
+ * The index of the shard is the number of split keys which are not larger
+ * than @key, which is found by binary search.
+ */
+static size_t cmap_sharded_index(cmap_sharded_t *cmap, const void *key) {
+	size_t low = 0, high = cmap->shards_count - 1;
+	while (low < high) {
+		size_t mid = low + (high - low) / 2;
+		if (cmap->key_interface.cmp(cmap->splits[mid], key) <= 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	return low;
+}
+
+/**
+ * cmap_sharded_search - searching the value by the given key.
+ * @cmap:	the target cmap_sharded object.
+ * @key:	the target key.
+ * @val:	the buffer receiving the value.
+ *
+ * It holds the read lock of the shard of @key only, and copies the value
+ * into @val like cmap_concurrent_search().
+ */
+static bool cmap_sharded_search(cmap_sharded_t *cmap, const void *key, void *val) {
+	cmap_shard_t *shard = &cmap->shards[cmap_sharded_index(cmap, key)];
+	cmap_t *map = &shard->map;
+	pthread_rwlock_rdlock(&shard->lock);
+	void *data = map->search(map, key);
+	if (data != NULL)
+		cmap_data_read(&map->val_interface, val, data);
+	pthread_rwlock_unlock(&shard->lock);
+	return data != NULL;
+}
+
+/**
+ * cmap_sharded_insert - inserting (or updating) the given key and value.
+ * @cmap:	the target cmap_sharded object.
+ * @key:	the target key.
+ * @val:	the target value.
+ *
+ * It holds the write lock of the shard of @key only.
+ */
+static void cmap_sharded_insert(cmap_sharded_t *cmap, const void *key, const void *val) {
+	cmap_shard_t *shard = &cmap->shards[cmap_sharded_index(cmap, key)];
+	pthread_rwlock_wrlock(&shard->lock);
+	shard->map.insert(&shard->map, key, val);
+	pthread_rwlock_unlock(&shard->lock);
+}
+
+/**
+ * cmap_sharded_erase - erasing the node with the given key.
+ * @cmap:	the target cmap_sharded object.
+ * @key:	the target key.
+ *
+ * It holds the write lock of the shard of @key only.
+ */
+static bool cmap_sharded_erase(cmap_sharded_t *cmap, const void *key) {
+	cmap_shard_t *shard = &cmap->shards[cmap_sharded_index(cmap, key)];
+	pthread_rwlock_wrlock(&shard->lock);
+	bool erased = shard->map.erase(&shard->map, key);
+	pthread_rwlock_unlock(&shard->lock);
+	return erased;
+}
+
+/**
+ * cmap_sharded_foreach - visiting all keys and values in ascending order.
+ * @cmap:	the target cmap_sharded object.
+ * @visit:	the callback receiving a key, its value and @arg.
+ * @arg:	the argument passed to @visit.
+ *
+ * The shards are sorted by their key ranges, so visiting the shards in
+ * sequence by foreach() of cmap walks the keys in global order. The read
+ * lock of a shard is held while visiting it, so @visit must not modify
+ * the object.
+ */
+static bool cmap_sharded_foreach(cmap_sharded_t *cmap, cmap_visit_t visit, void *arg) {
+	for (size_t i = 0; i < cmap->shards_count; i++) {
+		cmap_shard_t *shard = &cmap->shards[i];
+		pthread_rwlock_rdlock(&shard->lock);
+		bool finished = shard->map.foreach(&shard->map, visit, arg);
+		pthread_rwlock_unlock(&shard->lock);
+		if (!finished)
+			return false;
+	}
+	return true;
+}
+
+/**
+ * cmap_sharded_destroy - destructor of cmap_sharded.
+ * @cmap:	the target cmap_sharded object.
+ *
+ * It destroys all shards and their locks, then releasing the split keys
+ * by the methods of the key_interface.
+ */
+static void cmap_sharded_destroy(cmap_sharded_t *cmap) {
+	for (size_t i = 0; i < cmap->shards_count; i++) {
+		cmap->shards[i].map.destroy(&cmap->shards[i].map);
+		pthread_rwlock_destroy(&cmap->shards[i].lock);
+	}
+	for (size_t i = 0; i + 1 < cmap->shards_count && !cmap->key_interface.borrowed; i++) {
+		if (cmap->key_interface.destroy)
+			cmap->key_interface.destroy(cmap->splits[i]);
+		cmap->key_interface.dealloc(cmap->splits[i]);
+	}
+	free(cmap->shards);
+	free(cmap->splits);
+	cmap->shards_count = 0;
+}
+
+/**
+ * cmap_optimistic_alloc - allocation for a cmap_optimistic object.
+ * @key_interface:	an object of cmap_data type with defined implementation assigned by user for key.
+ * @val_interface:	an object of cmap_data type with defiend implementation assigned by user for value.
+ *
+ * It initializes a cmap object by cmap_init() whose retire hook defers the release
+ * of erased nodes, and the writer lock. The global epoch starts from 1 because
+ * 0 in a reader slot means that the reader is not searching.
+ */
+void *cmap_optimistic_alloc(cmap_data_t *key_interface, cmap_data_t *val_interface) {
+	cmap_optimistic_t cmap = {.map = cmap_init(key_interface, val_interface),
+				  .seq = 0,
+				  .epoch = 1,
+				  .retired = NULL,
+				  .retired_count = 0,
+				  .retired_size = 0,
+				  .reader_register = cmap_optimistic_register,
+				  .reader_unregister = cmap_optimistic_unregister,
+				  .search = cmap_optimistic_search,
+				  .insert = cmap_optimistic_insert,
+				  .erase = cmap_optimistic_erase,
+				  .destroy = cmap_optimistic_destroy,
+				  .dealloc = free};
+	cmap.map.retire = cmap_optimistic_retire;
+	cmap_optimistic_t *alloc_cmap = malloc(sizeof(cmap_optimistic_t));
+	memcpy(alloc_cmap, &cmap, sizeof(cmap_optimistic_t));
+	pthread_mutex_init(&alloc_cmap->lock, NULL);
+	return alloc_cmap;
+}
+
+/**
+ * cmap_optimistic_register - registering the calling thread as a reader.
+ * @cmap:	the target cmap_optimistic object.
+ *
+ * A free slot is claimed by compare-and-swap, so readers can be registered
+ * while other threads are using the object. The slot is returned, or NULL
+ * if all slots are registered.
+ */
+static cmap_reader_t *cmap_optimistic_register(cmap_optimistic_t *cmap) {
+	for (size_t i = 0; i < CMAP_OPTIMISTIC_READERS; i++) {
+		int unused = 0;
+		if (__atomic_compare_exchange_n(&cmap->readers[i].used, &unused, 1, false,
+						__ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+			return &cmap->readers[i];
+	}
+	return NULL;
+}
+
+/**
+ * cmap_optimistic_unregister - unregistering a reader.
+ * @cmap:	the target cmap_optimistic object.
+ * @reader:	the slot returned by reader_register(), which is not searching.
+ */
+static void cmap_optimistic_unregister(cmap_optimistic_t *cmap, cmap_reader_t *reader) {
+	__atomic_store_n(&reader->used, 0, __ATOMIC_RELEASE);
+}
+
+/**
+ * cmap_optimistic_search - searching the value by the given key without locks.
+ * @cmap:	the target cmap_optimistic object.
+ * @reader:	the slot of the calling thread returned by reader_register().
+ * @key:	the target key.
+ * @val:	the buffer receiving the value.
+ *
+ * The reader publishes the global epoch in its slot before walking the tree,
+ * so no node it can reach is released until it leaves. The pointers of the tree
+ * are loaded with acquire, which pairs with CMAP_LINK() of the writer, so a new
+ * node is seen after its initialization. The walk is a guess:
+ * a writer may rotate or erase nodes meanwhile, so the sequence counter is
+ * checked before each comparsion and after copying the value, and the walk is
+ * restarted if a writer has been running. While a writer is running, the
+ * reader yields the processor rather than spinning. A walk which cannot be trusted
+ * never returns, and a walk lost in rotating nodes is cut off by
+ * CMAP_OPTIMISTIC_STEPS.
+ */
+static bool cmap_optimistic_search(cmap_optimistic_t *cmap, cmap_reader_t *reader,
+				   const void *key, void *val) {
+	cmap_t *map = &cmap->map;
+	bool found;
+
+	__atomic_store_n(&reader->epoch, __atomic_load_n(&cmap->epoch, __ATOMIC_RELAXED),
+			 __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+retry:
+	found = false;
+	unsigned long seq = __atomic_load_n(&cmap->seq, __ATOMIC_ACQUIRE);
+	if (seq & 1) {
+		sched_yield();
+		goto retry;
+	}
+	cmap_node_t *node = __atomic_load_n(&map->root, __ATOMIC_ACQUIRE);
+	for (int steps = 0; node != NIL; steps++) {
+		void *node_key = __atomic_load_n(&node->key, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (steps == CMAP_OPTIMISTIC_STEPS ||
+		    __atomic_load_n(&cmap->seq, __ATOMIC_RELAXED) != seq)
+			goto retry;
+		int cmp = map->key_interface.cmp(node_key, key);
+		if (cmp == 0) {
+			void *data = __atomic_load_n(&node->val, __ATOMIC_RELAXED);
+			cmap_data_read(&map->val_interface, val, data);
+			found = true;
+			break;
+		}
+		node = __atomic_load_n(cmp < 0 ? &node->right : &node->left, __ATOMIC_ACQUIRE);
+	}
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	if (__atomic_load_n(&cmap->seq, __ATOMIC_RELAXED) != seq)
+		goto retry;
+
+	__atomic_store_n(&reader->epoch, 0, __ATOMIC_RELEASE);
+	return found;
+}
+
+/**
+ * cmap_optimistic_insert - inserting (or updating) the given key and value.
+ * @cmap:	the target cmap_optimistic object.
+ * @key:	the target key.
+ * @val:	the target value.
+ *
+ * The sequence counter is odd while the tree is modified. The tree is descended
+ * once: a missing key is linked by cmap_node_link(). A reader may be copying the
+ * old value of an existed key, so it is not overwritten: the old node is replaced
+ * by a new node and retired by cmap_node_replace(). The tree is validated (DEBUG)
+ * before the sequence counter is even again, like erase() does.
+ */
+static void cmap_optimistic_insert(cmap_optimistic_t *cmap, const void *key, const void *val) {
+	cmap_t *map = &cmap->map;
+	pthread_mutex_lock(&cmap->lock);
+	__atomic_store_n(&cmap->seq, cmap->seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	cmap_node_t *parent = NIL, **link = &map->root;
+	int cmp = 1;
+	while (*link != NIL) {
+		parent = *link;
+		cmp = map->key_interface.cmp(parent->key, key);
+		if (cmp == 0)
+			break;
+		link = cmp < 0 ? &parent->right : &parent->left;
+	}
+	if (cmp == 0)
+		cmap_node_replace(map, parent, key, val);
+	else
+		cmap_node_link(map, parent, link, key, val, false);
+#if DEBUG == 1
+	cmap_validate(map);
+#endif
+	__atomic_store_n(&cmap->seq, cmap->seq + 1, __ATOMIC_RELEASE);
+	if (cmap->retired_count >= CMAP_OPTIMISTIC_RECLAIM)
+		cmap_optimistic_reclaim(cmap);
+	pthread_mutex_unlock(&cmap->lock);
+}
+
+/**
+ * cmap_optimistic_erase - erasing the node with the given key.
+ * @cmap:	the target cmap_optimistic object.
+ * @key:	the target key.
+ *
+ * The sequence counter is odd while the tree is modified, and the erased
+ * node is retired by the retire hook rather than released.
+ */
+static bool cmap_optimistic_erase(cmap_optimistic_t *cmap, const void *key) {
+	cmap_t *map = &cmap->map;
+	pthread_mutex_lock(&cmap->lock);
+	__atomic_store_n(&cmap->seq, cmap->seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	bool erased = map->erase(map, key);
+	__atomic_store_n(&cmap->seq, cmap->seq + 1, __ATOMIC_RELEASE);
+	if (cmap->retired_count >= CMAP_OPTIMISTIC_RECLAIM)
+		cmap_optimistic_reclaim(cmap);
+	pthread_mutex_unlock(&cmap->lock);
+	return erased;
+}
+
+/**
+ * cmap_optimistic_retire - the retire hook of the cmap object.
+ * @map:	the cmap object, which is the first member of a cmap_optimistic object.
+ * @node:	the node unlinked by erase().
+ *
+ * The node is kept with the current epoch, since the readers which started
+ * in this epoch (or earlier) may still walk through it.
+ */
+static void cmap_optimistic_retire(cmap_t *map, cmap_node_t *node) {
+	cmap_optimistic_t *cmap = (cmap_optimistic_t *)map;
+	if (cmap->retired_count == cmap->retired_size) {
+		cmap->retired_size = cmap->retired_size ? cmap->retired_size * 2
+							: CMAP_OPTIMISTIC_RECLAIM;
+		cmap->retired = realloc(cmap->retired,
+					sizeof(cmap_retired_t) * cmap->retired_size);
+	}
+	cmap->retired[cmap->retired_count].node = node;
+	cmap->retired[cmap->retired_count].epoch =
+		__atomic_load_n(&cmap->epoch, __ATOMIC_RELAXED);
+	cmap->retired_count++;
+}
+
+/**
+ * cmap_optimistic_reclaim - releasing the retired nodes which no reader can access.
+ * @cmap:	the target cmap_optimistic object, whose writer lock is held.
+ *
+ * The global epoch is advanced, so the readers starting from now on cannot reach
+ * any retired node. Then a retired node is released if it was retired before
+ * the oldest epoch published by a searching reader.
+ */
+static void cmap_optimistic_reclaim(cmap_optimistic_t *cmap) {
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	unsigned long oldest = __atomic_add_fetch(&cmap->epoch, 1, __ATOMIC_SEQ_CST);
+	for (size_t i = 0; i < CMAP_OPTIMISTIC_READERS; i++) {
+		unsigned long epoch = __atomic_load_n(&cmap->readers[i].epoch, __ATOMIC_ACQUIRE);
+		if (epoch != 0 && epoch < oldest)
+			oldest = epoch;
+	}
+
+	size_t kept = 0;
+	for (size_t i = 0; i < cmap->retired_count; i++) {
+		if (cmap->retired[i].epoch < oldest)
+			cmap_node_release(&cmap->map, cmap->retired[i].node);
+		else
+			cmap->retired[kept++] = cmap->retired[i];
+	}
+	cmap->retired_count = kept;
+}
+
+/**
+ * cmap_optimistic_destroy - destructor of cmap_optimistic.
+ * @cmap:	the target cmap_optimistic object.
+ *
+ * No thread should use the object any longer, so all retired nodes are
+ * released at once before destroying the cmap object and the lock.
+ */
+static void cmap_optimistic_destroy(cmap_optimistic_t *cmap) {
+	for (size_t i = 0; i < cmap->retired_count; i++)
+		cmap_node_release(&cmap->map, cmap->retired[i].node);
+	free(cmap->retired);
+	cmap->retired = NULL;
+	cmap->retired_count = cmap->retired_size = 0;
+	cmap->map.destroy(&cmap->map);
+	pthread_mutex_destroy(&cmap->lock);
+}
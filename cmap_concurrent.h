@@ -0,0 +1,226 @@
+#ifndef __C_MAP_CONCURRENT__
+#define __C_MAP_CONCURRENT__
+#include <stdbool.h>
+#include <pthread.h>
+#include "cmap.h"
+
+/*
+ * The types of pthread_rwlock_t and so on are defined by POSIX, so a program
+ * compiled with -std=c99 should define _POSIX_C_SOURCE (200809L, for example)
+ * before including any header.
+ */
+
+typedef struct cmap_concurrent cmap_concurrent_t;
+typedef struct cmap_shard cmap_shard_t;
+typedef struct cmap_sharded cmap_sharded_t;
+typedef struct cmap_reader cmap_reader_t;
+typedef struct cmap_retired cmap_retired_t;
+typedef struct cmap_optimistic cmap_optimistic_t;
+
+/**
+ * struct cmap_concurrent - a cmap protected by a reader/writer lock.
+ * @map:		the cmap object storing the data.
+ * @lock:		the reader/writer lock protecting @map.
+ * @search:		A function pointer to a built-in function to search a specific key. If the key
+ *			exists, its value is copied into the buffer given by user and returning true.
+ *			It holds the read lock, so searching is conducted by several threads at the same time.
+ * @insert:		A function pointer to a built-in function to insert or update a value for a certain key.
+ *			It holds the write lock.
+ * @erase:		A function pointer to a built-in function to erase a node with assigned key.
+ *			It holds the write lock.
+ * @destroy:		A function pointer to a built-in function to destroy the object.
+ * @dealloc:		A function pointer to free() providing a method to free an allocated object for user.
+ *
+ * The methods have the same usages as the methods of cmap, and they can be called by several
+ * threads at the same time.
+ * Because the value in @map may be updated or erased by another thread once the lock is released,
+ * search() does not return the pointer to the value like cmap but copies the value by copy() method
+ * of the val_interface into the buffer given by user while holding the lock. (The pointer to a
+ * borrowed value is written into the buffer instead.)
+ */
+struct cmap_concurrent {
+	cmap_t map;
+	pthread_rwlock_t lock;
+	bool (*const search)(cmap_concurrent_t *, const void *, void *);
+	void (*const insert)(cmap_concurrent_t *, const void *, const void *);
+	bool (*const erase)(cmap_concurrent_t *, const void *);
+	void (*const destroy)(cmap_concurrent_t *);
+	void (*const dealloc)(void *);
+};
+
+/**
+ * cmap_concurrent_alloc - A function returning a pointer to an allocated instance of cmap_concurrent.
+ * @key_interface:	An instance of cmap_data with valid function pointers for key in cmap.
+ * @val_interface:	An instance of cmap_data with valid function pointers for value in cmap.
+ *
+ * A lock cannot be copied after it is initialized, so an object of cmap_concurrent is
+ * always allocated by this function rather than being returned by value.
+ */
+void *cmap_concurrent_alloc(cmap_data_t *key_interface, cmap_data_t *val_interface);
+
+/**
+ * struct cmap_shard - a shard of cmap_sharded.
+ * @map:		the cmap object storing the keys in the range of the shard.
+ * @lock:		the reader/writer lock protecting @map.
+ * @pad:		padding rounding the size of a shard up to a multiple of 64 bytes. The shards are
+ *			allocated at a 64-byte boundary, so the locks of different shards are in
+ *			different cache lines.
+ */
+struct cmap_shard {
+	cmap_t map;
+	pthread_rwlock_t lock;
+	char pad[64 - (sizeof(cmap_t) + sizeof(pthread_rwlock_t)) % 64];
+};
+
+/**
+ * struct cmap_sharded - a cmap partitioned by key range into several independent shards.
+ * @shards_count:	the number of shards.
+ * @shards:		the shards sorted by their key ranges.
+ * @splits:		@shards_count - 1 split keys in ascending order. A key belongs to the shard i
+ *			if it is not less than splits[i - 1] and less than splits[i].
+ * @key_interface:	the key_interface of all shards, which is used to compare with @splits.
+ * @search:		A function pointer to a built-in function to search a specific key. If the key exists,
+ *			its value is copied into the buffer given by user and returning true.
+ * @insert:		A function pointer to a built-in function to insert or update a value for a certain key.
+ * @erase:		A function pointer to a built-in function to erase a node with assigned key.
+ * @foreach:		A function pointer to a built-in function to visit every key and value in ascending
+ *			order of keys, visiting the shards one by one.
+ * @destroy:		A function pointer to a built-in function to destroy the object.
+ * @dealloc:		A function pointer to free() providing a method to free an allocated object for user.
+ *
+ * Every shard has its own lock, so the operations on the keys in different shards are conducted
+ * by different threads at the same time. A point operation only locks the shard of its key.
+ * foreach() holds the read lock of one shard at a time, so it visits the keys in global order but
+ * it is not a snapshot of the whole object.
+ */
+struct cmap_sharded {
+	size_t shards_count;
+	cmap_shard_t *shards;
+	void **splits;
+	cmap_data_t key_interface;
+	bool (*const search)(cmap_sharded_t *, const void *, void *);
+	void (*const insert)(cmap_sharded_t *, const void *, const void *);
+	bool (*const erase)(cmap_sharded_t *, const void *);
+	bool (*const foreach)(cmap_sharded_t *, cmap_visit_t, void *);
+	void (*const destroy)(cmap_sharded_t *);
+	void (*const dealloc)(void *);
+};
+
+/**
+ * cmap_sharded_alloc - A function returning a pointer to an allocated instance of cmap_sharded.
+ * @key_interface:	An instance of cmap_data with valid function pointers for key in cmap.
+ * @val_interface:	An instance of cmap_data with valid function pointers for value in cmap.
+ * @shards:		The number of shards.
+ * @splits:		@shards - 1 split keys in ascending order, which are copied into the object
+ *			(or kept as they are for borrowed keys).
+ *
+ * It returns NULL if @splits are not in ascending order.
+ */
+void *cmap_sharded_alloc(cmap_data_t *key_interface, cmap_data_t *val_interface,
+			 size_t shards, const void *const *splits);
+
+/**
+ * cmap_sharded_alloc_sampled - A function returning a pointer to an allocated instance of cmap_sharded
+ *				whose split keys are sampled from a bulk load.
+ * @key_interface:	An instance of cmap_data with valid function pointers for key in cmap.
+ * @val_interface:	An instance of cmap_data with valid function pointers for value in cmap.
+ * @shards:		The number of shards.
+ * @keys:		The keys of the bulk load, in any order.
+ * @vals:		The values of the bulk load.
+ * @n:			The number of keys and values.
+ *
+ * The split keys are the quantiles of a sample of @keys, so the shards hold similar numbers
+ * of keys. Then all keys and values are inserted into the object.
+ */
+void *cmap_sharded_alloc_sampled(cmap_data_t *key_interface, cmap_data_t *val_interface,
+				 size_t shards, const void *const *keys,
+				 const void *const *vals, size_t n);
+
+/**
+ * CMAP_OPTIMISTIC_READERS - the maximum number of readers registered in a cmap_optimistic object.
+ */
+#ifndef CMAP_OPTIMISTIC_READERS
+#define CMAP_OPTIMISTIC_READERS 64
+#endif
+
+/**
+ * struct cmap_reader - a reader registered in a cmap_optimistic object.
+ * @epoch:		the epoch observed when the reader started its current search,
+ *			or 0 if the reader is not searching.
+ * @used:		whether the slot is registered by a reader.
+ * @pad:		padding keeping different readers in different cache lines.
+ *
+ * A reader only writes its own slot, so searching writes no memory shared with
+ * other threads.
+ */
+struct cmap_reader {
+	unsigned long epoch;
+	int used;
+	char pad[64 - sizeof(unsigned long) - sizeof(int)];
+};
+
+/**
+ * struct cmap_retired - a node unlinked by a writer, waiting to be released.
+ * @node:		the unlinked node.
+ * @epoch:		the global epoch when the node was unlinked.
+ */
+struct cmap_retired {
+	cmap_node_t *node;
+	unsigned long epoch;
+};
+
+/**
+ * struct cmap_optimistic - a cmap searched optimistically without locks.
+ * @map:		the cmap object storing the data.
+ * @lock:		the mutex serializing writers.
+ * @seq:		the sequence counter, which is odd while a writer is modifying @map.
+ * @epoch:		the global epoch for deferred reclamation.
+ * @readers:		the slots of the registered readers.
+ * @retired:		the nodes unlinked by writers which may still be accessed by readers.
+ * @retired_count:	the number of nodes in @retired.
+ * @retired_size:	the capacity of @retired.
+ * @reader_register:	A function pointer to a built-in function to register the calling thread as a reader.
+ *			It returns NULL if all CMAP_OPTIMISTIC_READERS slots are registered.
+ * @reader_unregister:	A function pointer to a built-in function to unregister a reader.
+ * @search:		A function pointer to a built-in function to search a specific key by a registered
+ *			reader. If the key exists, its value is copied into the buffer given by user and
+ *			returning true.
+ * @insert:		A function pointer to a built-in function to insert or update a value for a certain key.
+ * @erase:		A function pointer to a built-in function to erase a node with assigned key.
+ * @destroy:		A function pointer to a built-in function to destroy the object.
+ * @dealloc:		A function pointer to free() providing a method to free an allocated object for user.
+ *
+ * This is for the cmap searched much more often than modified. Writers are serialized by @lock
+ * and make @seq odd while they modify @map. Readers take no lock and write no shared memory: they
+ * walk the tree and retry if @seq has changed during the walk.
+ * A node unlinked by a writer is not released at once, because readers may still walk through it.
+ * It is kept in @retired with the epoch of the unlinking, and it is released once every searching
+ * reader has started after that epoch (epoch-based reclamation).
+ * An updated value is never rewritten in place; the node with the old value is retired and a new
+ * node is inserted, so a reader always copies a consistent value.
+ */
+struct cmap_optimistic {
+	cmap_t map;
+	pthread_mutex_t lock;
+	unsigned long seq;
+	unsigned long epoch;
+	cmap_reader_t readers[CMAP_OPTIMISTIC_READERS];
+	cmap_retired_t *retired;
+	size_t retired_count, retired_size;
+	cmap_reader_t *(*const reader_register)(cmap_optimistic_t *);
+	void (*const reader_unregister)(cmap_optimistic_t *, cmap_reader_t *);
+	bool (*const search)(cmap_optimistic_t *, cmap_reader_t *, const void *, void *);
+	void (*const insert)(cmap_optimistic_t *, const void *, const void *);
+	bool (*const erase)(cmap_optimistic_t *, const void *);
+	void (*const destroy)(cmap_optimistic_t *);
+	void (*const dealloc)(void *);
+};
+
+/**
+ * cmap_optimistic_alloc - A function returning a pointer to an allocated instance of cmap_optimistic.
+ * @key_interface:	An instance of cmap_data with valid function pointers for key in cmap.
+ * @val_interface:	An instance of cmap_data with valid function pointers for value in cmap.
+ */
+void *cmap_optimistic_alloc(cmap_data_t *key_interface, cmap_data_t *val_interface);
+
+#endif
@@ -0,0 +1,167 @@
+#ifndef __C_MAP_INTERNAL__
+#define __C_MAP_INTERNAL__
+#include <stdbool.h>
+#include <stdint.h>
+#include "cmap.h"
+#include "cmap_node_view.h"
+
+/*
+ * The definitions shared by the source files of cmap, which are not a part of
+ * the interface for user. (Only the layout of cmap_node_t is shown to cmap_define.h
+ * by cmap_node_view.h.)
+ */
+
+#define CMAP_BLACK ((uintptr_t)1)
+
+/**
+ * CMAP_ROUND_SIZE - rounding up a size to a multiple of the size of a pointer.
+ * CMAP_INLINE_SIZE - the size reserved in a node for an inline key or value.
+ *
+ * The inline storage of a key and a value follow struct cmap_node directly,
+ * and their sizes are rounded up so that every area stays pointer-aligned.
+ */
+#define CMAP_ROUND_SIZE(size)                                                  \
+	(((size) + sizeof(void *) - 1) & ~(sizeof(void *) - 1))
+#define CMAP_INLINE_SIZE(interface)                                            \
+	CMAP_ROUND_SIZE((interface)->borrowed ? 0 : (interface)->inline_size)
+
+/**
+ * For the theory of red-black tree, it has a special node called NIL
+ * (or NEEL) to represent the leaf, and it has no data and is black forever.
+ *
+ * cmap represents NIL by a NULL pointer rather than a shared sentinel node,
+ * so erasing nodes never writes any memory out of the cmap object and
+ * different cmap objects can be manipulated by different threads at the same time.
+ */
+#define NIL NULL
+
+/**
+ * CMAP_LINK - storing a child pointer (or the root) of a red-black tree.
+ * @link:	the pointer being stored, which is an lvalue.
+ * @node:	the node it points to, or NIL.
+ *
+ * The readers of cmap_optimistic walk the tree without locks while a writer links,
+ * erases and rotates nodes, so the pointers they follow are stored atomically, and
+ * the store releases the initialization of a new node to the readers, which load
+ * the pointers with acquire. It is still a plain store on x86.
+ */
+#define CMAP_LINK(link, node) __atomic_store_n(&(link), (node), __ATOMIC_RELEASE)
+
+/*
+ * Accessors for the parent and the color packed in struct cmap_node
+ *
+ * cmap_node_parent():		Getting the parent of a cmap node.
+ * cmap_node_set_parent():	Setting the parent of a cmap node and keeping its color.
+ * cmap_node_black():		Whether a cmap node is black. (NIL is always black.)
+ * cmap_node_set_black():	Setting the color of a cmap node and keeping its parent.
+ */
+static inline cmap_node_t *cmap_node_parent(const cmap_node_t *node) {
+	return (cmap_node_t *)(node->parent_color & ~CMAP_BLACK);
+}
+
+static inline void cmap_node_set_parent(cmap_node_t *node, cmap_node_t *parent) {
+	node->parent_color = (uintptr_t)parent | (node->parent_color & CMAP_BLACK);
+}
+
+static inline bool cmap_node_black(const cmap_node_t *node) {
+	return node == NULL || (node->parent_color & CMAP_BLACK);
+}
+
+static inline void cmap_node_set_black(cmap_node_t *node, bool black) {
+	node->parent_color = (node->parent_color & ~CMAP_BLACK) | black;
+}
+
+/**
+ * cmap_node_release - destroying the key and value of a node unlinked from a cmap object
+ *		       and returning the node to the pool of the cmap object.
+ * @map:	the cmap object owning the node.
+ * @node:	the node, which is no longer linked in @map.
+ */
+void cmap_node_release(cmap_t *map, cmap_node_t *node);
+
+/**
+ * cmap_node_replace - replacing a node by a new node with the same key and a new value.
+ * @map:	the cmap object owning @node.
+ * @node:	the node of @key, which is retired.
+ * @key:	the key of @node.
+ * @val:	the new value.
+ *
+ * It returns the new node. (See its implementation in cmap.c.)
+ */
+cmap_node_t *cmap_node_replace(cmap_t *map, cmap_node_t *node, const void *key,
+			       const void *val);
+
+/*
+ * The pool of a cmap object and the storage of its objects, which are shared by
+ * the red-black tree and the B-tree backend. (See their implementations in cmap.c.)
+ *
+ * cmap_pool_alloc():		Allocating the memory of a node from a pool.
+ * cmap_pool_free():		Returning the memory of a node to a pool.
+ * cmap_pool_reset():		Making all chunks of a pool unused for reuse.
+ * cmap_pool_destroy():		Releasing all chunks of a pool.
+ * cmap_data_store():		Storing a copy of an object into a node (inline or allocated).
+ * cmap_data_release():		Destroying and deallocating an object stored in a node.
+ * cmap_data_detach():		Taking an object out of a node without destroying it.
+ */
+void *cmap_pool_alloc(cmap_pool_t *pool);
+void cmap_pool_free(cmap_pool_t *pool, void *node);
+void cmap_pool_reset(cmap_pool_t *pool);
+void cmap_pool_destroy(cmap_pool_t *pool);
+void cmap_data_store(cmap_data_t *interface, void **data, void *inline_data,
+		     const void *src);
+void cmap_data_release(cmap_data_t *interface, void *data, void *inline_data);
+void *cmap_data_detach(cmap_data_t *interface, void *data, void *inline_data);
+
+/**
+ * cmap_btree_init3 - constructor of cmap in the B-tree mode.
+ * @key_interface:	the interface of keys.
+ * @val_interface:	the interface of values.
+ * @option:		the options of the cmap object, whose btree is set.
+ *
+ * cmap_init3() calls it, so a cmap object of the B-tree mode is used like any other.
+ */
+cmap_t cmap_btree_init3(cmap_data_t *key_interface, cmap_data_t *val_interface,
+			const cmap_option_t *option);
+
+/**
+ * cmap_validate - checking every property of the red-black tree of a cmap object.
+ * @map:	the target cmap object.
+ *
+ * It only exists if cmap.c is built with DEBUG == 1. (See its implementation in cmap.c.)
+ */
+void cmap_validate(cmap_t *map);
+
+/**
+ * cmap_stats - the memory usage of a cmap object, which is the stats() method
+ *		of both the red-black tree and the B-tree mode.
+ * @map:	the target cmap object.
+ * @stats:	receiving the memory usage.
+ */
+void cmap_stats(cmap_t *map, cmap_stats_t *stats);
+
+/**
+ * cmap_sort - sorting the indices of keys by a stable merge sort.
+ * @keys:	the array of pointers to keys.
+ * @order:	the array receiving the indices of @keys in ascending order of keys.
+ * @n:		the number of keys.
+ * @cmp:	the comparsion of keys.
+ */
+void cmap_sort(const void *const *keys, size_t *order, size_t n,
+	       int (*cmp)(const void *, const void *));
+
+/**
+ * cmap_data_read - copying an object stored in a cmap node into a buffer given by user.
+ * @interface:	the interface of the object.
+ * @buf:	the buffer given by user.
+ * @data:	the stored object.
+ *
+ * A borrowed object is never copied, so the pointer to it is written into @buf instead.
+ */
+static inline void cmap_data_read(const cmap_data_t *interface, void *buf, const void *data) {
+	if (interface->borrowed)
+		*(const void **)buf = data;
+	else
+		interface->copy(buf, data, interface->data_size_get(data));
+}
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef __C_MAP_NODE_VIEW__
+#define __C_MAP_NODE_VIEW__
+#include <stdbool.h>
+#include <stdint.h>
+#include "cmap.h"
+
+/*
+ * The layout of a cmap node and the ends of the insertion and the erasure, which are
+ * all that the type-specialized cmaps of cmap_define.h need to walk the tree inline.
+ * The rest of the definitions shared by the source files of cmap (the pool, the
+ * storage of objects, the accessors of the colors, ...) stays in cmap_internal.h,
+ * which is not installed for user.
+ */
+
+/**
+ * struct cmap_node - the information of a node used by cmap.
+ * @parent_color:	pointer to parent of the node, and its lowest bit is the
+ *			color of the node. (set: black, clear: red)
+ * @left:		pointer to left subtree of the node.
+ * @right:		pointer to right subtree of the node.
+ * @key:		the data of the key of the node.
+ * @val:		the data of the value of the node.
+ *
+ * A simple definition of a cmap node to imitate <map> container in C++.
+ *
+ * A node only keeps the pointers to its data. The methods of the key and the value
+ * (cmp(), copy(), destroy(), ...) are the same for every node of a cmap object, so
+ * they are reached through key_interface and val_interface of the cmap object rather
+ * than being stored in every node, which keeps a node within a single cache line.
+ * Nodes are at least pointer-aligned, so the lowest bit of a parent pointer is always
+ * zero and can hold the color. A missing child is a NULL pointer.
+ */
+struct cmap_node {
+	uintptr_t parent_color;
+	cmap_node_t *left, *right;
+	void *key, *val;
+};
+
+/*
+ * The ends of the insertion and the erasure of the red-black tree, which are shared
+ * by the type-specialized cmaps of cmap_define.h. (See their implementations in cmap.c.)
+ *
+ * cmap_node_link():		Linking a new node at a missing child of a node.
+ * cmap_node_erase():		Erasing a given node from a cmap object.
+ */
+cmap_node_t *cmap_node_link(cmap_t *map, cmap_node_t *parent, cmap_node_t **link,
+			    const void *key, const void *val, bool move);
+void cmap_node_erase(cmap_t *map, cmap_node_t *node);
+
+#endif
@@ -0,0 +1,90 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cmap.h"
+
+#define KEYS 1000
+
+int int_cmp(const void *d1, const void *d2) {
+	const int *int1 = d1, *int2 = d2;
+	return (*int1 > *int2) - (*int1 < *int2);
+}
+
+size_t int_size_get(const void *d1) {
+	return sizeof(int);
+}
+
+/*
+ * Test the iterators of the cmap.
+ * The even keys in [0, 2 * KEYS) are inserted in a shuffled order, then the
+ * map is walked forwards and backwards, and lower_bound(), upper_bound() and
+ * find() are checked for every key in [-1, 2 * KEYS].
+ */
+int main(void) {
+	cmap_data_t key_interface = CREATE_INTERFACE(int_cmp, int_size_get);
+	cmap_data_t val_interface = CREATE_INTERFACE(NULL, int_size_get);
+	cmap_t map = cmap_init(&key_interface, &val_interface);
+	int failed = 0;
+
+	if (map.begin(&map).node != map.end(&map).node ||
+	    map.prev(&map, map.end(&map)).node != NULL) {
+		fprintf(stderr, "Wrong iterators of the empty map\n");
+		failed = 1;
+	}
+
+	for (int i = 0; i < KEYS; i++) {
+		int key = (i * 7919 % KEYS) * 2, val = -key;
+		map.insert(&map, &key, &val);
+	}
+
+	printf("Walking forwards...\n");
+	int expected = 0;
+	for (cmap_iter_t it = map.begin(&map); it.node != NULL; it = map.next(&map, it)) {
+		if (*(const int *)it.key != expected || *(int *)it.val != -expected)
+			failed = 1;
+		expected += 2;
+	}
+	if (expected != 2 * KEYS)
+		failed = 1;
+
+	printf("Walking backwards...\n");
+	for (cmap_iter_t it = map.prev(&map, map.end(&map)); it.node != NULL;
+	     it = map.prev(&map, it)) {
+		expected -= 2;
+		if (*(const int *)it.key != expected)
+			failed = 1;
+	}
+	if (expected != 0)
+		failed = 1;
+
+	printf("Searching bounds...\n");
+	for (int key = -1; key <= 2 * KEYS; key++) {
+		cmap_iter_t lower = map.lower_bound(&map, &key);
+		cmap_iter_t upper = map.upper_bound(&map, &key);
+		cmap_iter_t found = map.find(&map, &key);
+		int lower_key = key < 0 ? 0 : (key + 1) / 2 * 2;
+		int upper_key = key < 0 ? 0 : key / 2 * 2 + 2;
+		if ((lower_key < 2 * KEYS ? *(const int *)lower.key != lower_key : lower.node != NULL) ||
+		    (upper_key < 2 * KEYS ? *(const int *)upper.key != upper_key : upper.node != NULL) ||
+		    ((key >= 0 && key % 2 == 0 && key < 2 * KEYS) ? found.node != lower.node
+								  : found.node != NULL)) {
+			fprintf(stderr, "Wrong bounds of key %d\n", key);
+			failed = 1;
+		}
+	}
+
+	printf("Scanning a range...\n");
+	int low = 100, high = 200, count = 0;
+	for (cmap_iter_t it = map.lower_bound(&map, &low), stop = map.upper_bound(&map, &high);
+	     it.node != stop.node; it = map.next(&map, it))
+		count++;
+	printf("%d keys in [%d, %d]\n", count, low, high);
+	if (count != 51)
+		failed = 1;
+
+	map.destroy(&map);
+	if (failed)
+		return 1;
+	printf("Finish\n");
+	return 0;
+}
@@ -0,0 +1,94 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cmap.h"
+
+#define KEYS 2000
+
+int int_cmp(const void *d1, const void *d2) {
+	const int *int1 = d1, *int2 = d2;
+	return (*int1 > *int2) - (*int1 < *int2);
+}
+
+size_t int_size_get(const void *d1) {
+	return sizeof(int);
+}
+
+// For testing.
+bool exists[KEYS];
+
+size_t expected_count(int low, int high) {
+	size_t count = 0;
+	for (int key = low < 0 ? 0 : low; key < high && key < KEYS; key++)
+		count += exists[key];
+	return count;
+}
+
+/*
+ * Test the range operations of the cmap.
+ * Random ranges are counted and erased, and the results are compared with
+ * an array recording which keys exist. Some keys are inserted again after
+ * each erasion, so the tree is split and joined in different shapes.
+ */
+int main(void) {
+	cmap_data_t key_interface = CREATE_INTERFACE(int_cmp, int_size_get);
+	cmap_data_t val_interface =
+		CREATE_INLINE_INTERFACE(NULL, int_size_get, sizeof(int));
+	cmap_t map = cmap_init(&key_interface, &val_interface);
+	int failed = 0;
+	size_t erased = 0;
+
+	for (int key = 0; key < KEYS; key++) {
+		map.insert(&map, &key, &key);
+		exists[key] = true;
+	}
+
+	printf("Erasing ranges...\n");
+	srand(1);
+	for (int round = 0; round < 200; round++) {
+		int low = rand() % (KEYS + 20) - 10;
+		int high = low + rand() % 100;
+		size_t expected = expected_count(low, high);
+		if (map.count_range(&map, &low, &high) != expected) {
+			fprintf(stderr, "Wrong count of [%d, %d)\n", low, high);
+			failed = 1;
+		}
+		if (map.erase_range(&map, &low, &high) != expected) {
+			fprintf(stderr, "Wrong erasion of [%d, %d)\n", low, high);
+			failed = 1;
+		}
+		erased += expected;
+		for (int key = low < 0 ? 0 : low; key < high && key < KEYS; key++)
+			exists[key] = false;
+
+		for (int i = 0; i < 10; i++) {
+			int key = rand() % KEYS;
+			if (!exists[key]) {
+				map.insert(&map, &key, &key);
+				exists[key] = true;
+			}
+		}
+	}
+	printf("Erased %zu keys\n", erased);
+
+	printf("Searching...\n");
+	for (int key = 0; key < KEYS; key++) {
+		int *val = map.search(&map, &key);
+		if ((val != NULL) != exists[key] || (val && *val != key)) {
+			fprintf(stderr, "Wrong result of key %d\n", key);
+			failed = 1;
+		}
+	}
+	int low = 0, high = KEYS;
+	if (map.erase_range(&map, &low, &high) != expected_count(low, high) ||
+	    map.begin(&map).node != NULL) {
+		fprintf(stderr, "Wrong erasion of all keys\n");
+		failed = 1;
+	}
+
+	map.destroy(&map);
+	if (failed)
+		return 1;
+	printf("Finish\n");
+	return 0;
+}
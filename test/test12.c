@@ -0,0 +1,82 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cmap.h"
+
+#define KEYS 5000
+
+int int_cmp(const void *d1, const void *d2) {
+	const int *int1 = d1, *int2 = d2;
+	return (*int1 > *int2) - (*int1 < *int2);
+}
+
+size_t int_size_get(const void *d1) {
+	return sizeof(int);
+}
+
+// For testing.
+int numbers[KEYS];
+const void *keys[KEYS], *vals[KEYS];
+
+/*
+ * Test building a cmap from sorted keys.
+ * Maps of every size up to 100 and some larger ones are built from the sorted
+ * keys 0, 2, 4, ..., then searched and modified. Unsorted keys, duplicated
+ * keys and a non-empty map must be rejected.
+ */
+int main(void) {
+	cmap_data_t key_interface =
+		CREATE_INLINE_INTERFACE(int_cmp, int_size_get, sizeof(int));
+	cmap_data_t val_interface = CREATE_INTERFACE(NULL, int_size_get);
+	int failed = 0;
+
+	for (int i = 0; i < KEYS; i++) {
+		numbers[i] = i * 2;
+		keys[i] = vals[i] = &numbers[i];
+	}
+
+	printf("Building...\n");
+	int maps = 0;
+	for (int n = 0; n <= KEYS; n = n < 100 ? n + 1 : n * 2) {
+		cmap_t map = cmap_init(&key_interface, &val_interface);
+		if (!map.build_sorted(&map, keys, vals, n)) {
+			fprintf(stderr, "Failed to build %d keys\n", n);
+			failed = 1;
+		}
+		for (int key = -1; key <= 2 * n; key++) {
+			int *val = map.search(&map, &key);
+			bool expected = key >= 0 && key % 2 == 0 && key < 2 * n;
+			if ((val != NULL) != expected || (val && *val != key)) {
+				fprintf(stderr, "Wrong result of key %d in %d keys\n", key, n);
+				failed = 1;
+			}
+		}
+		for (int key = 1; key < 2 * n; key += 4)
+			map.insert(&map, &key, &key);
+		for (int key = 0; key < 2 * n; key += 6)
+			map.erase(&map, &key);
+		if (n > 0 && map.build_sorted(&map, keys, vals, n)) {
+			fprintf(stderr, "Built a non-empty map\n");
+			failed = 1;
+		}
+		map.destroy(&map);
+		maps++;
+	}
+	printf("Built %d maps\n", maps);
+
+	printf("Rejecting...\n");
+	cmap_t map = cmap_init(&key_interface, &val_interface);
+	const void *unsorted[] = {&numbers[0], &numbers[2], &numbers[1]};
+	const void *duplicated[] = {&numbers[0], &numbers[1], &numbers[1]};
+	if (map.build_sorted(&map, unsorted, unsorted, 3) ||
+	    map.build_sorted(&map, duplicated, duplicated, 3) || map.root != NULL) {
+		fprintf(stderr, "Built from wrong keys\n");
+		failed = 1;
+	}
+	map.destroy(&map);
+
+	if (failed)
+		return 1;
+	printf("Finish\n");
+	return 0;
+}
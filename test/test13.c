@@ -0,0 +1,72 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cmap.h"
+
+#define KEYS 3000
+#define BATCH 500
+
+int int_cmp(const void *d1, const void *d2) {
+	const int *int1 = d1, *int2 = d2;
+	return (*int1 > *int2) - (*int1 < *int2);
+}
+
+size_t int_size_get(const void *d1) {
+	return sizeof(int);
+}
+
+// For testing.
+int batch_keys[BATCH], batch_vals[BATCH];
+const void *keys[BATCH], *vals[BATCH];
+
+/*
+ * Test the batched insertion of the cmap.
+ * Random batches (with duplicated keys) are inserted by insert_batch() into
+ * a map and key by key into another map, then both maps must have the same
+ * keys and values in the same order.
+ */
+int main(void) {
+	cmap_data_t key_interface =
+		CREATE_INLINE_INTERFACE(int_cmp, int_size_get, sizeof(int));
+	cmap_data_t val_interface = CREATE_INTERFACE(NULL, int_size_get);
+	cmap_t map = cmap_init(&key_interface, &val_interface);
+	cmap_t expected_map = cmap_init(&key_interface, &val_interface);
+	int failed = 0;
+
+	printf("Inserting batches...\n");
+	srand(1);
+	for (int round = 0; round < 20; round++) {
+		int n = rand() % BATCH;
+		for (int i = 0; i < n; i++) {
+			batch_keys[i] = rand() % KEYS;
+			batch_vals[i] = round * BATCH + i;
+			keys[i] = &batch_keys[i];
+			vals[i] = &batch_vals[i];
+			expected_map.insert(&expected_map, keys[i], vals[i]);
+		}
+		map.insert_batch(&map, keys, vals, n);
+	}
+
+	printf("Comparing...\n");
+	cmap_iter_t it = map.begin(&map), expected = expected_map.begin(&expected_map);
+	int count = 0;
+	for (; it.node != NULL && expected.node != NULL;
+	     it = map.next(&map, it), expected = expected_map.next(&expected_map, expected)) {
+		if (*(const int *)it.key != *(const int *)expected.key ||
+		    *(int *)it.val != *(int *)expected.val) {
+			fprintf(stderr, "Wrong key %d\n", *(const int *)it.key);
+			failed = 1;
+		}
+		count++;
+	}
+	if (it.node != NULL || expected.node != NULL)
+		failed = 1;
+	printf("Compared %d keys\n", count);
+
+	map.destroy(&map);
+	expected_map.destroy(&expected_map);
+	if (failed)
+		return 1;
+	printf("Finish\n");
+	return 0;
+}
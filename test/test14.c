@@ -0,0 +1,74 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cmap.h"
+
+#define KEYS 2000
+
+int int_cmp(const void *d1, const void *d2) {
+	const int *int1 = d1, *int2 = d2;
+	return (*int1 > *int2) - (*int1 < *int2);
+}
+
+size_t int_size_get(const void *d1) {
+	return sizeof(int);
+}
+
+/*
+ * Test the hinted insertion and the cached rightmost node of the cmap.
+ * Increasing keys are appended, then the keys between them are inserted
+ * with right, wrong and end hints. The rightmost node is checked by the
+ * validation of the cmap after every insertion and erasion.
+ */
+int main(void) {
+	cmap_data_t key_interface =
+		CREATE_INLINE_INTERFACE(int_cmp, int_size_get, sizeof(int));
+	cmap_data_t val_interface = CREATE_INTERFACE(NULL, int_size_get);
+	cmap_t map = cmap_init(&key_interface, &val_interface);
+	int failed = 0;
+
+	printf("Appending...\n");
+	for (int key = 0; key < KEYS; key += 4)
+		map.insert(&map, &key, &key);
+
+	printf("Inserting with hints...\n");
+	for (int key = 1; key < KEYS; key += 4) {
+		int next = key + 3;
+		cmap_iter_t hint = map.find(&map, &next);
+		cmap_iter_t it = map.insert_hint(&map, hint, &key, &key);
+		if (*(const int *)it.key != key)
+			failed = 1;
+	}
+	for (int key = 2; key < KEYS; key += 4) {
+		int wrong = KEYS / 2;
+		cmap_iter_t it = map.insert_hint(&map, map.find(&map, &wrong), &key, &key);
+		if (*(const int *)it.key != key)
+			failed = 1;
+	}
+	for (int key = 3; key < KEYS; key += 4)
+		map.insert_hint(&map, map.end(&map), &key, &key);
+	for (int key = KEYS; key < 2 * KEYS; key++)
+		map.insert_hint(&map, map.end(&map), &key, &key);
+
+	printf("Erasing...\n");
+	for (int key = 2 * KEYS - 1; key >= KEYS; key -= 2)
+		map.erase(&map, &key);
+	int low = KEYS - 100, high = 2 * KEYS;
+	map.erase_range(&map, &low, &high);
+
+	int expected = 0;
+	for (cmap_iter_t it = map.begin(&map); it.node != NULL; it = map.next(&map, it)) {
+		if (*(const int *)it.key != expected || *(int *)it.val != expected)
+			failed = 1;
+		expected++;
+	}
+	printf("%d keys\n", expected);
+	if (expected != KEYS - 100)
+		failed = 1;
+
+	map.destroy(&map);
+	if (failed)
+		return 1;
+	printf("Finish\n");
+	return 0;
+}
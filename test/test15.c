@@ -0,0 +1,123 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cmap.h"
+
+#define KEYS 3000
+#define ROUNDS 4
+
+int int_cmp(const void *d1, const void *d2) {
+	const int *int1 = d1, *int2 = d2;
+	return (*int1 > *int2) - (*int1 < *int2);
+}
+
+size_t int_size_get(const void *d1) {
+	return sizeof(int);
+}
+
+/*
+ * Check select() and rank() of the map against the sorted keys in @keys,
+ * then check count_range() for a few ranges.
+ */
+int check(cmap_t *map, const int *keys, size_t n) {
+	if (map->size(map) != n)
+		return 1;
+	for (size_t i = 0; i < n; i++) {
+		cmap_iter_t it = map->select(map, i);
+		if (it.node == NULL || *(const int *)it.key != keys[i])
+			return 1;
+		if (map->rank(map, &keys[i]) != i)
+			return 1;
+		int next = keys[i] + 1;
+		if (map->rank(map, &next) != i + 1)
+			return 1;
+	}
+	if (map->select(map, n).node != NULL)
+		return 1;
+	for (size_t i = 0; i + 7 < n; i += 7) {
+		if (map->count_range(map, &keys[i], &keys[i + 7]) != 7)
+			return 1;
+		if (map->count_range(map, &keys[i + 7], &keys[i]) != 0)
+			return 1;
+	}
+	return 0;
+}
+
+/* Collect the keys of the map in ascending order. */
+size_t collect(cmap_t *map, int *keys) {
+	size_t n = 0;
+	for (cmap_iter_t it = map->begin(map); it.node != NULL; it = map->next(map, it))
+		keys[n++] = *(const int *)it.key;
+	return n;
+}
+
+/*
+ * Test the order statistics mode of the cmap.
+ * Random keys are inserted and erased in a map of the mode and a plain map,
+ * and their select(), rank() and count_range() must agree with the keys
+ * walked by the iterators. The validation of the cmap checks the subtree
+ * sizes after every insertion and erasion.
+ */
+int main(void) {
+	cmap_data_t key_interface =
+		CREATE_INLINE_INTERFACE(int_cmp, int_size_get, sizeof(int));
+	cmap_data_t val_interface = CREATE_INTERFACE(NULL, int_size_get);
+	cmap_option_t option = {.order_statistics = true};
+	cmap_t map = cmap_init3(&key_interface, &val_interface, &option);
+	cmap_t plain = cmap_init(&key_interface, &val_interface);
+	int *keys = malloc(sizeof(int) * KEYS * 4);
+	int failed = 0;
+	srand(15);
+
+	for (int round = 0; round < ROUNDS; round++) {
+		printf("Round %d: inserting...\n", round);
+		for (int i = 0; i < KEYS; i++) {
+			int key = rand() % (KEYS * 4);
+			map.insert(&map, &key, &i);
+			plain.insert(&plain, &key, &i);
+		}
+		for (int key = KEYS * 4; key < KEYS * 4 + 100; key++) {
+			map.insert(&map, &key, &key);
+			plain.insert(&plain, &key, &key);
+		}
+		size_t n = collect(&plain, keys);
+		failed |= check(&map, keys, n) | check(&plain, keys, n);
+
+		printf("Round %d: erasing...\n", round);
+		for (int i = 0; i < KEYS / 2; i++) {
+			int key = rand() % (KEYS * 4);
+			map.erase(&map, &key);
+			plain.erase(&plain, &key);
+		}
+		int low = rand() % (KEYS * 4), high = low + rand() % KEYS;
+		if (map.erase_range(&map, &low, &high) != plain.erase_range(&plain, &low, &high))
+			failed = 1;
+		low = KEYS * 4 + 50;
+		map.erase_range(&map, &low, &high);
+		plain.erase_range(&plain, &low, &high);
+		n = collect(&plain, keys);
+		failed |= check(&map, keys, n) | check(&plain, keys, n);
+		printf("%zu keys\n", n);
+	}
+
+	printf("Building...\n");
+	size_t n = collect(&plain, keys);
+	const void **key_ptrs = malloc(sizeof(void *) * n);
+	for (size_t i = 0; i < n; i++)
+		key_ptrs[i] = &keys[i];
+	map.destroy(&map);
+	if (map.size(&map) != 0 || map.select(&map, 0).node != NULL)
+		failed = 1;
+	if (!map.build_sorted(&map, key_ptrs, key_ptrs, n))
+		failed = 1;
+	failed |= check(&map, keys, n);
+	free(key_ptrs);
+
+	map.destroy(&map);
+	plain.destroy(&plain);
+	free(keys);
+	if (failed)
+		return 1;
+	printf("Finish\n");
+	return 0;
+}
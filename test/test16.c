@@ -0,0 +1,149 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cmap.h"
+
+#define KEYS 4000
+#define RANGES 300
+
+typedef struct {
+	long sum;
+	long max;
+	long count;
+} summary_t;
+
+int int_cmp(const void *d1, const void *d2) {
+	const int *int1 = d1, *int2 = d2;
+	return (*int1 > *int2) - (*int1 < *int2);
+}
+
+size_t int_size_get(const void *d1) {
+	return sizeof(int);
+}
+
+void summary_lift(void *summary, const void *key, const void *val) {
+	summary_t *s = summary;
+	s->sum = s->max = *(const int *)val;
+	s->count = 1;
+}
+
+void summary_combine(void *summary, const void *left, const void *right) {
+	const summary_t *l = left, *r = right;
+	summary_t s = {.sum = l->sum + r->sum,
+		       .max = l->max > r->max ? l->max : r->max,
+		       .count = l->count + r->count};
+	*(summary_t *)summary = s;
+}
+
+/*
+ * Compare aggregate_range() with the summary computed by walking the keys
+ * for random ranges.
+ */
+int check(cmap_t *map) {
+	for (int i = 0; i < RANGES; i++) {
+		int low = rand() % (KEYS * 2), high = low + rand() % (KEYS / 2);
+		summary_t expected = {0, -1, 0}, result = {0, -1, 0};
+		cmap_iter_t stop = map->lower_bound(map, &high);
+		for (cmap_iter_t it = map->lower_bound(map, &low); it.node != stop.node;
+		     it = map->next(map, it)) {
+			int val = *(int *)it.val;
+			expected.sum += val;
+			expected.max = val > expected.max ? val : expected.max;
+			expected.count++;
+		}
+		bool found = map->aggregate_range(map, &low, &high, &result);
+		if (found != (expected.count > 0) || memcmp(&result, &expected, sizeof(summary_t)))
+			return 1;
+	}
+	return 0;
+}
+
+/*
+ * Test the augmentation of the cmap.
+ * The summary (sum, maximum and count of the values) of random ranges must be the
+ * same as the one computed by walking the keys after insertions, updates, batches,
+ * hinted insertions, erasions and range erasions. It runs twice, with and without
+ * the order statistics mode, which moves the summaries in the nodes.
+ */
+int main(void) {
+	cmap_data_t key_interface =
+		CREATE_INLINE_INTERFACE(int_cmp, int_size_get, sizeof(int));
+	cmap_data_t val_interface =
+		CREATE_INLINE_INTERFACE(NULL, int_size_get, sizeof(int));
+	int failed = 0;
+	srand(16);
+
+	for (int mode = 0; mode < 2; mode++) {
+		cmap_option_t option = {.order_statistics = mode,
+					.aug_size = sizeof(summary_t),
+					.aug_lift = summary_lift,
+					.aug_combine = summary_combine};
+		cmap_t map = cmap_init3(&key_interface, &val_interface, &option);
+
+		printf("Mode %d: inserting...\n", mode);
+		for (int i = 0; i < KEYS; i++) {
+			int key = rand() % (KEYS * 2), val = rand() % 1000;
+			map.insert(&map, &key, &val);
+		}
+		failed |= check(&map);
+
+		printf("Mode %d: updating...\n", mode);
+		for (int i = 0; i < KEYS / 4; i++) {
+			cmap_iter_t it = map.select(&map, rand() % map.size(&map));
+			int val = rand() % 2000;
+			map.insert(&map, it.key, &val);
+		}
+		int keys[64], vals[64];
+		const void *key_ptrs[64], *val_ptrs[64];
+		for (int i = 0; i < 64; i++) {
+			keys[i] = rand() % (KEYS * 2);
+			vals[i] = rand() % 3000;
+			key_ptrs[i] = &keys[i];
+			val_ptrs[i] = &vals[i];
+		}
+		map.insert_batch(&map, key_ptrs, val_ptrs, 64);
+		for (int key = KEYS * 2; key < KEYS * 2 + 100; key++) {
+			int val = key % 500;
+			map.insert_hint(&map, map.end(&map), &key, &val);
+		}
+		failed |= check(&map);
+
+		printf("Mode %d: erasing...\n", mode);
+		for (int i = 0; i < KEYS / 2; i++) {
+			int key = rand() % (KEYS * 2);
+			map.erase(&map, &key);
+		}
+		for (int i = 0; i < 4; i++) {
+			int low = rand() % (KEYS * 2), high = low + rand() % 200;
+			map.erase_range(&map, &low, &high);
+		}
+		failed |= check(&map);
+
+		int low = 0, high = KEYS * 3;
+		summary_t all;
+		if (!map.aggregate_range(&map, &low, &high, &all) || all.count != map.size(&map))
+			failed = 1;
+		printf("%ld keys, sum %ld, max %ld\n", all.count, all.sum, all.max);
+		map.destroy(&map);
+		if (map.aggregate_range(&map, &low, &high, &all))
+			failed = 1;
+
+		printf("Mode %d: building...\n", mode);
+		int *sorted = malloc(sizeof(int) * KEYS);
+		const void **sorted_ptrs = malloc(sizeof(void *) * KEYS);
+		for (int i = 0; i < KEYS; i++) {
+			sorted[i] = i * 2;
+			sorted_ptrs[i] = &sorted[i];
+		}
+		map.build_sorted(&map, sorted_ptrs, sorted_ptrs, KEYS);
+		failed |= check(&map);
+		map.destroy(&map);
+		free(sorted_ptrs);
+		free(sorted);
+	}
+
+	if (failed)
+		return 1;
+	printf("Finish\n");
+	return 0;
+}
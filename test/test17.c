@@ -0,0 +1,119 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cmap.h"
+
+#define KEYS 3000
+#define SPACE (KEYS * 10)
+#define QUERIES 500
+
+int int_cmp(const void *d1, const void *d2) {
+	const int *int1 = d1, *int2 = d2;
+	return (*int1 > *int2) - (*int1 < *int2);
+}
+
+size_t int_size_get(const void *d1) {
+	return sizeof(int);
+}
+
+/* The value of a reservation is its end. */
+const void *reservation_end(const void *key, const void *val) {
+	return val;
+}
+
+typedef struct {
+	int count;
+	int last;
+	int sorted;
+} visit_t;
+
+bool visit(const void *key, void *val, void *arg) {
+	visit_t *v = arg;
+	v->sorted &= *(const int *)key > v->last;
+	v->last = *(const int *)key;
+	v->count++;
+	return true;
+}
+
+bool visit_once(const void *key, void *val, void *arg) {
+	(*(int *)arg)++;
+	return false;
+}
+
+/*
+ * Compare interval_overlaps() with the intervals found by walking all keys.
+ */
+int check(cmap_t *map) {
+	for (int i = 0; i < QUERIES; i++) {
+		int low = rand() % SPACE, high = low + rand() % 200;
+		int expected = 0;
+		for (cmap_iter_t it = map->begin(map); it.node != NULL; it = map->next(map, it)) {
+			if (*(const int *)it.key < high && *(int *)it.val > low)
+				expected++;
+		}
+		visit_t v = {0, -1, 1};
+		if (!map->interval_overlaps(map, &low, &high, visit, &v))
+			return 1;
+		if (v.count != expected || !v.sorted)
+			return 1;
+		int once = 0;
+		if (map->interval_overlaps(map, &low, &high, visit_once, &once) != (expected == 0) ||
+		    once != (expected > 0))
+			return 1;
+	}
+	return 0;
+}
+
+/*
+ * Test the interval mode of the cmap.
+ * Reservations [start, end) with random lengths are keyed by their starts, and
+ * the reservations overlapping random ranges must be the same as the ones found by
+ * walking all keys after insertions, updates, erasions and range erasions. The
+ * validation of the cmap checks the largest ends of all subtrees.
+ */
+int main(void) {
+	cmap_data_t key_interface =
+		CREATE_INLINE_INTERFACE(int_cmp, int_size_get, sizeof(int));
+	cmap_data_t val_interface = CREATE_INTERFACE(NULL, int_size_get);
+	cmap_option_t option = {.interval_end = reservation_end};
+	cmap_t map = cmap_init3(&key_interface, &val_interface, &option);
+	int failed = 0;
+	srand(17);
+
+	printf("Inserting...\n");
+	for (int i = 0; i < KEYS; i++) {
+		int start = rand() % SPACE, end = start + 1 + rand() % (i % 50 ? 20 : 2000);
+		map.insert(&map, &start, &end);
+	}
+	failed |= check(&map);
+
+	printf("Updating...\n");
+	for (int i = 0; i < KEYS / 4; i++) {
+		int start = rand() % SPACE;
+		cmap_iter_t it = map.lower_bound(&map, &start);
+		if (it.node == NULL)
+			continue;
+		int end = *(const int *)it.key + 1 + rand() % 500;
+		map.insert(&map, it.key, &end);
+	}
+	failed |= check(&map);
+
+	printf("Erasing...\n");
+	for (int i = 0; i < KEYS / 2; i++) {
+		int start = rand() % SPACE;
+		map.erase(&map, &start);
+	}
+	int low = SPACE / 4, high = SPACE / 2;
+	map.erase_range(&map, &low, &high);
+	failed |= check(&map);
+
+	map.destroy(&map);
+	cmap_t plain = cmap_init(&key_interface, &val_interface);
+	if (plain.interval_overlaps(&plain, &low, &high, visit_once, &low))
+		failed = 1;
+	plain.destroy(&plain);
+	if (failed)
+		return 1;
+	printf("Finish\n");
+	return 0;
+}
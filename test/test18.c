@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cmap.h"
+
+#define KEYS 500
+#define EVENTS 20000
+
+int int_cmp(const void *d1, const void *d2) {
+	const int *int1 = d1, *int2 = d2;
+	return (*int1 > *int2) - (*int1 < *int2);
+}
+
+size_t int_size_get(const void *d1) {
+	return sizeof(int);
+}
+
+size_t long_size_get(const void *d1) {
+	return sizeof(long);
+}
+
+void long_add(void *val, const void *delta) {
+	*(long *)val += *(const long *)delta;
+}
+
+void sum_lift(void *summary, const void *key, const void *val) {
+	*(long *)summary = *(const long *)val;
+}
+
+void sum_combine(void *summary, const void *left, const void *right) {
+	*(long *)summary = *(const long *)left + *(const long *)right;
+}
+
+/*
+ * Test get_or_insert() and upsert() of the cmap.
+ * Random events are counted by upsert() in a map with inline values, by
+ * get_or_insert() in a map with allocated values, and by an array. The counters
+ * must agree, and the sum of all counters kept by the augmentation of the first
+ * map must be the number of events.
+ */
+int main(void) {
+	cmap_data_t key_interface =
+		CREATE_INLINE_INTERFACE(int_cmp, int_size_get, sizeof(int));
+	cmap_data_t inline_interface =
+		CREATE_INLINE_INTERFACE(NULL, long_size_get, sizeof(long));
+	cmap_data_t val_interface = CREATE_INTERFACE(NULL, long_size_get);
+	cmap_option_t option = {.aug_size = sizeof(long),
+				.aug_lift = sum_lift,
+				.aug_combine = sum_combine};
+	cmap_t upserted = cmap_init3(&key_interface, &inline_interface, &option);
+	cmap_t counted = cmap_init(&key_interface, &val_interface);
+	long expected[KEYS] = {0}, one = 1, zero = 0;
+	int failed = 0;
+	srand(18);
+
+	printf("Counting...\n");
+	for (int i = 0; i < EVENTS; i++) {
+		int key = rand() % KEYS;
+		expected[key]++;
+		long *val = upserted.upsert(&upserted, &key, &one, long_add);
+		if (*val != expected[key])
+			failed = 1;
+		val = counted.get_or_insert(&counted, &key, &zero);
+		(*val)++;
+		if (val != counted.get_or_insert(&counted, &key, &zero))
+			failed = 1;
+	}
+
+	printf("Checking...\n");
+	for (int key = 0; key < KEYS; key++) {
+		long *val1 = upserted.search(&upserted, &key);
+		long *val2 = counted.search(&counted, &key);
+		if (expected[key] == 0) {
+			if (val1 != NULL || val2 != NULL)
+				failed = 1;
+		}
+		else if (val1 == NULL || val2 == NULL || *val1 != expected[key] ||
+			 *val2 != expected[key])
+			failed = 1;
+	}
+	int low = 0, high = KEYS;
+	long total = 0;
+	upserted.aggregate_range(&upserted, &low, &high, &total);
+	printf("%ld events\n", total);
+	if (total != EVENTS)
+		failed = 1;
+
+	printf("Appending...\n");
+	for (int key = KEYS; key < KEYS * 2; key++) {
+		long val = key;
+		if (*(long *)counted.get_or_insert(&counted, &key, &val) != key)
+			failed = 1;
+		if (*(long *)upserted.upsert(&upserted, &key, &val, long_add) != key)
+			failed = 1;
+	}
+	if (counted.size(&counted) != upserted.size(&upserted))
+		failed = 1;
+
+	upserted.destroy(&upserted);
+	counted.destroy(&counted);
+	if (failed)
+		return 1;
+	printf("Finish\n");
+	return 0;
+}
@@ -0,0 +1,118 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cmap.h"
+#include "cmap_concurrent.h"
+
+#define WORDS 2000
+
+typedef struct {
+	int id;
+	int hits;
+} record_t;
+
+int str_cmp(const void *d1, const void *d2) {
+	return strcmp(d1, d2);
+}
+
+size_t str_size_get(const void *d1) {
+	return strlen(d1) + 1;
+}
+
+bool check_visit(const void *key, void *val, void *arg) {
+	record_t *records = arg;
+	return val == &records[((record_t *)val)->id];
+}
+
+/*
+ * Test the borrowed keys and values of the cmap.
+ * Interned strings and records owned by the test are inserted into a cmap, a
+ * cmap_concurrent and a cmap_sharded object with borrowed interfaces. They must
+ * keep the pointers given by the test, and the objects are neither copied nor
+ * released (checked by ASan and valgrind).
+ */
+int main(void) {
+	char (*words)[16] = malloc(sizeof(*words) * WORDS);
+	record_t *records = malloc(sizeof(record_t) * WORDS);
+	const void **word_ptrs = malloc(sizeof(void *) * WORDS);
+	for (int i = 0; i < WORDS; i++) {
+		snprintf(words[i], sizeof(words[i]), "word%d", i);
+		records[i] = (record_t){.id = i, .hits = 0};
+		word_ptrs[i] = words[i];
+	}
+	cmap_data_t key_interface = CREATE_BORROWED_INTERFACE(str_cmp);
+	cmap_data_t val_interface = CREATE_BORROWED_INTERFACE(NULL);
+	cmap_data_t copied_interface = CREATE_INTERFACE(str_cmp, str_size_get);
+	int failed = 0;
+
+	printf("Inserting...\n");
+	cmap_t map = cmap_init(&key_interface, &val_interface);
+	for (int i = 0; i < WORDS; i++)
+		map.insert(&map, words[i], &records[i]);
+	for (int i = 0; i < WORDS; i += 3)
+		map.insert(&map, words[i], &records[i]);
+	char probe[16];
+	for (int i = 0; i < WORDS; i++) {
+		strcpy(probe, words[i]);
+		cmap_iter_t it = map.find(&map, probe);
+		if (it.key != words[i] || it.val != &records[i])
+			failed = 1;
+		((record_t *)map.get_or_insert(&map, probe, NULL))->hits++;
+	}
+	for (int i = 0; i < WORDS; i++) {
+		if (records[i].hits != 1)
+			failed = 1;
+	}
+	if (!map.foreach(&map, check_visit, records))
+		failed = 1;
+
+	printf("Erasing...\n");
+	for (int i = 0; i < WORDS; i += 2)
+		map.erase(&map, words[i]);
+	for (int i = 0; i < WORDS; i++) {
+		if (map.search(&map, words[i]) != (i % 2 ? &records[i] : NULL))
+			failed = 1;
+		if (strncmp(words[i], "word", 4))
+			failed = 1;
+	}
+	map.destroy(&map);
+
+	printf("Concurrent...\n");
+	cmap_concurrent_t *concurrent = cmap_concurrent_alloc(&key_interface, &val_interface);
+	for (int i = 0; i < WORDS; i++)
+		concurrent->insert(concurrent, words[i], &records[i]);
+	for (int i = 0; i < WORDS; i++) {
+		record_t *record = NULL;
+		if (!concurrent->search(concurrent, words[i], &record) || record != &records[i])
+			failed = 1;
+	}
+	concurrent->destroy(concurrent);
+	concurrent->dealloc(concurrent);
+
+	printf("Sharded...\n");
+	cmap_sharded_t *sharded = cmap_sharded_alloc_sampled(&key_interface, &val_interface, 4,
+							     word_ptrs, word_ptrs, WORDS);
+	cmap_sharded_t *copied = cmap_sharded_alloc_sampled(&copied_interface, &val_interface, 4,
+							    word_ptrs, word_ptrs, WORDS);
+	for (int i = 0; i < WORDS; i++) {
+		const char *word = NULL;
+		if (!sharded->search(sharded, words[i], &word) || word != words[i])
+			failed = 1;
+		word = NULL;
+		if (!copied->search(copied, words[i], &word) || word != words[i])
+			failed = 1;
+	}
+	sharded->destroy(sharded);
+	sharded->dealloc(sharded);
+	copied->destroy(copied);
+	copied->dealloc(copied);
+
+	free(word_ptrs);
+	free(records);
+	free(words);
+	if (failed)
+		return 1;
+	printf("Finish\n");
+	return 0;
+}
@@ -0,0 +1,158 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cmap.h"
+
+#define KEYS 500
+#define LENGTH 20
+
+struct list_node {
+	int val;
+	struct list_node *next;
+};
+
+struct list {
+	struct list_node *head;
+	int length;
+};
+
+int copies, destroys;
+
+int int_cmp(const void *d1, const void *d2) {
+	const int *int1 = d1, *int2 = d2;
+	return (*int1 > *int2) - (*int1 < *int2);
+}
+
+size_t int_size_get(const void *d1) {
+	return sizeof(int);
+}
+
+size_t list_size_get(const void *list) {
+	return sizeof(struct list);
+}
+
+void *list_copy(void *dest, const void *src, size_t size) {
+	struct list *list_dest = dest;
+	const struct list *list_src = src;
+	struct list_node **tail = &list_dest->head;
+	for (struct list_node *ptr = list_src->head; ptr != NULL; ptr = ptr->next) {
+		*tail = calloc(1, sizeof(struct list_node));
+		(*tail)->val = ptr->val;
+		tail = &(*tail)->next;
+	}
+	list_dest->length = list_src->length;
+	copies++;
+	return dest;
+}
+
+void list_destroy(void *list_ptr) {
+	struct list *list = list_ptr;
+	while (list->head != NULL) {
+		struct list_node *next = list->head->next;
+		free(list->head);
+		list->head = next;
+	}
+	destroys++;
+}
+
+/* A list of @length values from @first allocated by malloc(). */
+struct list *list_alloc(int first, int length) {
+	struct list *list = malloc(sizeof(struct list));
+	*list = (struct list){.head = NULL, .length = length};
+	for (int i = length - 1; i >= 0; i--) {
+		struct list_node *node = malloc(sizeof(struct list_node));
+		*node = (struct list_node){.val = first + i, .next = list->head};
+		list->head = node;
+	}
+	return list;
+}
+
+int list_check(const struct list *list, int first) {
+	int i = 0;
+	for (struct list_node *ptr = list->head; ptr != NULL; ptr = ptr->next, i++) {
+		if (ptr->val != first + i)
+			return 1;
+	}
+	return i != list->length;
+}
+
+/*
+ * Test insert_move() and extract() of the cmap.
+ * Allocated linked lists are moved into the cmap, updated by other moved lists and
+ * extracted again, and none of them may be copied. Inline keys are extracted into
+ * allocated buffers. ASan and valgrind check that every buffer is released once.
+ */
+int main(void) {
+	cmap_data_t key_interface =
+		CREATE_INLINE_INTERFACE(int_cmp, int_size_get, sizeof(int));
+	cmap_data_t val_interface =
+		CREATE_INTERFACE4(NULL, list_size_get, list_copy, list_destroy);
+	cmap_t map = cmap_init(&key_interface, &val_interface);
+	int failed = 0;
+	srand(20);
+
+	printf("Moving...\n");
+	for (int key = 0; key < KEYS; key++) {
+		int *moved_key = malloc(sizeof(int));
+		*moved_key = key;
+		struct list *list = list_alloc(key, LENGTH);
+		map.insert_move(&map, moved_key, list);
+		if (map.search(&map, &key) != list)
+			failed = 1;
+	}
+	for (int key = 0; key < KEYS; key += 2) {
+		int *moved_key = malloc(sizeof(int));
+		*moved_key = key;
+		map.insert_move(&map, moved_key, list_alloc(key * 2, LENGTH * 2));
+	}
+	if (copies != 0 || destroys != KEYS / 2)
+		failed = 1;
+
+	printf("Extracting...\n");
+	for (int i = 0; i < KEYS * 2; i++) {
+		int key = rand() % KEYS;
+		void *key_out, *val_out;
+		bool found = map.search(&map, &key) != NULL;
+		if (map.extract(&map, &key, &key_out, &val_out) != found)
+			failed = 1;
+		if (!found)
+			continue;
+		struct list *list = val_out;
+		if (*(int *)key_out != key || list_check(list, key % 2 ? key : key * 2))
+			failed = 1;
+		free(key_out);
+		list_destroy(list);
+		free(list);
+	}
+	for (int key = 0; key < KEYS; key++) {
+		if (map.search(&map, &key) != NULL && !map.extract(&map, &key, NULL, NULL))
+			failed = 1;
+	}
+	printf("%d copies, %d destroys\n", copies, destroys);
+	if (copies != 0 || destroys != KEYS + KEYS / 2 || map.size(&map) != 0)
+		failed = 1;
+
+	map.destroy(&map);
+
+	printf("Extracting inline data...\n");
+	cmap_data_t inline_interface =
+		CREATE_INLINE_INTERFACE(NULL, int_size_get, sizeof(int));
+	cmap_t inline_map = cmap_init(&key_interface, &inline_interface);
+	for (int key = 0; key < KEYS; key++) {
+		int val = -key;
+		inline_map.insert(&inline_map, &key, &val);
+	}
+	for (int key = KEYS - 1; key >= 0; key -= 3) {
+		int *key_out, *val_out;
+		if (!inline_map.extract(&inline_map, &key, (void **)&key_out, (void **)&val_out) ||
+		    *key_out != key || *val_out != -key)
+			failed = 1;
+		free(key_out);
+		free(val_out);
+	}
+	inline_map.destroy(&inline_map);
+	if (failed)
+		return 1;
+	printf("Finish\n");
+	return 0;
+}
@@ -0,0 +1,110 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cmap.h"
+
+#define KEYS 3000
+
+int int_cmp(const void *d1, const void *d2) {
+	const int *int1 = d1, *int2 = d2;
+	return (*int1 > *int2) - (*int1 < *int2);
+}
+
+size_t int_size_get(const void *d1) {
+	return sizeof(int);
+}
+
+const void *int_end(const void *key, const void *val) {
+	return val;
+}
+
+void sum_lift(void *summary, const void *key, const void *val) {
+	*(long *)summary = *(const int *)val;
+}
+
+void sum_combine(void *summary, const void *left, const void *right) {
+	*(long *)summary = *(const long *)left + *(const long *)right;
+}
+
+/*
+ * Test the stable addresses of the keys and values of the cmap.
+ * The pointers returned by search() and the iterators of all keys are kept, then
+ * random keys are erased one by one and by ranges. The kept pointers and iterators
+ * of the remaining keys must still hold their keys and values. It runs with inline
+ * and allocated data, and with all options on, where the validation of the cmap
+ * checks the subtree sizes and summaries of the relinked nodes.
+ */
+int main(void) {
+	cmap_data_t key_interface =
+		CREATE_INLINE_INTERFACE(int_cmp, int_size_get, sizeof(int));
+	cmap_data_t inline_interface =
+		CREATE_INLINE_INTERFACE(NULL, int_size_get, sizeof(int));
+	cmap_data_t val_interface = CREATE_INTERFACE(NULL, int_size_get);
+	int **vals = malloc(sizeof(int *) * KEYS);
+	cmap_iter_t *iters = malloc(sizeof(cmap_iter_t) * KEYS);
+	bool *erased = malloc(sizeof(bool) * KEYS);
+	int failed = 0;
+	srand(21);
+
+	for (int mode = 0; mode < 3; mode++) {
+		cmap_option_t option = {.order_statistics = mode == 2,
+					.interval_end = mode == 2 ? int_end : NULL,
+					.aug_size = mode == 2 ? sizeof(long) : 0,
+					.aug_lift = sum_lift,
+					.aug_combine = sum_combine};
+		cmap_t map = cmap_init3(&key_interface, mode == 1 ? &val_interface : &inline_interface,
+					&option);
+		printf("Mode %d: inserting...\n", mode);
+		for (int i = 0; i < KEYS; i++) {
+			int key = (i * 7919) % KEYS, val = key * 3;
+			map.insert(&map, &key, &val);
+		}
+		for (int key = 0; key < KEYS; key++) {
+			vals[key] = map.search(&map, &key);
+			iters[key] = map.find(&map, &key);
+			erased[key] = false;
+		}
+
+		printf("Mode %d: erasing...\n", mode);
+		for (int i = 0; i < KEYS / 2; i++) {
+			int key = rand() % KEYS;
+			map.erase(&map, &key);
+			erased[key] = true;
+			if (i % 300 == 0) {
+				int low = rand() % KEYS, high = low + 40;
+				map.erase_range(&map, &low, &high);
+				for (int k = low; k < high && k < KEYS; k++)
+					erased[k] = true;
+			}
+		}
+
+		int remaining = 0;
+		for (int key = 0; key < KEYS; key++) {
+			if (erased[key]) {
+				if (map.search(&map, &key) != NULL)
+					failed = 1;
+				continue;
+			}
+			remaining++;
+			if (map.search(&map, &key) != vals[key] || *vals[key] != key * 3)
+				failed = 1;
+			if (*(const int *)iters[key].key != key || iters[key].val != vals[key])
+				failed = 1;
+			cmap_iter_t next = map.next(&map, iters[key]);
+			if (next.node != NULL && *(const int *)next.key <= key)
+				failed = 1;
+		}
+		printf("%d keys\n", remaining);
+		if (map.size(&map) != (size_t)remaining)
+			failed = 1;
+		map.destroy(&map);
+	}
+
+	free(vals);
+	free(iters);
+	free(erased);
+	if (failed)
+		return 1;
+	printf("Finish\n");
+	return 0;
+}
@@ -0,0 +1,119 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cmap.h"
+
+#define KEYS 5000
+#define CYCLES 4
+
+static int destroyed = 0;
+
+int str_cmp(const void *d1, const void *d2) {
+	return strcmp(d1, d2);
+}
+
+size_t str_size_get(const void *d1) {
+	return strlen(d1) + 1;
+}
+
+void str_destroy(void *d1) {
+	destroyed++;
+}
+
+int int_cmp(const void *d1, const void *d2) {
+	const int *int1 = d1, *int2 = d2;
+	return (*int1 > *int2) - (*int1 < *int2);
+}
+
+size_t int_size_get(const void *d1) {
+	return sizeof(int);
+}
+
+/*
+ * Test clear() and the teardown of the cmap.
+ * Strings (some inline, some allocated) with a counting destructor are inserted
+ * and the cmap is cleared and refilled for several cycles, where every key and
+ * value must be destroyed exactly once and the refilled cmap must be correct.
+ * The chunks kept by clear() are checked to be all reused by the refill, and
+ * a cmap of inline ints and a borrowed cmap are cleared and destroyed without
+ * any hook.
+ */
+int main(void) {
+	cmap_data_t str_interface = {.cmp = str_cmp,
+				     .data_size_get = str_size_get,
+				     .copy = memcpy,
+				     .destroy = str_destroy,
+				     .dealloc = free,
+				     .inline_size = 8};
+	cmap_data_t int_interface = CREATE_INLINE_INTERFACE(int_cmp, int_size_get, sizeof(int));
+	cmap_data_t borrowed_interface = CREATE_BORROWED_INTERFACE(int_cmp);
+	int *ints = malloc(sizeof(int) * KEYS);
+	char key[32], val[32];
+	int failed = 0;
+
+	cmap_t map = cmap_init(&str_interface, &str_interface);
+	for (int cycle = 0; cycle < CYCLES; cycle++) {
+		printf("Cycle %d: inserting...\n", cycle);
+		for (int i = 0; i < KEYS; i++) {
+			int id = (i * 7919 + cycle) % KEYS;
+			snprintf(key, sizeof(key), "%s%d", id % 2 ? "long-key-" : "k", id);
+			snprintf(val, sizeof(val), "v%d", id * (cycle + 1));
+			map.insert(&map, key, val);
+		}
+		for (int id = 0; id < KEYS; id++) {
+			snprintf(key, sizeof(key), "%s%d", id % 2 ? "long-key-" : "k", id);
+			snprintf(val, sizeof(val), "v%d", id * (cycle + 1));
+			const char *found = map.search(&map, key);
+			if (found == NULL || strcmp(found, val) != 0)
+				failed = 1;
+		}
+		if (cycle > 0 && map.pool.spare != NULL)
+			failed = 1;
+		destroyed = 0;
+		map.clear(&map);
+		printf("Cycle %d: %d objects destroyed\n", cycle, destroyed);
+		if (destroyed != 2 * KEYS || map.size(&map) != 0 || map.search(&map, "k0") != NULL ||
+		    map.begin(&map).node != NULL)
+			failed = 1;
+		if (map.pool.spare == NULL || map.pool.chunks != NULL)
+			failed = 1;
+	}
+	destroyed = 0;
+	snprintf(key, sizeof(key), "long-key-%d", 1);
+	map.insert(&map, key, "v");
+	map.destroy(&map);
+	if (destroyed != 2 || map.pool.chunks != NULL || map.pool.spare != NULL)
+		failed = 1;
+
+	printf("Inline and borrowed cmaps...\n");
+	for (int i = 0; i < KEYS; i++)
+		ints[i] = i;
+	cmap_t inline_map = cmap_init(&int_interface, &int_interface);
+	cmap_t borrowed_map = cmap_init(&borrowed_interface, &borrowed_interface);
+	for (int cycle = 0; cycle < CYCLES; cycle++) {
+		for (int i = 0; i < KEYS; i++) {
+			int id = (i * 7919) % KEYS;
+			inline_map.insert(&inline_map, &ints[id], &ints[id]);
+			borrowed_map.insert(&borrowed_map, &ints[id], &ints[id]);
+		}
+		if (inline_map.size(&inline_map) != KEYS || borrowed_map.size(&borrowed_map) != KEYS ||
+		    borrowed_map.search(&borrowed_map, &ints[7]) != &ints[7])
+			failed = 1;
+		inline_map.clear(&inline_map);
+		borrowed_map.clear(&borrowed_map);
+		if (inline_map.size(&inline_map) != 0 || borrowed_map.size(&borrowed_map) != 0)
+			failed = 1;
+	}
+	inline_map.build_sorted(&inline_map, (const void *const[]){&ints[1], &ints[2]},
+				(const void *const[]){&ints[1], &ints[2]}, 2);
+	if (inline_map.size(&inline_map) != 2)
+		failed = 1;
+	inline_map.destroy(&inline_map);
+	borrowed_map.destroy(&borrowed_map);
+
+	free(ints);
+	if (failed)
+		return 1;
+	printf("Finish\n");
+	return 0;
+}
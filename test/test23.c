@@ -0,0 +1,183 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cmap.h"
+
+#define KEYS 3000
+#define OPS 20000
+
+int int_cmp(const void *d1, const void *d2) {
+	const int *int1 = d1, *int2 = d2;
+	return (*int1 > *int2) - (*int1 < *int2);
+}
+
+size_t int_size_get(const void *d1) {
+	return sizeof(int);
+}
+
+int str_cmp(const void *d1, const void *d2) {
+	return strcmp(d1, d2);
+}
+
+size_t str_size_get(const void *d1) {
+	return strlen(d1) + 1;
+}
+
+void int_add(void *val, const void *delta) {
+	*(int *)val += *(const int *)delta;
+}
+
+/*
+ * The key of an id, which has the same order as the id for every mode.
+ * Mode 0 stores ints inline, mode 1 stores allocated strings and mode 2 borrows
+ * the keys from the table of the test.
+ */
+static int ids[KEYS];
+static char names[KEYS][16];
+
+static const void *key_of(int mode, int id) {
+	return mode == 1 ? (const void *)names[id] : (const void *)&ids[id];
+}
+
+static int id_of(int mode, const void *key) {
+	return mode == 1 ? atoi((const char *)key + 4) : *(const int *)key;
+}
+
+/*
+ * Test the B-tree mode of the cmap.
+ * Random insert(), upsert(), erase() and extract() calls are checked against an
+ * array, where the B+ tree is validated after every call. Then the iterators,
+ * select(), rank(), count_range(), erase_range() and clear() are checked, for
+ * inline, allocated and borrowed keys.
+ */
+int main(void) {
+	cmap_data_t int_interface = CREATE_INLINE_INTERFACE(int_cmp, int_size_get, sizeof(int));
+	cmap_data_t str_interface = CREATE_INTERFACE(str_cmp, str_size_get);
+	cmap_data_t borrowed_interface = CREATE_BORROWED_INTERFACE(int_cmp);
+	cmap_data_t val_interface = CREATE_INLINE_INTERFACE(NULL, int_size_get, sizeof(int));
+	cmap_option_t option = {.btree = true};
+	int *expected = malloc(sizeof(int) * KEYS);
+	int failed = 0;
+	for (int i = 0; i < KEYS; i++) {
+		ids[i] = i;
+		snprintf(names[i], sizeof(names[i]), "key-%05d", i);
+	}
+	srand(23);
+
+	for (int mode = 0; mode < 3; mode++) {
+		cmap_data_t *key_interface = mode == 0   ? &int_interface
+					     : mode == 1 ? &str_interface
+							 : &borrowed_interface;
+		cmap_t map = cmap_init3(key_interface, &val_interface, &option);
+		size_t count = 0;
+		for (int i = 0; i < KEYS; i++)
+			expected[i] = -1;
+
+		printf("Mode %d: random operations...\n", mode);
+		for (int op = 0; op < OPS; op++) {
+			int id = rand() % KEYS, val = rand() % 1000, one = 1;
+			const void *key = key_of(mode, id);
+			switch (rand() % 5) {
+			case 0:
+			case 1:
+				map.insert(&map, key, &val);
+				count += expected[id] < 0;
+				expected[id] = val;
+				break;
+			case 2:
+				map.upsert(&map, key, &one, int_add);
+				count += expected[id] < 0;
+				expected[id] = expected[id] < 0 ? 1 : expected[id] + 1;
+				break;
+			case 3:
+				if (map.erase(&map, key) != (expected[id] >= 0))
+					failed = 1;
+				count -= expected[id] >= 0;
+				expected[id] = -1;
+				break;
+			default: {
+				void *key_out, *val_out;
+				bool extracted = map.extract(&map, key, &key_out, &val_out);
+				if (extracted != (expected[id] >= 0))
+					failed = 1;
+				if (extracted) {
+					if (id_of(mode, key_out) != id || *(int *)val_out != expected[id])
+						failed = 1;
+					if (mode != 2)
+						free(key_out);
+					free(val_out);
+				}
+				count -= expected[id] >= 0;
+				expected[id] = -1;
+			}
+			}
+			if (map.size(&map) != count)
+				failed = 1;
+		}
+
+		printf("Mode %d: %zu keys, walking...\n", mode, count);
+		size_t rank = 0;
+		cmap_iter_t it = map.begin(&map);
+		for (int id = 0; id < KEYS; id++) {
+			const int *val = map.search(&map, key_of(mode, id));
+			if ((val == NULL) != (expected[id] < 0) || (val != NULL && *val != expected[id]))
+				failed = 1;
+			if (map.rank(&map, key_of(mode, id)) != rank)
+				failed = 1;
+			cmap_iter_t lower = map.lower_bound(&map, key_of(mode, id));
+			if (lower.node != it.node || lower.key != it.key)
+				failed = 1;
+			if (expected[id] < 0)
+				continue;
+			if (it.node == NULL || id_of(mode, it.key) != id || *(int *)it.val != expected[id])
+				failed = 1;
+			cmap_iter_t selected = map.select(&map, rank);
+			if (selected.key != it.key)
+				failed = 1;
+			cmap_iter_t upper = map.upper_bound(&map, key_of(mode, id));
+			it = map.next(&map, it);
+			if (upper.key != it.key)
+				failed = 1;
+			rank++;
+		}
+		if (it.node != NULL || map.select(&map, rank).node != NULL)
+			failed = 1;
+		for (it = map.prev(&map, map.end(&map)); it.node != NULL; it = map.prev(&map, it))
+			rank--;
+		if (rank != 0)
+			failed = 1;
+
+		printf("Mode %d: ranges...\n", mode);
+		int low = rand() % (KEYS / 2), high = low + KEYS / 3;
+		size_t in_range = 0;
+		for (int id = low; id < high; id++)
+			in_range += expected[id] >= 0;
+		if (map.count_range(&map, key_of(mode, low), key_of(mode, high)) != in_range ||
+		    map.erase_range(&map, key_of(mode, low), key_of(mode, high)) != in_range ||
+		    map.count_range(&map, key_of(mode, low), key_of(mode, high)) != 0 ||
+		    map.size(&map) != count - in_range)
+			failed = 1;
+		map.clear(&map);
+		if (map.size(&map) != 0 || map.begin(&map).node != NULL)
+			failed = 1;
+
+		const void **sorted_keys = malloc(sizeof(void *) * KEYS);
+		const void **sorted_vals = malloc(sizeof(void *) * KEYS);
+		for (int id = 0; id < KEYS; id++) {
+			sorted_keys[id] = key_of(mode, id);
+			sorted_vals[id] = &ids[id];
+		}
+		if (!map.build_sorted(&map, sorted_keys, sorted_vals, KEYS) ||
+		    map.size(&map) != KEYS || *(int *)map.select(&map, KEYS / 2).val != KEYS / 2)
+			failed = 1;
+		free(sorted_keys);
+		free(sorted_vals);
+		map.destroy(&map);
+	}
+
+	free(expected);
+	if (failed)
+		return 1;
+	printf("Finish\n");
+	return 0;
+}
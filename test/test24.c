@@ -0,0 +1,116 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "cmap_define.h"
+
+#define KEYS 4000
+#define OPS 40000
+
+CMAP_DEFINE(i64map, int64_t, int64_t, (a > b) - (a < b))
+
+/* A typed cmap whose keys are in descending order, where the value is a struct. */
+typedef struct {
+	int32_t x, y;
+} point_t;
+
+CMAP_DEFINE(descmap, int32_t, point_t, (a < b) - (a > b))
+
+/*
+ * Test the type-specialized cmap of CMAP_DEFINE().
+ * Random insert(), search() and erase() calls of a typed int64 cmap are checked
+ * against an array, where the tree is validated by the generic methods mixed into
+ * the calls, and the iterators must walk the keys in ascending order. A typed cmap
+ * with a descending order and struct values is checked by its iterators.
+ */
+int main(void) {
+	int64_t *expected = malloc(sizeof(int64_t) * KEYS);
+	int failed = 0;
+	size_t count = 0;
+	for (int i = 0; i < KEYS; i++)
+		expected[i] = -1;
+	srand(24);
+
+	printf("Random operations...\n");
+	i64map_t map = i64map_init();
+	for (int op = 0; op < OPS; op++) {
+		int64_t key = (int64_t)(rand() % KEYS) * 1000000007LL - 1000000000000LL;
+		int id = (int)((key + 1000000000000LL) / 1000000007LL);
+		int64_t val = rand() % 1000;
+		switch (rand() % 5) {
+		case 0:
+		case 1: {
+			int64_t *stored = i64map_insert(&map, key, val);
+			if (stored == NULL || *stored != val)
+				failed = 1;
+			count += expected[id] < 0;
+			expected[id] = val;
+			break;
+		}
+		case 2:
+			// The generic methods share the same tree, which is validated by them.
+			map.map.insert(&map.map, &key, &val);
+			count += expected[id] < 0;
+			expected[id] = val;
+			break;
+		case 3:
+			if (i64map_erase(&map, key) != (expected[id] >= 0))
+				failed = 1;
+			count -= expected[id] >= 0;
+			expected[id] = -1;
+			break;
+		default: {
+			int64_t *found = i64map_search(&map, key);
+			if ((found == NULL) != (expected[id] < 0) || (found != NULL && *found != expected[id]))
+				failed = 1;
+		}
+		}
+		if (i64map_size(&map) != count || map.map.size(&map.map) != count)
+			failed = 1;
+	}
+
+	printf("%zu keys, walking...\n", count);
+	cmap_iter_t it = map.map.begin(&map.map);
+	for (int id = 0; id < KEYS; id++) {
+		int64_t key = (int64_t)id * 1000000007LL - 1000000000000LL;
+		const int64_t *generic = map.map.search(&map.map, &key);
+		if (generic != i64map_search(&map, key))
+			failed = 1;
+		if (expected[id] < 0)
+			continue;
+		if (it.node == NULL || *(const int64_t *)it.key != key || *(int64_t *)it.val != expected[id])
+			failed = 1;
+		it = map.map.next(&map.map, it);
+	}
+	if (it.node != NULL)
+		failed = 1;
+	for (int id = 0; id < KEYS; id++)
+		if (expected[id] >= 0 && !i64map_erase(&map, (int64_t)id * 1000000007LL - 1000000000000LL))
+			failed = 1;
+	if (i64map_size(&map) != 0 || map.map.begin(&map.map).node != NULL)
+		failed = 1;
+	i64map_insert(&map, 1, 1);
+	i64map_destroy(&map);
+
+	printf("Descending keys and struct values...\n");
+	descmap_t desc = descmap_init();
+	for (int32_t i = 0; i < KEYS; i++)
+		descmap_insert(&desc, (i * 7919) % KEYS, (point_t){.x = (i * 7919) % KEYS, .y = -i});
+	int32_t prev = KEYS;
+	for (it = desc.map.begin(&desc.map); it.node != NULL; it = desc.map.next(&desc.map, it)) {
+		const point_t *point = it.val;
+		if (*(const int32_t *)it.key != prev - 1 || point->x != prev - 1)
+			failed = 1;
+		prev--;
+	}
+	point_t *point = descmap_search(&desc, 17);
+	if (prev != 0 || point == NULL || point->x != 17 || descmap_search(&desc, KEYS) != NULL)
+		failed = 1;
+	descmap_destroy(&desc);
+
+	free(expected);
+	if (failed)
+		return 1;
+	printf("Finish\n");
+	return 0;
+}
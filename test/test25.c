@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "cmap.h"
+
+#define KEYS 3000
+
+static int sorted_cmp(const void *d1, const void *d2) {
+	return strcmp(*(char *const *)d1, *(char *const *)d2);
+}
+
+/*
+ * Test the built-in interfaces of C strings and integers.
+ * Strings sharing long prefixes, shorter than the cached prefix, empty or with bytes
+ * above 127 are inserted, searched, erased and walked, where the order must be the
+ * one of strcmp() for the red-black tree and the B-tree mode. Then the int32, int64
+ * and uint64 interfaces are checked with negative and huge keys.
+ */
+int main(void) {
+	cmap_data_t str_interface = CREATE_STRING_INTERFACE();
+	cmap_data_t int32_interface = CREATE_INT32_INTERFACE();
+	cmap_data_t int64_interface = CREATE_INT64_INTERFACE();
+	cmap_data_t uint64_interface = CREATE_UINT64_INTERFACE();
+	char **strs = malloc(sizeof(char *) * KEYS);
+	int failed = 0;
+
+	const char *stems[] = {"", "a", "ab", "abcdefg", "abcdefgh", "abcdefghi", "\xc3\xa9t\xc3\xa9"};
+	for (int i = 0; i < KEYS; i++) {
+		strs[i] = malloc(32);
+		if (i < 7)
+			strcpy(strs[i], stems[i]);
+		else
+			snprintf(strs[i], 32, "%s%d", stems[i % 7], i * 7919 % 100003);
+	}
+
+	for (int btree = 0; btree < 2; btree++) {
+		cmap_option_t option = {.btree = btree};
+		cmap_t map = cmap_init3(&str_interface, &int32_interface, &option);
+		printf("%s: strings...\n", btree ? "B-tree" : "Red-black tree");
+		for (int32_t i = 0; i < KEYS; i++)
+			map.insert(&map, strs[i], &i);
+		for (int32_t i = 0; i < KEYS; i++) {
+			const int32_t *val = map.search(&map, strs[i]);
+			if (val == NULL || *val != i)
+				failed = 1;
+		}
+		if (map.search(&map, "abcdefgh0") != NULL || map.search(&map, "abcdefg\x01") != NULL ||
+		    map.search(&map, "\xc3") != NULL || map.size(&map) != KEYS)
+			failed = 1;
+
+		char **sorted = malloc(sizeof(char *) * KEYS);
+		memcpy(sorted, strs, sizeof(char *) * KEYS);
+		qsort(sorted, KEYS, sizeof(char *), sorted_cmp);
+		int rank = 0;
+		for (cmap_iter_t it = map.begin(&map); it.node != NULL; it = map.next(&map, it))
+			if (strcmp(it.key, sorted[rank++]) != 0)
+				failed = 1;
+		if (rank != KEYS)
+			failed = 1;
+		cmap_iter_t lower = map.lower_bound(&map, "abcdefgh");
+		if (lower.node == NULL || strcmp(lower.key, "abcdefgh") != 0 ||
+		    strcmp(map.next(&map, lower).key, "abcdefgh") <= 0)
+			failed = 1;
+
+		for (int i = 0; i < KEYS; i += 2)
+			if (!map.erase(&map, strs[i]))
+				failed = 1;
+		for (int32_t i = 0; i < KEYS; i++)
+			if ((map.search(&map, strs[i]) == NULL) != (i % 2 == 0))
+				failed = 1;
+		free(sorted);
+		map.destroy(&map);
+	}
+
+	printf("Integers...\n");
+	cmap_t map32 = cmap_init(&int32_interface, &int32_interface);
+	cmap_t map64 = cmap_init(&int64_interface, &int64_interface);
+	cmap_t mapu64 = cmap_init(&uint64_interface, &uint64_interface);
+	for (int32_t i = 0; i < KEYS; i++) {
+		int32_t key32 = (i % 2 ? -1 : 1) * (i * 7919 % KEYS) * 1000;
+		int64_t key64 = (int64_t)key32 * 1000000007LL;
+		uint64_t keyu64 = (uint64_t)key64;
+		map32.insert(&map32, &key32, &key32);
+		map64.insert(&map64, &key64, &key64);
+		mapu64.insert(&mapu64, &keyu64, &keyu64);
+	}
+	int64_t prev64 = INT64_MIN;
+	int32_t prev32 = INT32_MIN;
+	for (cmap_iter_t it = map32.begin(&map32); it.node != NULL; it = map32.next(&map32, it)) {
+		if (*(int32_t *)it.key <= prev32 || *(int32_t *)it.val != *(int32_t *)it.key)
+			failed = 1;
+		prev32 = *(int32_t *)it.key;
+	}
+	for (cmap_iter_t it = map64.begin(&map64); it.node != NULL; it = map64.next(&map64, it)) {
+		if (*(int64_t *)it.key <= prev64)
+			failed = 1;
+		prev64 = *(int64_t *)it.key;
+	}
+	// The negative keys are the largest ones as uint64_t.
+	uint64_t first = *(uint64_t *)mapu64.begin(&mapu64).key;
+	uint64_t last = *(uint64_t *)mapu64.prev(&mapu64, mapu64.end(&mapu64)).key;
+	if (first != 0 || last != (uint64_t)(int64_t)-1000 * 1000000007ULL)
+		failed = 1;
+	int64_t key64 = -2999000LL * 1000000007LL;
+	if (map32.size(&map32) != map64.size(&map64) || mapu64.size(&mapu64) != map64.size(&map64) ||
+	    map64.search(&map64, &key64) == NULL || !map64.erase(&map64, &key64) ||
+	    map64.search(&map64, &key64) != NULL)
+		failed = 1;
+	map32.destroy(&map32);
+	map64.destroy(&map64);
+	mapu64.destroy(&mapu64);
+
+	for (int i = 0; i < KEYS; i++)
+		free(strs[i]);
+	free(strs);
+	if (failed)
+		return 1;
+	printf("Finish\n");
+	return 0;
+}
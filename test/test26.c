@@ -0,0 +1,161 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "cmap.h"
+
+#define KEYS 4000
+#define OPS 40000
+
+int int_cmp(const void *d1, const void *d2) {
+	const int *int1 = d1, *int2 = d2;
+	return (*int1 > *int2) - (*int1 < *int2);
+}
+
+size_t int_size_get(const void *d1) {
+	return sizeof(int);
+}
+
+/* A weak hash given by user, where many keys share a hash. */
+size_t int_hash(const void *d1) {
+	return *(const int *)d1 / 4;
+}
+
+void int_add(void *val, const void *delta) {
+	*(int *)val += *(const int *)delta;
+}
+
+/*
+ * Test the hash index of the cmap.
+ * Random insert(), upsert(), erase(), extract() and erase_range() calls of a cmap with
+ * the hash_index option are checked against an array, where the index is validated
+ * after every call (DEBUG) and search() and find() must agree with the tree. The user
+ * hash and the built-in hash of strings are used, and stats() must report the index.
+ */
+int main(void) {
+	cmap_data_t int_interface = {.cmp = int_cmp,
+				     .data_size_get = int_size_get,
+				     .copy = memcpy,
+				     .dealloc = free,
+				     .inline_size = sizeof(int),
+				     .hash = int_hash};
+	cmap_data_t no_hash_interface = CREATE_INLINE_INTERFACE(int_cmp, int_size_get, sizeof(int));
+	cmap_data_t str_interface = CREATE_STRING_INTERFACE();
+	cmap_option_t option = {.hash_index = true};
+	int *expected = malloc(sizeof(int) * KEYS);
+	int failed = 0;
+	size_t count = 0;
+	for (int i = 0; i < KEYS; i++)
+		expected[i] = -1;
+	srand(26);
+
+	printf("Random operations...\n");
+	cmap_t map = cmap_init3(&int_interface, &int_interface, &option);
+	for (int op = 0; op < OPS; op++) {
+		int key = rand() % KEYS, val = rand() % 1000, one = 1;
+		switch (rand() % 6) {
+		case 0:
+		case 1:
+			map.insert(&map, &key, &val);
+			count += expected[key] < 0;
+			expected[key] = val;
+			break;
+		case 2:
+			map.upsert(&map, &key, &one, int_add);
+			count += expected[key] < 0;
+			expected[key] = expected[key] < 0 ? 1 : expected[key] + 1;
+			break;
+		case 3:
+			if (map.erase(&map, &key) != (expected[key] >= 0))
+				failed = 1;
+			count -= expected[key] >= 0;
+			expected[key] = -1;
+			break;
+		case 4: {
+			void *key_out = NULL, *val_out;
+			bool extracted = map.extract(&map, &key, rand() % 2 ? &key_out : NULL, &val_out);
+			if (extracted != (expected[key] >= 0) || (extracted && *(int *)val_out != expected[key]))
+				failed = 1;
+			if (extracted) {
+				free(key_out);
+				free(val_out);
+			}
+			count -= expected[key] >= 0;
+			expected[key] = -1;
+			break;
+		}
+		default: {
+			const int *found = map.search(&map, &key);
+			cmap_iter_t it = map.find(&map, &key);
+			if ((found == NULL) != (expected[key] < 0) || (found != NULL && *found != expected[key]) ||
+			    it.val != found)
+				failed = 1;
+		}
+		}
+		if (map.size(&map) != count)
+			failed = 1;
+	}
+
+	printf("%zu keys, ranges...\n", count);
+	int low = KEYS / 4, high = KEYS / 2;
+	size_t in_range = 0;
+	for (int key = low; key < high; key++)
+		in_range += expected[key] >= 0;
+	if (map.erase_range(&map, &low, &high) != in_range)
+		failed = 1;
+	for (int key = 0; key < KEYS; key++) {
+		const int *found = map.search(&map, &key);
+		bool kept = expected[key] >= 0 && (key < low || key >= high);
+		if ((found != NULL) != kept || (found != NULL && *found != expected[key]))
+			failed = 1;
+	}
+
+	cmap_stats_t stats;
+	map.stats(&map, &stats);
+	printf("Index: %zu slots, %zu bytes for %zu keys\n", stats.index_capacity, stats.index_memory,
+	       stats.count);
+	if (stats.count != count - in_range || stats.index_capacity * 3 < stats.count * 4 ||
+	    stats.index_memory == 0 || stats.node_memory < stats.count * stats.node_size)
+		failed = 1;
+	map.clear(&map);
+	if (map.search(&map, &low) != NULL || map.find(&map, &low).node != NULL)
+		failed = 1;
+	map.insert(&map, &low, &high);
+	if (map.search(&map, &low) == NULL || *(int *)map.search(&map, &low) != high)
+		failed = 1;
+	map.destroy(&map);
+
+	printf("Built-in hash of strings...\n");
+	cmap_t str_map = cmap_init3(&str_interface, &int_interface, &option);
+	char key[32];
+	for (int i = 0; i < KEYS; i++) {
+		snprintf(key, sizeof(key), "key-%d", i * 7919 % KEYS);
+		str_map.insert(&str_map, key, &i);
+	}
+	for (int i = 0; i < KEYS; i += 3) {
+		snprintf(key, sizeof(key), "key-%d", i);
+		str_map.erase(&str_map, key);
+	}
+	for (int i = 0; i < KEYS; i++) {
+		snprintf(key, sizeof(key), "key-%d", i);
+		const int *found = str_map.search(&str_map, key);
+		if ((found == NULL) != (i % 3 == 0) || (found != NULL && *found * 7919 % KEYS != i))
+			failed = 1;
+	}
+	str_map.destroy(&str_map);
+
+	// Without any hash, the option is ignored.
+	cmap_t plain_map = cmap_init3(&no_hash_interface, &no_hash_interface, &option);
+	plain_map.insert(&plain_map, &low, &high);
+	plain_map.stats(&plain_map, &stats);
+	if (plain_map.option.hash_index || stats.index_capacity != 0 ||
+	    plain_map.search(&plain_map, &low) == NULL)
+		failed = 1;
+	plain_map.destroy(&plain_map);
+
+	free(expected);
+	if (failed)
+		return 1;
+	printf("Finish\n");
+	return 0;
+}
@@ -0,0 +1,143 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "cmap.h"
+
+#define KEYS 4000
+#define OPS 40000
+#define PROBES 200000
+
+/*
+ * Test the Bloom filter of the cmap.
+ * Random insert(), erase(), extract() and erase_range() calls of a cmap with the
+ * bloom_filter option are checked against an array, with a small bloom_churn and
+ * the default one, where every key in the cmap must pass the filter (DEBUG) and
+ * search() and find() must agree with the array. Missing keys must not be found,
+ * and the false-positive rate estimated by stats() must be small.
+ */
+int main(void) {
+	cmap_data_t interface = CREATE_INT32_INTERFACE();
+	cmap_data_t str_interface = CREATE_STRING_INTERFACE();
+	int32_t *expected = malloc(sizeof(int32_t) * KEYS);
+	int failed = 0;
+	srand(27);
+
+	for (size_t churn = 0; churn <= 64; churn += 64) {
+		cmap_option_t option = {.bloom_filter = true, .bloom_churn = churn};
+		cmap_t map = cmap_init3(&interface, &interface, &option);
+		size_t count = 0;
+		for (int i = 0; i < KEYS; i++)
+			expected[i] = -1;
+
+		printf("Churn %zu: random operations...\n", churn);
+		for (int op = 0; op < OPS; op++) {
+			int32_t key = rand() % KEYS, val = rand() % 1000;
+			switch (rand() % 5) {
+			case 0:
+			case 1:
+				map.insert(&map, &key, &val);
+				count += expected[key] < 0;
+				expected[key] = val;
+				break;
+			case 2:
+				if (map.erase(&map, &key) != (expected[key] >= 0))
+					failed = 1;
+				count -= expected[key] >= 0;
+				expected[key] = -1;
+				break;
+			case 3: {
+				void *val_out = NULL;
+				bool extracted = map.extract(&map, &key, NULL, &val_out);
+				if (extracted != (expected[key] >= 0) ||
+				    (extracted && *(int32_t *)val_out != expected[key]))
+					failed = 1;
+				free(val_out);
+				count -= expected[key] >= 0;
+				expected[key] = -1;
+				break;
+			}
+			default: {
+				const int32_t *found = map.search(&map, &key);
+				if ((found == NULL) != (expected[key] < 0) ||
+				    (found != NULL && *found != expected[key]) || map.find(&map, &key).val != found)
+					failed = 1;
+			}
+			}
+			if (map.size(&map) != count)
+				failed = 1;
+		}
+
+		int32_t low = KEYS / 4, high = KEYS / 2;
+		size_t in_range = 0;
+		for (int32_t key = low; key < high; key++) {
+			in_range += expected[key] >= 0;
+			expected[key] = -1;
+		}
+		if (map.erase_range(&map, &low, &high) != in_range)
+			failed = 1;
+		for (int32_t key = 0; key < KEYS; key++)
+			if ((map.search(&map, &key) == NULL) != (expected[key] < 0))
+				failed = 1;
+
+		// The keys from KEYS on were never inserted.
+		for (int32_t key = KEYS; key < KEYS + PROBES; key++)
+			if (map.search(&map, &key) != NULL || map.erase(&map, &key))
+				failed = 1;
+		cmap_stats_t stats;
+		map.stats(&map, &stats);
+		printf("%zu keys, Bloom filter: %zu bytes, estimated FPR %.2e\n", stats.count,
+		       stats.bloom_memory, stats.bloom_fpr);
+		if (stats.bloom_memory == 0 || stats.bloom_fpr <= 0 || stats.bloom_fpr > 0.01)
+			failed = 1;
+
+		map.clear(&map);
+		map.stats(&map, &stats);
+		if (map.search(&map, &low) != NULL || stats.bloom_fpr != 0)
+			failed = 1;
+		map.destroy(&map);
+
+		// The filter is built with the tree by build_sorted().
+		cmap_t sorted_map = cmap_init3(&interface, &interface, &option);
+		int32_t sorted[KEYS];
+		for (int32_t i = 0; i < KEYS; i++)
+			sorted[i] = 2 * i;
+		const void **keys = malloc(sizeof(void *) * KEYS);
+		for (int32_t i = 0; i < KEYS; i++)
+			keys[i] = &sorted[i];
+		if (!sorted_map.build_sorted(&sorted_map, keys, keys, KEYS))
+			failed = 1;
+		for (int32_t key = 0; key < 2 * KEYS; key++)
+			if ((sorted_map.search(&sorted_map, &key) != NULL) != (key % 2 == 0))
+				failed = 1;
+		free(keys);
+		sorted_map.destroy(&sorted_map);
+	}
+
+	printf("Built-in hash of strings...\n");
+	cmap_option_t option = {.bloom_filter = true};
+	cmap_t str_map = cmap_init3(&str_interface, &interface, &option);
+	char key[32];
+	for (int32_t i = 0; i < KEYS; i++) {
+		snprintf(key, sizeof(key), "key-%d", (int)i);
+		str_map.insert(&str_map, key, &i);
+	}
+	for (int i = 0; i < PROBES; i++) {
+		snprintf(key, sizeof(key), "missing-%d", i);
+		if (str_map.search(&str_map, key) != NULL)
+			failed = 1;
+	}
+	for (int i = 0; i < KEYS; i++) {
+		snprintf(key, sizeof(key), "key-%d", i);
+		const int32_t *found = str_map.search(&str_map, key);
+		if (found == NULL || *found != i)
+			failed = 1;
+	}
+	str_map.destroy(&str_map);
+
+	free(expected);
+	if (failed)
+		return 1;
+	printf("Finish\n");
+	return 0;
+}
@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cmap.h"
+
+#define KEYS 3000
+#define ROUNDS 20
+
+int str_cmp(const void *d1, const void *d2) {
+	return strcmp(d1, d2);
+}
+
+size_t str_size_get(const void *d1) {
+	return strlen(d1) + 1;
+}
+
+int int_cmp(const void *d1, const void *d2) {
+	const int *int1 = d1, *int2 = d2;
+	return (*int1 > *int2) - (*int1 < *int2);
+}
+
+size_t int_size_get(const void *d1) {
+	return sizeof(int);
+}
+
+/*
+ * Test the slab pool of the cmap.
+ * Allocated string keys with inline values are inserted and erased in rounds whose
+ * live counts rise and fall, and the memory of the pool reported by stats() must
+ * never exceed the chunks needed by the peak live count, since erased nodes are
+ * reused. A node erased last is the next one allocated, clear() keeps the chunks
+ * for the following inserts, and destroy() must leave nothing behind (make check).
+ */
+int main(void) {
+	cmap_data_t key_interface = CREATE_INTERFACE(str_cmp, str_size_get);
+	cmap_data_t val_interface = CREATE_INLINE_INTERFACE(int_cmp, int_size_get, sizeof(int));
+	cmap_t map = cmap_init(&key_interface, &val_interface);
+	char (*keys)[32] = malloc(sizeof(*keys) * KEYS);
+	int *expected = malloc(sizeof(int) * KEYS);
+	int failed = 0;
+	for (int i = 0; i < KEYS; i++) {
+		snprintf(keys[i], sizeof(keys[i]), "pool-key-%d", i * 7919 % KEYS);
+		expected[i] = -1;
+	}
+	srand(28);
+
+	// The first insert allocates one chunk, which tells the size of a chunk.
+	cmap_stats_t stats;
+	map.insert(&map, keys[0], &(int){0});
+	expected[0] = 0;
+	map.stats(&map, &stats);
+	size_t chunk_memory = stats.node_memory, chunk_nodes = chunk_memory / stats.node_size;
+	printf("A chunk: %zu bytes for %zu nodes\n", chunk_memory, chunk_nodes);
+	if (chunk_nodes == 0)
+		failed = 1;
+
+	printf("Churn...\n");
+	size_t count = 1, peak = 1;
+	for (int round = 0; round < ROUNDS; round++) {
+		// The live count rises to a random target and then falls to a random one.
+		size_t high = rand() % KEYS, low = rand() % (high + 1);
+		while (count < high) {
+			int i = rand() % KEYS;
+			if (expected[i] >= 0)
+				continue;
+			expected[i] = round;
+			map.insert(&map, keys[i], &expected[i]);
+			count++;
+		}
+		peak = count > peak ? count : peak;
+		while (count > low) {
+			int i = rand() % KEYS;
+			if (expected[i] < 0)
+				continue;
+			if (!map.erase(&map, keys[i]))
+				failed = 1;
+			expected[i] = -1;
+			count--;
+		}
+		map.stats(&map, &stats);
+		if (stats.count != count ||
+		    stats.node_memory > (peak + chunk_nodes - 1) / chunk_nodes * chunk_memory)
+			failed = 1;
+	}
+	printf("Peak %zu keys, %zu bytes of nodes\n", peak, stats.node_memory);
+	for (int i = 0; i < KEYS; i++) {
+		const int *found = map.search(&map, keys[i]);
+		if ((found == NULL) != (expected[i] < 0) || (found != NULL && *found != expected[i]))
+			failed = 1;
+	}
+
+	printf("Reuse...\n");
+	int erased = 0, inserted = 0;
+	while (expected[erased] < 0)
+		erased++;
+	while (expected[inserted] >= 0)
+		inserted++;
+	// The inline value lives in the node, so the same address means the same node.
+	const void *erased_val = map.search(&map, keys[erased]);
+	map.erase(&map, keys[erased]);
+	expected[erased] = -1;
+	map.insert(&map, keys[inserted], &inserted);
+	expected[inserted] = inserted;
+	if (map.search(&map, keys[inserted]) != erased_val)
+		failed = 1;
+
+	printf("Clear...\n");
+	size_t memory = stats.node_memory;
+	map.clear(&map);
+	map.stats(&map, &stats);
+	if (stats.count != 0 || stats.node_memory != memory)
+		failed = 1;
+	for (int i = 0; i < (int)peak; i++)
+		map.insert(&map, keys[i], &i);
+	map.stats(&map, &stats);
+	if (stats.count != peak || stats.node_memory != memory)
+		failed = 1;
+	map.destroy(&map);
+
+	free(keys);
+	free(expected);
+	if (failed)
+		return 1;
+	printf("Finish\n");
+	return 0;
+}
@@ -0,0 +1,111 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cmap.h"
+
+#define KEYS 2000
+#define OPS 60000
+
+int int_cmp(const void *d1, const void *d2) {
+	const int *int1 = d1, *int2 = d2;
+	return (*int1 > *int2) - (*int1 < *int2);
+}
+
+size_t int_size_get(const void *d1) {
+	return sizeof(int);
+}
+
+int str_cmp(const void *d1, const void *d2) {
+	return strcmp(d1, d2);
+}
+
+size_t str_size_get(const void *d1) {
+	return strlen(d1) + 1;
+}
+
+/*
+ * Check the keys and values of a cmap against the array in both directions.
+ * The walk forward follows right children and parents, and the walk backward
+ * follows left children and parents, which are packed with the colors.
+ */
+static int check(cmap_t *map, char (*expected)[16], size_t count) {
+	int key = -1;
+	size_t visited = 0;
+	for (cmap_iter_t it = map->begin(map); it.node != NULL; it = map->next(map, it), visited++) {
+		do
+			key++;
+		while (key < KEYS && expected[key][0] == '\0');
+		if (key == KEYS || *(int *)it.key != key || strcmp(it.val, expected[key]) != 0)
+			return 1;
+	}
+	if (visited != count || map->size(map) != count)
+		return 1;
+	key = KEYS;
+	for (cmap_iter_t it = map->prev(map, map->end(map)); it.node != NULL; it = map->prev(map, it)) {
+		do
+			key--;
+		while (key >= 0 && expected[key][0] == '\0');
+		if (key < 0 || *(int *)it.key != key)
+			return 1;
+	}
+	return 0;
+}
+
+/*
+ * Test the compact node of the cmap.
+ * The parent pointer and the color share a word, and the methods of the keys and
+ * values are reached through the cmap object. Random inserts, updates and erases
+ * of inline int keys with allocated string values are validated after every call
+ * (DEBUG), and the order and contents are checked against an array.
+ */
+int main(void) {
+	cmap_data_t key_interface = CREATE_INLINE_INTERFACE(int_cmp, int_size_get, sizeof(int));
+	cmap_data_t val_interface = CREATE_INTERFACE(str_cmp, str_size_get);
+	cmap_t map = cmap_init(&key_interface, &val_interface);
+	char (*expected)[16] = calloc(KEYS, sizeof(*expected));
+	size_t count = 0;
+	int failed = 0;
+	srand(29);
+
+	printf("Random operations...\n");
+	for (int op = 0; op < OPS; op++) {
+		int key = rand() % KEYS;
+		if (rand() % 3 != 0) {
+			count += expected[key][0] == '\0';
+			snprintf(expected[key], sizeof(expected[key]), "v%d", rand());
+			map.insert(&map, &key, expected[key]);
+		}
+		else {
+			if (map.erase(&map, &key) != (expected[key][0] != '\0'))
+				failed = 1;
+			count -= expected[key][0] != '\0';
+			expected[key][0] = '\0';
+		}
+		if (op % 1000 == 0 && check(&map, expected, count))
+			failed = 1;
+	}
+	printf("%zu keys\n", count);
+	if (check(&map, expected, count))
+		failed = 1;
+
+	printf("Erasing all keys...\n");
+	for (int key = KEYS - 1; key >= 0; key -= 2) {
+		count -= expected[key][0] != '\0';
+		map.erase(&map, &key);
+		expected[key][0] = '\0';
+	}
+	for (int key = 0; key < KEYS; key += 2) {
+		count -= expected[key][0] != '\0';
+		map.erase(&map, &key);
+		expected[key][0] = '\0';
+	}
+	if (count != 0 || check(&map, expected, 0) || map.begin(&map).node != NULL)
+		failed = 1;
+	map.destroy(&map);
+
+	free(expected);
+	if (failed)
+		return 1;
+	printf("Finish\n");
+	return 0;
+}
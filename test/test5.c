@@ -0,0 +1,80 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cmap.h"
+
+int cmp(const void *key1, const void *key2) {
+	return strcmp(key1, key2);
+}
+
+size_t key_size_get(const void *key) {
+	return strlen(key) + 1;
+}
+
+size_t val_size_get(const void *val) {
+	return sizeof(int);
+}
+
+// For testing.
+struct tuple {
+	char key[1024];
+	int val;
+} tuples[100];
+
+/*
+ * Test the inline storage of the cmap.
+ * Short keys (at most 15 characters) and all values are stored inside the
+ * cmap nodes while longer keys are allocated separately. All keys from
+ * test/test.in are inserted, updated and then removed from the cmap object.
+ */
+int main(void) {
+
+	FILE *input_node = fopen("test/test.in", "r");
+	if (input_node == NULL)
+		input_node = stdin;
+	cmap_data_t key_interface = CREATE_INLINE_INTERFACE(cmp, key_size_get, 16);
+	cmap_data_t val_interface = CREATE_INLINE_INTERFACE(NULL, val_size_get, sizeof(int));
+
+	cmap_t map = cmap_init(&key_interface, &val_interface);
+
+	int n = 0;
+	while (fgets(tuples[n].key, sizeof(tuples[n].key), input_node) != NULL) {
+		tuples[n].key[strlen(tuples[n].key) - 1] = '\0';
+		tuples[n].val = n;
+		printf("Insert (%s, %d)\n", tuples[n].key, tuples[n].val);
+		map.insert(&map, tuples[n].key, &tuples[n].val);
+		n++;
+	}
+	fclose(input_node);
+
+	printf("Updating...\n");
+	for (int i = 0; i < n; i++) {
+		tuples[i].val = -i;
+		map.insert(&map, tuples[i].key, &tuples[i].val);
+	}
+
+	printf("Erasing...\n");
+	for (int i = 0; i < n; i += 2) {
+		if (map.erase(&map, tuples[i].key) == false) {
+			fprintf(stderr, "Cannot erase %s\n", tuples[i].key);
+			return 1;
+		}
+	}
+	for (int i = 0; i < n; i++) {
+		int *accesser = map.search(&map, tuples[i].key);
+		if ((i % 2 == 0 && accesser != NULL) ||
+		    (i % 2 == 1 && (accesser == NULL || *accesser != -i))) {
+			fprintf(stderr, "Wrong value for %s\n", tuples[i].key);
+			return 1;
+		}
+		printf("Key: %s, ", tuples[i].key);
+		if (accesser)
+			printf("Get: %d\n", *accesser);
+		else
+			printf("Not exist: %p\n", accesser);
+	}
+
+	map.destroy(&map);
+	printf("Finish\n");
+	return 0;
+}
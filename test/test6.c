@@ -0,0 +1,74 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "cmap.h"
+
+#define THREADS 8
+#define KEYS 2000
+
+int int_cmp(const void *d1, const void *d2) {
+	const int *int1 = d1, *int2 = d2;
+	return (*int1 > *int2) - (*int1 < *int2);
+}
+
+size_t int_size_get(const void *d1) {
+	return sizeof(int);
+}
+
+/*
+ * Every thread owns a cmap object. It inserts a permutation of keys, erases
+ * all of them in another order and checks that the cmap becomes empty.
+ * Different cmap objects share no writable state, so the threads do not
+ * need any lock.
+ */
+void *worker(void *arg) {
+	int id = *(int *)arg;
+	cmap_data_t key_interface = CREATE_INTERFACE(int_cmp, int_size_get);
+	cmap_data_t val_interface = CREATE_INTERFACE(NULL, int_size_get);
+	cmap_t map = cmap_init(&key_interface, &val_interface);
+	int *failed = malloc(sizeof(int));
+	*failed = 0;
+
+	for (int round = 0; round < 3; round++) {
+		for (int i = 0; i < KEYS; i++) {
+			int key = (i * 7 + id) % KEYS;
+			map.insert(&map, &key, &i);
+		}
+		for (int i = 0; i < KEYS; i++) {
+			int key = (i * 13 + round) % KEYS;
+			if (map.erase(&map, &key) == false)
+				*failed = 1;
+		}
+		for (int i = 0; i < KEYS; i++) {
+			if (map.search(&map, &i) != NULL)
+				*failed = 1;
+		}
+		if (map.root != NULL)
+			*failed = 1;
+	}
+	map.destroy(&map);
+	return failed;
+}
+
+int main(void) {
+	pthread_t threads[THREADS];
+	int ids[THREADS];
+	int failed = 0;
+
+	for (int i = 0; i < THREADS; i++) {
+		ids[i] = i;
+		pthread_create(&threads[i], NULL, worker, &ids[i]);
+	}
+	for (int i = 0; i < THREADS; i++) {
+		void *result;
+		pthread_join(threads[i], &result);
+		printf("Thread %d: %s\n", i, *(int *)result ? "failed" : "ok");
+		failed |= *(int *)result;
+		free(result);
+	}
+	if (failed)
+		return 1;
+	printf("Finish\n");
+	return 0;
+}
@@ -0,0 +1,123 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include "cmap.h"
+#include "cmap_concurrent.h"
+
+#define THREADS 4
+#define KEYS 2000
+
+int int_cmp(const void *d1, const void *d2) {
+	const int *int1 = d1, *int2 = d2;
+	return (*int1 > *int2) - (*int1 < *int2);
+}
+
+size_t int_size_get(const void *d1) {
+	return sizeof(int);
+}
+
+cmap_sharded_t *cmap;
+
+/*
+ * Every thread inserts the keys k with k % THREADS == id and erases the
+ * multiples of 3 of them, so the threads touch all shards at the same time.
+ */
+void *writer(void *arg) {
+	int id = *(int *)arg;
+	for (int key = id; key < KEYS; key += THREADS) {
+		int val = key * 10;
+		cmap->insert(cmap, &key, &val);
+	}
+	for (int key = id; key < KEYS; key += THREADS) {
+		if (key % 3 == 0)
+			cmap->erase(cmap, &key);
+	}
+	return NULL;
+}
+
+struct order {
+	int prev;
+	int count;
+	int failed;
+};
+
+bool check_order(const void *key, void *val, void *arg) {
+	struct order *order = arg;
+	const int *k = key;
+	if (*k <= order->prev || *(int *)val != *k * 10)
+		order->failed = 1;
+	order->prev = *k;
+	order->count++;
+	return true;
+}
+
+int main(void) {
+	cmap_data_t key_interface = CREATE_INTERFACE(int_cmp, int_size_get);
+	cmap_data_t val_interface = CREATE_INTERFACE(NULL, int_size_get);
+	int split_keys[3] = {500, 1000, 1500};
+	const void *splits[3] = {&split_keys[0], &split_keys[1], &split_keys[2]};
+	pthread_t threads[THREADS];
+	int ids[THREADS];
+
+	cmap = cmap_sharded_alloc(&key_interface, &val_interface, 4, splits);
+	// Every shard starts a cache line, so no two locks share one.
+	if (sizeof(cmap_shard_t) % 64 != 0 || (uintptr_t)cmap->shards % 64 != 0)
+		return 1;
+	for (int i = 0; i < THREADS; i++) {
+		ids[i] = i;
+		pthread_create(&threads[i], NULL, writer, &ids[i]);
+	}
+	for (int i = 0; i < THREADS; i++)
+		pthread_join(threads[i], NULL);
+
+	struct order order = {.prev = -1};
+	cmap->foreach(cmap, check_order, &order);
+	printf("Visited %d keys in order\n", order.count);
+	if (order.failed || order.count != KEYS - (KEYS + 2) / 3)
+		return 1;
+	for (int i = 0; i < 4; i++) {
+		int count = 0;
+		int first = i * 500 + 1;
+		if (first % 3 == 0)
+			first++;
+		if (cmap->shards[i].map.search(&cmap->shards[i].map, &first) == NULL)
+			return 1;
+		for (int key = i * 500; key < (i + 1) * 500; key++) {
+			int val;
+			count += cmap->search(cmap, &key, &val);
+		}
+		printf("Shard %d: %d keys\n", i, count);
+	}
+	cmap->destroy(cmap);
+	cmap->dealloc(cmap);
+
+	printf("Sampling...\n");
+	int keys[KEYS], vals[KEYS];
+	const void *key_ptrs[KEYS], *val_ptrs[KEYS];
+	for (int i = 0; i < KEYS; i++) {
+		keys[i] = (i * 7) % KEYS;
+		vals[i] = keys[i] * 10;
+		key_ptrs[i] = &keys[i];
+		val_ptrs[i] = &vals[i];
+	}
+	if (cmap_sharded_alloc_sampled(&key_interface, &val_interface, 0, key_ptrs, val_ptrs,
+				       KEYS) != NULL)
+		return 1;
+	cmap = cmap_sharded_alloc_sampled(&key_interface, &val_interface, 8,
+					  key_ptrs, val_ptrs, KEYS);
+	order = (struct order){.prev = -1};
+	cmap->foreach(cmap, check_order, &order);
+	printf("Visited %d keys in order\n", order.count);
+	if (order.failed || order.count != KEYS)
+		return 1;
+	for (size_t i = 0; i + 1 < cmap->shards_count; i++)
+		printf("Split %zu: %d\n", i, *(int *)cmap->splits[i]);
+	cmap->destroy(cmap);
+	cmap->dealloc(cmap);
+
+	printf("Finish\n");
+	return 0;
+}
@@ -0,0 +1,104 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "cmap.h"
+#include "cmap_concurrent.h"
+
+#define WRITERS 2
+#define READERS 4
+#define KEYS 1000
+
+int int_cmp(const void *d1, const void *d2) {
+	const int *int1 = d1, *int2 = d2;
+	return (*int1 > *int2) - (*int1 < *int2);
+}
+
+size_t int_size_get(const void *d1) {
+	return sizeof(int);
+}
+
+cmap_optimistic_t *cmap;
+int failed;
+
+/*
+ * Every writer owns the keys k with k % WRITERS == id. It inserts them with
+ * the value -k, updates them to k and erases the odd ones, several times.
+ */
+void *writer(void *arg) {
+	int id = *(int *)arg;
+	for (int round = 0; round < 5; round++) {
+		for (int key = id; key < KEYS; key += WRITERS) {
+			int val = -key;
+			cmap->insert(cmap, &key, &val);
+		}
+		for (int key = id; key < KEYS; key += WRITERS)
+			cmap->insert(cmap, &key, &key);
+		for (int key = id; key < KEYS; key += WRITERS) {
+			if (key % 2 == 1 && cmap->erase(cmap, &key) == false)
+				__atomic_store_n(&failed, 1, __ATOMIC_RELAXED);
+		}
+	}
+	return NULL;
+}
+
+/*
+ * Readers search all keys without locks while the writers are working, and
+ * the value of a found key must be either -k or k.
+ */
+void *reader(void *arg) {
+	cmap_reader_t *slot = cmap->reader_register(cmap);
+	if (slot == NULL) {
+		__atomic_store_n(&failed, 1, __ATOMIC_RELAXED);
+		return NULL;
+	}
+	for (int round = 0; round < 20; round++) {
+		for (int key = 0; key < KEYS; key++) {
+			int val;
+			if (cmap->search(cmap, slot, &key, &val) && val != key && val != -key)
+				__atomic_store_n(&failed, 1, __ATOMIC_RELAXED);
+		}
+	}
+	cmap->reader_unregister(cmap, slot);
+	return NULL;
+}
+
+int main(void) {
+	cmap_data_t key_interface = CREATE_INTERFACE(int_cmp, int_size_get);
+	cmap_data_t val_interface =
+		CREATE_INLINE_INTERFACE(NULL, int_size_get, sizeof(int));
+	pthread_t threads[WRITERS + READERS];
+	int ids[WRITERS];
+
+	cmap = cmap_optimistic_alloc(&key_interface, &val_interface);
+
+	for (int i = 0; i < WRITERS; i++) {
+		ids[i] = i;
+		pthread_create(&threads[i], NULL, writer, &ids[i]);
+	}
+	for (int i = 0; i < READERS; i++)
+		pthread_create(&threads[WRITERS + i], NULL, reader, NULL);
+	for (int i = 0; i < WRITERS + READERS; i++)
+		pthread_join(threads[i], NULL);
+
+	printf("Searching...\n");
+	cmap_reader_t *slot = cmap->reader_register(cmap);
+	for (int key = 0; key < KEYS; key++) {
+		int val;
+		bool found = cmap->search(cmap, slot, &key, &val);
+		if (found != (key % 2 == 0) || (found && val != key)) {
+			fprintf(stderr, "Wrong result of key %d\n", key);
+			failed = 1;
+		}
+	}
+	cmap->reader_unregister(cmap, slot);
+	printf("Found %d keys\n", KEYS / 2);
+
+	cmap->destroy(cmap);
+	cmap->dealloc(cmap);
+	if (failed)
+		return 1;
+	printf("Finish\n");
+	return 0;
+}